@@ -0,0 +1,177 @@
+/* ==============================================================================
+   BENCH.CPP - On-Device Exec Pipeline Benchmark Implementation
+
+   A run executes in its own short-lived task so the web server keeps
+   answering; /api/bench reports progress and the last result. The producer
+   submits as fast as the pool allows and yields on backpressure, so the
+   reported rate is the sustained rate of bizTask, not of the producer.
+   ============================================================================== */
+
+#include "bench.h"
+
+#if ENABLE_BENCH
+
+#include "globals.h"
+#include "web_handler.h"
+#include "msg_pool.h"
+#include "exec_queue.h"
+#include "exec_stats.h"
+#include "heap_tracker.h"
+#include <ArduinoJson.h>
+#include <esp_task_wdt.h>
+
+#define BENCH_POOL_OPS 10000
+#define BENCH_DRAIN_TIMEOUT_MS 10000
+
+enum BenchState : uint8_t {
+  BENCH_IDLE = 0,
+  BENCH_RUNNING,
+  BENCH_DONE,
+  BENCH_FAILED
+};
+
+struct BenchResult {
+  uint32_t requested;
+  uint32_t submitted;
+  uint32_t completed;
+  uint32_t backpressure;
+  uint32_t elapsedMs;
+  uint32_t cmdPerSec;
+  uint32_t poolCyclesPerOp;
+  ExecLatencySummary total;
+  ExecLatencySummary queue;
+  const char* error;
+};
+
+static volatile BenchState benchState = BENCH_IDLE;
+static BenchResult benchResult;
+static TaskHandle_t benchTaskHandle = nullptr;
+
+/* benchPool: Single-task alloc/free round trips; measures the uncontended fast path */
+static uint32_t benchPool() {
+  uint32_t start = ESP.getCycleCount();
+  for (uint32_t i = 0; i < BENCH_POOL_OPS; i++) {
+    ExecMessage* msg = allocMessage(EXEC_LANE_BULK, 4);
+    freeMessage(msg);
+  }
+  return (ESP.getCycleCount() - start) / (BENCH_POOL_OPS * 2);
+}
+
+static void benchTask(void* param) {
+  uint32_t count = (uint32_t)(uintptr_t)param;
+  esp_task_wdt_add(NULL);
+
+  BenchResult r = {};
+  r.requested = count;
+  r.poolCyclesPerOp = benchPool();
+
+  execStatsReset();
+  uint32_t processedStart = bizProcessed;
+  uint32_t startMs = millis();
+
+  while (r.submitted < count) {
+    if (isOtaActive() || gBizState != BIZ_RUNNING) {
+      r.error = "interrupted";
+      break;
+    }
+    if (execSubmit("ping", 4, micros()) == EXEC_SUBMIT_OK) {
+      r.submitted++;
+    } else {
+      r.backpressure++;
+      vTaskDelay(1);
+      esp_task_wdt_reset();
+    }
+  }
+
+  while ((bizProcessed - processedStart) < r.submitted &&
+         millis() - startMs < BENCH_DRAIN_TIMEOUT_MS + r.submitted / 10) {
+    vTaskDelay(pdMS_TO_TICKS(5));
+    esp_task_wdt_reset();
+  }
+
+  r.elapsedMs = millis() - startMs;
+  r.completed = bizProcessed - processedStart;
+  if (r.elapsedMs > 0) r.cmdPerSec = (uint32_t)(((uint64_t)r.completed * 1000) / r.elapsedMs);
+  getExecLatency(EXEC_STAGE_TOTAL, r.total);
+  getExecLatency(EXEC_STAGE_QUEUE, r.queue);
+  if (!r.error && r.completed < r.submitted) r.error = "drain timeout";
+
+  benchResult = r;
+  benchState = r.error ? BENCH_FAILED : BENCH_DONE;
+  Serial.printf("[bench] %u cmds in %ums: %u cmd/s, pool %u cycles/op\n",
+                r.completed, r.elapsedMs, r.cmdPerSec, r.poolCyclesPerOp);
+
+  esp_task_wdt_delete(NULL);
+  benchTaskHandle = nullptr;
+  vTaskDelete(NULL);
+}
+
+void registerBenchRoutes() {
+  server.on("/api/bench", HTTP_POST, handleBenchStart);
+  server.on("/api/bench", HTTP_GET, handleBenchStatus);
+}
+
+/* handleBenchStart: POST /api/bench?n=<commands> starts a run in the background */
+void handleBenchStart() {
+  if (isOtaActive()) {
+    sendBusyJson("OTA in progress");
+    return;
+  }
+  if (benchState == BENCH_RUNNING) {
+    server.send(409, "application/json", "{\"err\":\"bench already running\"}");
+    return;
+  }
+  if (gBizState != BIZ_RUNNING) {
+    server.send(409, "application/json", "{\"err\":\"biz stopped\"}");
+    return;
+  }
+
+  uint32_t count = server.hasArg("n") ? strtoul(server.arg("n").c_str(), nullptr, 10) : 10000;
+  if (count == 0 || count > BENCH_MAX_COMMANDS) {
+    server.send(400, "application/json", "{\"err\":\"n out of range\"}");
+    return;
+  }
+
+  benchState = BENCH_RUNNING;
+  if (xTaskCreate(benchTask, "bench", BENCH_TASK_STACK, (void*)(uintptr_t)count, 1, &benchTaskHandle) != pdPASS) {
+    benchState = BENCH_IDLE;
+    server.send(500, "application/json", "{\"err\":\"task create failed\"}");
+    return;
+  }
+  server.send(202, "application/json", "{\"msg\":\"bench started\"}");
+}
+
+static void addLatency(JsonObject parent, const char* key, const ExecLatencySummary& s) {
+  JsonObject o = parent.createNestedObject(key);
+  o["p50"] = s.p50Us;
+  o["p95"] = s.p95Us;
+  o["p99"] = s.p99Us;
+  o["max"] = s.maxUs;
+}
+
+void handleBenchStatus() {
+  static const char* const stateNames[] = { "idle", "running", "done", "failed" };
+  WebJsonDocument doc(768);
+  doc["state"] = stateNames[benchState];
+
+  if (benchState == BENCH_DONE || benchState == BENCH_FAILED) {
+    const BenchResult& r = benchResult;
+    doc["requested"] = r.requested;
+    doc["submitted"] = r.submitted;
+    doc["completed"] = r.completed;
+    doc["backpressure"] = r.backpressure;
+    doc["elapsed_ms"] = r.elapsedMs;
+    doc["cmd_per_sec"] = r.cmdPerSec;
+    doc["pool_cycles_per_op"] = r.poolCyclesPerOp;
+    JsonObject latency = doc.createNestedObject("latency_us");
+    addLatency(latency, "total", r.total);
+    addLatency(latency, "queue", r.queue);
+    if (r.error) doc["err"] = r.error;
+  }
+
+  String output;
+  serializeJson(doc, output);
+  server.send(200, "application/json", output);
+}
+
+#endif
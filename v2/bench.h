@@ -0,0 +1,30 @@
+/* ==============================================================================
+   BENCH.H - On-Device Exec Pipeline Benchmark Interface
+
+   Measures the command path without an external load generator:
+   - Pool microbenchmark: allocMessage()/freeMessage() pairs, cycles per op
+   - Pipeline run: N "ping" commands through execSubmit() -> lanes -> bizTask,
+     reporting throughput and p50/p95/p99 latency from exec_stats
+
+   Compiled only with ENABLE_BENCH. A run resets the exec_stats histograms.
+   ============================================================================== */
+
+/* Header guard to prevent multiple inclusion of bench.h */
+#ifndef BENCH_H
+#define BENCH_H
+
+#include "config.h"
+
+#if ENABLE_BENCH
+
+#include <Arduino.h>
+
+void registerBenchRoutes();
+
+void handleBenchStart();
+
+void handleBenchStatus();
+
+#endif
+
+#endif
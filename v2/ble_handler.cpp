@@ -5,7 +5,7 @@
    - TX characteristic: Device sends status to phone/computer
    - RX characteristic: Device receives commands from phone/computer
    - Handles WiFi credential provisioning
-   - Processes system control commands (reboot, clear WiFi, etc.)
+   - Processes system control commands via the shared command registry
    - Manages connection LED indication
    
    BLE enables wireless configuration when WiFi is not yet set up.
@@ -17,13 +17,12 @@
 #include "wifi_handler.h"
 #include "hardware.h" 
 #include "debug_handler.h"
+#include "cmd_registry.h"
+#include "heap_tracker.h"
 
 #if ESP32_HAS_BLE
 
-static String cleanString(const String& input);
-static bool isValidIP(const String& s);
-static bool isValidSubnet(const String& s);
-static IPAddress parseIP(const String& s);
+static char* trimInPlace(char* str);
 
 class BLECommandBuffer {
  private:
@@ -45,23 +44,23 @@ class BLECommandBuffer {
     }
   }
 
-  bool hasComplete() const {
-    return strchr(buffer, '\n') != nullptr;
-  }
-
-  String extractCommand() {
+  /* Copies the next newline-terminated command into out; false if none is complete */
+  bool extractCommand(char* out, size_t outSize) {
     char* newline = strchr(buffer, '\n');
-    if (!newline) return String();
+    if (!newline) return false;
+
+    size_t len = newline - buffer;
+    if (len >= outSize) len = outSize - 1;
+    memcpy(out, buffer, len);
+    out[len] = '\0';
 
-    *newline = '\0';
-    String cmd(buffer);
     size_t remaining = pos - (newline - buffer + 1);
     if (remaining > 0) {
       memmove(buffer, newline + 1, remaining);
     }
     pos = remaining;
     buffer[pos] = '\0';
-    return cmd;
+    return true;
   }
 };
 
@@ -88,10 +87,10 @@ class MyCharCallbacks : public NimBLECharacteristicCallbacks {
     std::string value = pChar->getValue();
     if (value.length() > 0) {
       cmdBuffer.append((uint8_t*)value.data(), value.length());
-      while (cmdBuffer.hasComplete()) {
-        String cmd = cmdBuffer.extractCommand();
-        cmd = cleanString(cmd);
-        if (cmd.length() > 0) {
+      char line[MAX_BLE_CMD_LENGTH];
+      while (cmdBuffer.extractCommand(line, sizeof(line))) {
+        char* cmd = trimInPlace(line);
+        if (*cmd != '\0') {
           handleBLECommand(cmd);
         }
       }
@@ -101,13 +100,15 @@ class MyCharCallbacks : public NimBLECharacteristicCallbacks {
 
 /* initBLE: Initializes Bluetooth Low Energy server with custom service for configuration */
 void initBLE() {
+  /* NimBLE allocates internally; charge what init consumed to the ble tag */
+  uint32_t heapBefore = ESP.getFreeHeap();
   NimBLEDevice::init(BLE_ADVERT_NAME);
   NimBLEDevice::setMTU(256);
 
   pBLEServer = NimBLEDevice::createServer();
   if (!pBLEServer) {
     Serial.println(F("CRITICAL: Failed to create BLE server!"));
-    LOG_ERROR(F("BLE server creation failed"), 0);
+    LOG_ERROR(EVT_BLE_SERVER_FAILED);
     return;
   }
   pBLEServer->setCallbacks(new MyServerCallbacks());
@@ -115,21 +116,21 @@ void initBLE() {
   NimBLEService* pService = pBLEServer->createService(BLE_SERVICE_UUID);
   if (!pService) {
     Serial.println(F("CRITICAL: Failed to create BLE service!"));
-    LOG_ERROR(F("BLE service creation failed"), 0);
+    LOG_ERROR(EVT_BLE_SERVICE_FAILED);
     return;
   }
 
   pTxCharacteristic = pService->createCharacteristic(BLE_CHAR_UUID_TX, NIMBLE_PROPERTY::NOTIFY);
   if (!pTxCharacteristic) {
     Serial.println(F("CRITICAL: Failed to create BLE TX characteristic!"));
-    LOG_ERROR(F("BLE TX characteristic failed"), 0);
+    LOG_ERROR(EVT_BLE_TX_CHAR_FAILED);
   }
 
   NimBLECharacteristic* pRxCharacteristic = pService->createCharacteristic(
       BLE_CHAR_UUID_RX, NIMBLE_PROPERTY::WRITE | NIMBLE_PROPERTY::WRITE_NR);
   if (!pRxCharacteristic) {
     Serial.println(F("CRITICAL: Failed to create BLE RX characteristic!"));
-    LOG_ERROR(F("BLE RX characteristic failed"), 0);
+    LOG_ERROR(EVT_BLE_RX_CHAR_FAILED);
   } else {
     pRxCharacteristic->setCallbacks(new MyCharCallbacks());
   }
@@ -150,6 +151,8 @@ void initBLE() {
   NimBLEDevice::setPower(ESP_PWR_LVL_P9);
   pAdvertising->start();
 
+  uint32_t heapAfter = ESP.getFreeHeap();
+  heapTrackSetFootprint(HEAP_TAG_BLE, heapBefore > heapAfter ? heapBefore - heapAfter : 0);
   Serial.println(F("BLE initialized successfully"));
 }
 
@@ -164,251 +167,53 @@ void handleBLEReconnect() {
   }
 }
 
-void sendBLE(const String& m) {
+void sendBLE(const char* m) {
   if (!bleDeviceConnected || !pTxCharacteristic) return;
 
-  const char* data = m.c_str();
-  size_t len = m.length();
+  size_t len = strlen(m);
 
   if (len <= 512) {
-    pTxCharacteristic->setValue((uint8_t*)data, len);
+    pTxCharacteristic->setValue((const uint8_t*)m, len);
     pTxCharacteristic->notify();
   } else {
     for (size_t i = 0; i < len; i += 512) {
       size_t chunk_size = (len - i > 512) ? 512 : (len - i);
-      pTxCharacteristic->setValue((uint8_t*)(data + i), chunk_size);
+      pTxCharacteristic->setValue((const uint8_t*)(m + i), chunk_size);
       pTxCharacteristic->notify();
       delay(20);
     }
   }
 }
 
-void handleBLECommand(String cmd) {
-  cmd = cleanString(cmd);
-  cmd.trim();
-  String upper = cmd;
-  upper.toUpperCase();
-  String response;
-  response.reserve(128);
-
-  if (upper.startsWith("SET_WIFI|") || upper.startsWith("WIFI:")) {
-    String ssid, pass;
-    if (upper.startsWith("SET_WIFI|")) {
-      String rest = cmd.substring(9);
-      int sep = rest.indexOf('|');
-      if (sep > 0) {
-        ssid = rest.substring(0, sep);
-        pass = rest.substring(sep + 1);
-      } else {
-        sendBLE("ERR:FORMAT\n");
-        LOG_ERROR(F("BLE: Invalid WiFi format"), millis() / 1000);
-        return;
-      }
-    } else {
-      String rest = cmd.substring(5);
-      int sep = rest.indexOf(',');
-      if (sep > 0) {
-        ssid = rest.substring(0, sep);
-        pass = rest.substring(sep + 1);
-      } else {
-        sendBLE("ERR:FORMAT\n");
-        LOG_ERROR(F("BLE: Invalid WiFi format"), millis() / 1000);
-        return;
-      }
-    }
-
-    if (pass.length() == 0 && wifiCredentials.hasCredentials) {
-      if (ssid.equals(String(wifiCredentials.ssid))) {
-
-        pass = String(wifiCredentials.password);
-        Serial.println(F("BLE: Preserving existing WiFi password (SSID unchanged)"));
-      }
-    }
-
-    saveWiFi(ssid, pass);
-    sendBLE("OK:WIFI_SAVED\n");
-    delay(100);
-
-    /* Acquire wifiMutex mutex (wait up to 1000ms) to safely access shared resource */
-    if (xSemaphoreTake(wifiMutex, pdMS_TO_TICKS(1000)) == pdTRUE) {
-      wifiManualDisconnect = false;
-      wifiReconnectAttempts = 0;
-      wifiConfigChanged = true;
-      wifiState = WIFI_STATE_IDLE;
-      xSemaphoreGive(wifiMutex);
-    }
-
-  } else if (upper.startsWith("SET_IP|")) {
-    String rest = cmd.substring(7);
-    if (rest.equalsIgnoreCase("DHCP")) {
-      netConfig.useDHCP = true;
-      saveNetworkConfig();
-      sendBLE("OK:DHCP_ON\n");
-      delay(100);
-
-      if (wifiCredentials.hasCredentials) {
-        /* Acquire wifiMutex mutex (wait up to 1000ms) to safely access shared resource */
-    if (xSemaphoreTake(wifiMutex, pdMS_TO_TICKS(1000)) == pdTRUE) {
-          wifiManualDisconnect = false;
-          wifiReconnectAttempts = 0;
-          wifiConfigChanged = true;
-          wifiState = WIFI_STATE_IDLE;
-          xSemaphoreGive(wifiMutex);
-        }
-      }
+void sendBLE(const String& m) {
+  sendBLE(m.c_str());
+}
 
-    } else if (rest.startsWith("STATIC|") || rest.startsWith("static|")) {
-      rest = rest.substring(7);
-      int p1 = rest.indexOf('|');
-      int p2 = rest.indexOf('|', p1 + 1);
-      int p3 = rest.indexOf('|', p2 + 1);
-
-      if (p1 > 0 && p2 > 0 && p3 > 0) {
-        String ip = rest.substring(0, p1);
-        String gw = rest.substring(p1 + 1, p2);
-        String sub = rest.substring(p2 + 1, p3);
-        String dns = rest.substring(p3 + 1);
-
-        if (isValidIP(ip) && isValidIP(gw)) {
-          netConfig.staticIP = parseIP(ip);
-          netConfig.gateway = parseIP(gw);
-          netConfig.subnet = isValidSubnet(sub) ? parseIP(sub) : IPAddress(255, 255, 255, 0);
-          netConfig.dns = isValidIP(dns) ? parseIP(dns) : IPAddress(8, 8, 8, 8);
-          netConfig.useDHCP = false;
-          saveNetworkConfig();
-          sendBLE("OK:STATIC_IP_SET\n");
-          delay(100);
-
-          if (wifiCredentials.hasCredentials) {
-            /* Acquire wifiMutex mutex (wait up to 1000ms) to safely access shared resource */
-    if (xSemaphoreTake(wifiMutex, pdMS_TO_TICKS(1000)) == pdTRUE) {
-              wifiManualDisconnect = false;
-              wifiReconnectAttempts = 0;
-              wifiConfigChanged = true;
-              wifiState = WIFI_STATE_IDLE;
-              xSemaphoreGive(wifiMutex);
-            }
-          }
-
-        } else {
-          sendBLE("ERR:INVALID_IP\n");
-          LOG_ERROR(F("BLE: Invalid IP address"), millis() / 1000);
-        }
-      } else {
-        sendBLE("ERR:FORMAT\n");
-        LOG_ERROR(F("BLE: Invalid IP format"), millis() / 1000);
-      }
-    } else {
+/* handleBLECommand: Dispatches one trimmed command line through the shared command registry */
+void handleBLECommand(char* cmd) {
+  CmdResult result = cmdDispatch(cmd, CMD_VIA_BLE, sendBLE);
+
+  switch (result) {
+    case CMD_ERR_UNKNOWN:
+    case CMD_ERR_TRANSPORT:
+      sendBLE("ERR:UNKNOWN_CMD\n");
+      LOG_ERROR(EVT_BLE_UNKNOWN_CMD, cmd);
+      break;
+    case CMD_ERR_FORMAT:
       sendBLE("ERR:FORMAT\n");
-      LOG_ERROR(F("BLE: Invalid SET_IP format"), millis() / 1000);
-    }
-
-  } else if (upper == "GET_STATUS" || upper == "STATUS") {
-    bool connected = (WiFi.status() == WL_CONNECTED);
-    response = "STATUS|";
-    response += connected ? "CONNECTED" : "DISCONNECTED";
-    response += "|" + WiFi.SSID() + "|";
-    response += connected ? WiFi.localIP().toString() : "-";
-    response += "|";
-    response += connected ? String(WiFi.RSSI()) : "-";
-    response += "|";
-    response += netConfig.useDHCP ? "DHCP" : "STATIC";
-    if (!netConfig.useDHCP) {
-      response += "|" + netConfig.staticIP.toString();
-    }
-    response += "\n";
-    sendBLE(response);
-
-  } else if (upper == "DISCONNECT_WIFI" || upper == "DISCONNECT") {
-    /* Acquire wifiMutex mutex (wait up to 1000ms) to safely access shared resource */
-    if (xSemaphoreTake(wifiMutex, pdMS_TO_TICKS(1000)) == pdTRUE) {
-      wifiManualDisconnect = true;
-      wifiState = WIFI_STATE_IDLE;
-      xSemaphoreGive(wifiMutex);
-    }
-    sendBLE("OK:WIFI_DISCONNECTED\n");
-
-  } else if (upper == "CLEAR_SAVED" || upper == "CLEAR_WIFI") {
-    prefs.remove("wifi_ssid");
-    prefs.remove("wifi_pass");
-    saveWiFi("", "");
-    /* Acquire wifiMutex mutex (wait up to 1000ms) to safely access shared resource */
-    if (xSemaphoreTake(wifiMutex, pdMS_TO_TICKS(1000)) == pdTRUE) {
-      wifiManualDisconnect = true;
-      wifiState = WIFI_STATE_IDLE;
-      xSemaphoreGive(wifiMutex);
-    }
-    sendBLE("OK:WIFI_CLEARED\n");
-    Serial.println(F("=== WiFi Credentials Cleared ==="));
-
-  } else if (upper == "RESTART") {
-    Serial.println(F("\n=== BLE: Restart Command Received ==="));
-    sendBLE("OK:RESTARTING\n");
-    delay(500);
-    #if DEBUG_MODE
-    prefs.putBool(NVS_FLAG_USER_REBOOT, true);
-    vTaskDelay(pdMS_TO_TICKS(100));
-    #endif
-    ESP.restart();
-
-  } else if (upper == "HEAP") {
-    response = "HEAP:FREE=" + String(ESP.getFreeHeap());
-    response += "|MIN=" + String(ESP.getMinFreeHeap());
-    response += "|MAX=" + String(ESP.getMaxAllocHeap()) + "\n";
-    sendBLE(response);
-
-  } else if (upper == "TEMP") {
-    float t = getInternalTemperatureC();
-    if (isnan(t)) {
-      sendBLE("TEMP:NOT_AVAILABLE\n");
-    } else {
-      sendBLE("TEMP:" + String(t, 2) + "\n");
-    }
-
-  } else {
-    sendBLE("ERR:UNKNOWN_CMD\n");
-    LOG_ERROR(String("BLE: Unknown cmd: ") + cmd, millis() / 1000);
+      LOG_ERROR(EVT_BLE_BAD_FORMAT);
+      break;
+    default:
+      break;
   }
 }
 
-static String cleanString(const String& input) {
-  if (input.length() == 0) return String();
-  const char* str = input.c_str();
-  int len = input.length();
-  int start = 0, end = len - 1;
-
-  while (start < len && isspace((unsigned char)str[start])) start++;
-  while (end >= start && isspace((unsigned char)str[end])) end--;
-
-  return (start > end) ? String() : input.substring(start, end + 1);
-}
-
-static bool isValidIP(const String& s) {
-  IPAddress ip;
-  if (!ip.fromString(s)) return false;
-  return !(ip[0] == 0 && ip[1] == 0 && ip[2] == 0 && ip[3] == 0);
-}
-
-static bool isValidSubnet(const String& s) {
-  IPAddress sub;
-  if (!sub.fromString(s)) return false;
-  uint32_t m = ~(uint32_t)sub;
-  return (m & (m + 1)) == 0;
-}
-
-static IPAddress parseIP(const String& s) {
-  IPAddress ip;
-  if (ip.fromString(s)) return ip;
-
-  int p[4] = { 0 };
-  int idx = 0, st = 0;
-  for (int i = 0; i <= (int)s.length() && idx < 4; i++) {
-    if (i == (int)s.length() || s[i] == '.') {
-      p[idx++] = s.substring(st, i).toInt();
-      st = i + 1;
-    }
-  }
-  return IPAddress(p[0], p[1], p[2], p[3]);
+static char* trimInPlace(char* str) {
+  while (isspace((unsigned char)*str)) str++;
+  char* end = str + strlen(str);
+  while (end > str && isspace((unsigned char)end[-1])) end--;
+  *end = '\0';
+  return str;
 }
 
 #else
@@ -416,6 +221,7 @@ static IPAddress parseIP(const String& s) {
 /* initBLE: Initializes Bluetooth Low Energy server with custom service for configuration */
 void initBLE() {}
 void handleBLEReconnect() {}
+void sendBLE(const char* m) { (void)m; }
 void sendBLE(const String& m) { (void)m; }
-void handleBLECommand(String cmd) { (void)cmd; }
+void handleBLECommand(char* cmd) { (void)cmd; }
 #endif
\ No newline at end of file
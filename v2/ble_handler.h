@@ -20,8 +20,10 @@ void initBLE();
 
 void handleBLEReconnect();
 
+void sendBLE(const char* msg);
+
 void sendBLE(const String& msg);
 
-void handleBLECommand(String cmd);
+void handleBLECommand(char* cmd);
 
 #endif
\ No newline at end of file
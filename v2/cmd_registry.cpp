@@ -0,0 +1,392 @@
+/* ==============================================================================
+   CMD_REGISTRY.CPP - Command Registry Implementation
+
+   Holds the command handlers and the constexpr command table. At compile
+   time a seed is searched for which the FNV-1a hash of every (lower-case)
+   verb lands in a distinct slot of a small power-of-two table, so a lookup
+   is one hash, one table read and one string compare.
+
+   Command line format: <verb>[<delim><args>] where delim is one of "|: ".
+   Arguments are split on the entry's own separator, in place, without any
+   heap allocation. Handlers reply through the caller-supplied reply hook.
+   ============================================================================== */
+
+#include "cmd_registry.h"
+#include "globals.h"
+#include "wifi_handler.h"
+#include "hardware.h"
+#include "network_utils.h"
+#include "debug_handler.h"
+#include "web_handler.h"
+
+#define CMD_VERB_DELIMS "|: "
+#define CMD_SLOT_COUNT 64
+#define CMD_SLOT_MASK (CMD_SLOT_COUNT - 1)
+#define CMD_SLOT_EMPTY 0xFF
+
+static CmdResult cmdSetWifi(CmdContext& ctx);
+static CmdResult cmdSetIp(CmdContext& ctx);
+static CmdResult cmdStatus(CmdContext& ctx);
+static CmdResult cmdDisconnect(CmdContext& ctx);
+static CmdResult cmdClearWifi(CmdContext& ctx);
+static CmdResult cmdRestart(CmdContext& ctx);
+static CmdResult cmdHeap(CmdContext& ctx);
+static CmdResult cmdTemp(CmdContext& ctx);
+static CmdResult cmdBizStart(CmdContext& ctx);
+static CmdResult cmdBizStop(CmdContext& ctx);
+static CmdResult cmdPing(CmdContext& ctx);
+
+/* Verbs must be lower-case; matching is case-insensitive */
+static constexpr CmdEntry kCommands[] = {
+  { "set_wifi",        cmdSetWifi,    { '|', 2, 2 }, CMD_VIA_BLE,                0 },
+  { "wifi",            cmdSetWifi,    { ',', 2, 2 }, CMD_VIA_BLE,                0 },
+  { "set_ip",          cmdSetIp,      { '|', 1, 5 }, CMD_VIA_BLE,                0 },
+  { "get_status",      cmdStatus,     { 0, 0, 0 },   CMD_VIA_BLE,                0 },
+  { "status",          cmdStatus,     { 0, 0, 0 },   CMD_VIA_BLE,                0 },
+  { "disconnect_wifi", cmdDisconnect, { 0, 0, 0 },   CMD_VIA_BLE,                0 },
+  { "disconnect",      cmdDisconnect, { 0, 0, 0 },   CMD_VIA_BLE,                0 },
+  { "clear_saved",     cmdClearWifi,  { 0, 0, 0 },   CMD_VIA_BLE,                0 },
+  { "clear_wifi",      cmdClearWifi,  { 0, 0, 0 },   CMD_VIA_BLE,                0 },
+  { "restart",         cmdRestart,    { 0, 0, 0 },   CMD_VIA_BLE | CMD_VIA_HTTP, CMD_FLAG_CONTROL },
+  { "reboot",          cmdRestart,    { 0, 0, 0 },   CMD_VIA_BLE | CMD_VIA_HTTP, CMD_FLAG_CONTROL },
+  { "reset",           cmdRestart,    { 0, 0, 0 },   CMD_VIA_BLE | CMD_VIA_HTTP, CMD_FLAG_CONTROL },
+  { "start",           cmdBizStart,   { 0, 0, 0 },   CMD_VIA_BLE | CMD_VIA_HTTP, CMD_FLAG_CONTROL },
+  { "stop",            cmdBizStop,    { 0, 0, 0 },   CMD_VIA_BLE | CMD_VIA_HTTP, CMD_FLAG_CONTROL },
+  { "heap",            cmdHeap,       { 0, 0, 0 },   CMD_VIA_BLE,                0 },
+  { "temp",            cmdTemp,       { 0, 0, 0 },   CMD_VIA_BLE,                0 },
+  { "ping",            cmdPing,       { 0, 0, 0 },   CMD_VIA_BLE | CMD_VIA_HTTP, 0 },
+};
+
+static constexpr size_t kCommandCount = sizeof(kCommands) / sizeof(kCommands[0]);
+static_assert(kCommandCount < CMD_SLOT_EMPTY, "Too many commands for 8-bit slot index");
+static_assert(kCommandCount * 2 <= CMD_SLOT_COUNT, "Grow CMD_SLOT_COUNT to keep the table sparse");
+
+/* ============================================================================
+   COMPILE-TIME PERFECT HASH
+   ============================================================================ */
+
+static constexpr char foldCase(char c) {
+  return (c >= 'A' && c <= 'Z') ? (char)(c + ('a' - 'A')) : c;
+}
+
+static constexpr size_t constLength(const char* s) {
+  size_t n = 0;
+  while (s[n] != '\0') n++;
+  return n;
+}
+
+static constexpr uint32_t cmdHash(const char* s, size_t len, uint32_t seed) {
+  uint32_t h = 2166136261u ^ seed;
+  for (size_t i = 0; i < len; i++) {
+    h ^= (uint8_t)foldCase(s[i]);
+    h *= 16777619u;
+  }
+  h ^= h >> 15;
+  h *= 0x2c1b3c6du;
+  h ^= h >> 12;
+  return h;
+}
+
+struct CmdSlotTable {
+  uint8_t index[CMD_SLOT_COUNT];
+};
+
+static constexpr bool seedIsPerfect(uint32_t seed) {
+  bool used[CMD_SLOT_COUNT] = {};
+  for (size_t i = 0; i < kCommandCount; i++) {
+    size_t len = constLength(kCommands[i].verb);
+    if (len == 0 || len > CMD_VERB_MAX) return false;
+    uint32_t slot = cmdHash(kCommands[i].verb, len, seed) & CMD_SLOT_MASK;
+    if (used[slot]) return false;
+    used[slot] = true;
+  }
+  return true;
+}
+
+static constexpr uint32_t findSeed() {
+  for (uint32_t seed = 0; seed < 4096; seed++) {
+    if (seedIsPerfect(seed)) return seed;
+  }
+  return 0xFFFFFFFFu;
+}
+
+static constexpr uint32_t kSeed = findSeed();
+static_assert(kSeed != 0xFFFFFFFFu, "No perfect hash seed found for command table");
+
+static constexpr CmdSlotTable buildSlots() {
+  CmdSlotTable table = {};
+  for (size_t s = 0; s < CMD_SLOT_COUNT; s++) table.index[s] = CMD_SLOT_EMPTY;
+  for (size_t i = 0; i < kCommandCount; i++) {
+    const char* verb = kCommands[i].verb;
+    table.index[cmdHash(verb, constLength(verb), kSeed) & CMD_SLOT_MASK] = (uint8_t)i;
+  }
+  return table;
+}
+
+static constexpr CmdSlotTable kSlots = buildSlots();
+
+/* ============================================================================
+   LOOKUP AND DISPATCH
+   ============================================================================ */
+
+const CmdEntry* cmdLookup(const char* verb, size_t len) {
+  if (len == 0 || len > CMD_VERB_MAX) return nullptr;
+
+  uint8_t index = kSlots.index[cmdHash(verb, len, kSeed) & CMD_SLOT_MASK];
+  if (index == CMD_SLOT_EMPTY) return nullptr;
+
+  const CmdEntry* entry = &kCommands[index];
+  if (strncasecmp(entry->verb, verb, len) != 0 || entry->verb[len] != '\0') return nullptr;
+  return entry;
+}
+
+const CmdEntry* cmdFind(const char* line) {
+  return cmdLookup(line, strcspn(line, CMD_VERB_DELIMS));
+}
+
+static uint8_t splitArgs(char* rest, const CmdArgSchema& schema, char** argv) {
+  uint8_t limit = schema.maxArgs > 0 ? schema.maxArgs : 1;
+  uint8_t argc = 0;
+  char* p = rest;
+
+  while (argc < limit) {
+    argv[argc++] = p;
+    if (argc == limit) break;
+    char* sep = strchr(p, schema.sep);
+    if (!sep) break;
+    *sep = '\0';
+    p = sep + 1;
+  }
+  return argc;
+}
+
+static uint8_t countArgs(const char* rest, const CmdArgSchema& schema) {
+  uint8_t limit = schema.maxArgs > 0 ? schema.maxArgs : 1;
+  uint8_t argc = 1;
+  for (const char* p = rest; *p && argc < limit; p++) {
+    if (*p == schema.sep) argc++;
+  }
+  return argc;
+}
+
+CmdResult cmdValidate(const char* line, CmdTransport transport) {
+  size_t verbLen = strcspn(line, CMD_VERB_DELIMS);
+  const CmdEntry* entry = cmdLookup(line, verbLen);
+  if (!entry) return CMD_ERR_UNKNOWN;
+  if (!(entry->transports & transport)) return CMD_ERR_TRANSPORT;
+
+  uint8_t argc = (line[verbLen] != '\0') ? countArgs(line + verbLen + 1, entry->args) : 0;
+  if (argc < entry->args.minArgs || argc > entry->args.maxArgs) return CMD_ERR_FORMAT;
+  return CMD_OK;
+}
+
+CmdResult cmdDispatch(char* line, CmdTransport transport, CmdReplyFn reply) {
+  size_t verbLen = strcspn(line, CMD_VERB_DELIMS);
+  const CmdEntry* entry = cmdLookup(line, verbLen);
+  if (!entry) return CMD_ERR_UNKNOWN;
+  if (!(entry->transports & transport)) return CMD_ERR_TRANSPORT;
+
+  CmdContext ctx;
+  ctx.transport = transport;
+  ctx.reply = reply;
+  ctx.argc = 0;
+  if (line[verbLen] != '\0') {
+    line[verbLen] = '\0';
+    ctx.argc = splitArgs(line + verbLen + 1, entry->args, ctx.argv);
+  }
+  if (ctx.argc < entry->args.minArgs || ctx.argc > entry->args.maxArgs) return CMD_ERR_FORMAT;
+
+  return entry->handler(ctx);
+}
+
+const char* cmdResultName(CmdResult result) {
+  switch (result) {
+    case CMD_OK: return "ok";
+    case CMD_ERR_UNKNOWN: return "unknown command";
+    case CMD_ERR_TRANSPORT: return "command not allowed";
+    case CMD_ERR_FORMAT: return "bad arguments";
+    case CMD_ERR_INVALID: return "invalid arguments";
+    default: return "error";
+  }
+}
+
+/* ============================================================================
+   COMMAND HANDLERS
+   ============================================================================ */
+
+static void replyText(CmdContext& ctx, const char* text) {
+  if (ctx.reply) ctx.reply(text);
+}
+
+static void requestWiFiReconnect() {
+  /* Acquire wifiMutex mutex (wait up to 1000ms) to safely access shared resource */
+  if (xSemaphoreTake(wifiMutex, pdMS_TO_TICKS(1000)) == pdTRUE) {
+    wifiManualDisconnect = false;
+    wifiReconnectAttempts = 0;
+    wifiConfigChanged = true;
+    wifiState = WIFI_STATE_IDLE;
+    xSemaphoreGive(wifiMutex);
+  }
+}
+
+static void requestWiFiDisconnect() {
+  /* Acquire wifiMutex mutex (wait up to 1000ms) to safely access shared resource */
+  if (xSemaphoreTake(wifiMutex, pdMS_TO_TICKS(1000)) == pdTRUE) {
+    wifiManualDisconnect = true;
+    wifiState = WIFI_STATE_IDLE;
+    xSemaphoreGive(wifiMutex);
+  }
+}
+
+static CmdResult cmdSetWifi(CmdContext& ctx) {
+  const char* ssid = ctx.argv[0];
+  const char* pass = ctx.argv[1];
+  if (ssid[0] == '\0') return CMD_ERR_FORMAT;
+
+  if (pass[0] == '\0' && wifiCredentials.hasCredentials &&
+      strcmp(ssid, wifiCredentials.ssid) == 0) {
+    pass = wifiCredentials.password;
+    Serial.println(F("CMD: Preserving existing WiFi password (SSID unchanged)"));
+  }
+
+  saveWiFi(ssid, pass);
+  replyText(ctx, "OK:WIFI_SAVED\n");
+  delay(100);
+  requestWiFiReconnect();
+  return CMD_OK;
+}
+
+static CmdResult cmdSetIp(CmdContext& ctx) {
+  if (strcasecmp(ctx.argv[0], "DHCP") == 0) {
+    if (ctx.argc != 1) return CMD_ERR_FORMAT;
+    netConfig.useDHCP = true;
+    saveNetworkConfig();
+    replyText(ctx, "OK:DHCP_ON\n");
+    delay(100);
+    if (wifiCredentials.hasCredentials) requestWiFiReconnect();
+    return CMD_OK;
+  }
+
+  if (strcasecmp(ctx.argv[0], "STATIC") != 0 || ctx.argc != 5) return CMD_ERR_FORMAT;
+
+  const char* ip = ctx.argv[1];
+  const char* gw = ctx.argv[2];
+  const char* sub = ctx.argv[3];
+  const char* dns = ctx.argv[4];
+
+  if (!isValidIP(ip) || !isValidIP(gw)) {
+    replyText(ctx, "ERR:INVALID_IP\n");
+    LOG_ERROR(EVT_CMD_BAD_IP);
+    return CMD_ERR_INVALID;
+  }
+
+  netConfig.staticIP = parseIP(ip);
+  netConfig.gateway = parseIP(gw);
+  netConfig.subnet = isValidSubnet(sub) ? parseIP(sub) : IPAddress(255, 255, 255, 0);
+  netConfig.dns = isValidIP(dns) ? parseIP(dns) : IPAddress(8, 8, 8, 8);
+  netConfig.useDHCP = false;
+  saveNetworkConfig();
+  replyText(ctx, "OK:STATIC_IP_SET\n");
+  delay(100);
+  if (wifiCredentials.hasCredentials) requestWiFiReconnect();
+  return CMD_OK;
+}
+
+static CmdResult cmdStatus(CmdContext& ctx) {
+  bool connected = (WiFi.status() == WL_CONNECTED);
+  char ipBuf[16] = "-";
+  char rssiBuf[8] = "-";
+  if (connected) {
+    IPAddress ip = WiFi.localIP();
+    snprintf(ipBuf, sizeof(ipBuf), "%u.%u.%u.%u", ip[0], ip[1], ip[2], ip[3]);
+    snprintf(rssiBuf, sizeof(rssiBuf), "%d", (int)WiFi.RSSI());
+  }
+
+  char response[160];
+  int n = snprintf(response, sizeof(response), "STATUS|%s|%s|%s|%s|%s",
+                   connected ? "CONNECTED" : "DISCONNECTED",
+                   WiFi.SSID().c_str(), ipBuf, rssiBuf,
+                   netConfig.useDHCP ? "DHCP" : "STATIC");
+  if (!netConfig.useDHCP && n > 0 && n < (int)sizeof(response)) {
+    IPAddress sip = netConfig.staticIP;
+    n += snprintf(response + n, sizeof(response) - n, "|%u.%u.%u.%u", sip[0], sip[1], sip[2], sip[3]);
+  }
+  if (n > 0 && n < (int)sizeof(response) - 1) {
+    response[n] = '\n';
+    response[n + 1] = '\0';
+  }
+  replyText(ctx, response);
+  return CMD_OK;
+}
+
+static CmdResult cmdDisconnect(CmdContext& ctx) {
+  requestWiFiDisconnect();
+  replyText(ctx, "OK:WIFI_DISCONNECTED\n");
+  return CMD_OK;
+}
+
+static CmdResult cmdClearWifi(CmdContext& ctx) {
+  prefs.remove("wifi_ssid");
+  prefs.remove("wifi_pass");
+  saveWiFi("", "");
+  requestWiFiDisconnect();
+  replyText(ctx, "OK:WIFI_CLEARED\n");
+  Serial.println(F("=== WiFi Credentials Cleared ==="));
+  return CMD_OK;
+}
+
+static CmdResult cmdRestart(CmdContext& ctx) {
+  Serial.println(F("\n=== Restart command received, restarting in 500ms ==="));
+  replyText(ctx, "OK:RESTARTING\n");
+  vTaskDelay(pdMS_TO_TICKS(500));
+  #if DEBUG_MODE
+  prefs.putBool(NVS_FLAG_USER_REBOOT, true);
+  prefs.end();
+  delay(50);
+  prefs.begin("esp32_base", false);
+  #endif
+  ESP.restart();
+  return CMD_OK;
+}
+
+static CmdResult cmdHeap(CmdContext& ctx) {
+  char response[64];
+  snprintf(response, sizeof(response), "HEAP:FREE=%u|MIN=%u|MAX=%u\n",
+           (unsigned)ESP.getFreeHeap(), (unsigned)ESP.getMinFreeHeap(),
+           (unsigned)ESP.getMaxAllocHeap());
+  replyText(ctx, response);
+  return CMD_OK;
+}
+
+static CmdResult cmdTemp(CmdContext& ctx) {
+  float t = getInternalTemperatureC();
+  if (isnan(t)) {
+    replyText(ctx, "TEMP:NOT_AVAILABLE\n");
+  } else {
+    char response[24];
+    snprintf(response, sizeof(response), "TEMP:%.2f\n", t);
+    replyText(ctx, response);
+  }
+  return CMD_OK;
+}
+
+static CmdResult cmdBizStart(CmdContext& ctx) {
+  if (isOtaActive()) {
+    replyText(ctx, "ERR:OTA_ACTIVE\n");
+    return CMD_ERR_INVALID;
+  }
+  gBizState = BIZ_RUNNING;
+  replyText(ctx, "OK:BIZ_STARTED\n");
+  return CMD_OK;
+}
+
+static CmdResult cmdBizStop(CmdContext& ctx) {
+  gBizState = BIZ_STOPPED;
+  replyText(ctx, "OK:BIZ_STOPPED\n");
+  return CMD_OK;
+}
+
+static CmdResult cmdPing(CmdContext& ctx) {
+  replyText(ctx, "PONG\n");
+  return CMD_OK;
+}
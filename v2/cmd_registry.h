@@ -0,0 +1,76 @@
+/* ==============================================================================
+   CMD_REGISTRY.H - Command Registry Interface
+
+   Single table of text commands shared by every entry point:
+   - HTTP /api/exec (executed by bizTask)
+   - BLE RX characteristic
+   Each entry carries its handler, argument schema, allowed transports and
+   flags (e.g. whether it travels on the control lane).
+
+   Lookup is a compile-time perfect hash on the case-folded verb, so dispatch
+   is O(1) and allocation-free. Adding a command means adding one table row.
+   ============================================================================== */
+
+/* Header guard to prevent multiple inclusion of cmd_registry.h */
+#ifndef CMD_REGISTRY_H
+#define CMD_REGISTRY_H
+
+#include <Arduino.h>
+
+#define CMD_MAX_ARGS 5
+#define CMD_VERB_MAX 16
+
+/* Control commands bypass queued bulk work (see exec_queue.h) */
+#define CMD_FLAG_CONTROL 0x01
+
+enum CmdTransport : uint8_t {
+  CMD_VIA_HTTP = 0x01,
+  CMD_VIA_BLE = 0x02
+};
+
+/* CMD_ERR_INVALID means the handler rejected the arguments and already replied */
+enum CmdResult : uint8_t {
+  CMD_OK = 0,
+  CMD_ERR_UNKNOWN,
+  CMD_ERR_TRANSPORT,
+  CMD_ERR_FORMAT,
+  CMD_ERR_INVALID
+};
+
+typedef void (*CmdReplyFn)(const char* text);
+
+struct CmdContext {
+  CmdTransport transport;
+  uint8_t argc;
+  char* argv[CMD_MAX_ARGS];
+  CmdReplyFn reply;
+};
+
+typedef CmdResult (*CmdHandler)(CmdContext& ctx);
+
+/* The last argument keeps the remainder of the line, separators included */
+struct CmdArgSchema {
+  char sep;
+  uint8_t minArgs;
+  uint8_t maxArgs;
+};
+
+struct CmdEntry {
+  const char* verb;
+  CmdHandler handler;
+  CmdArgSchema args;
+  uint8_t transports;
+  uint8_t flags;
+};
+
+const CmdEntry* cmdLookup(const char* verb, size_t len);
+
+const CmdEntry* cmdFind(const char* line);
+
+CmdResult cmdValidate(const char* line, CmdTransport transport);
+
+CmdResult cmdDispatch(char* line, CmdTransport transport, CmdReplyFn reply);
+
+const char* cmdResultName(CmdResult result);
+
+#endif
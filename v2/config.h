@@ -2,7 +2,9 @@
    CONFIG.H - System Configuration
    
    Contains all configurable parameters for the ESP32 system including:
-   - Feature enable/disable flags (DEBUG_MODE, ENABLE_OTA)
+   - Feature enable/disable flags (DEBUG_MODE, ENABLE_OTA, ENABLE_BENCH,
+     ENABLE_METRICS_HISTORY, ENABLE_OPENMETRICS, ENABLE_TASK_TOP, ENABLE_TRACE,
+     ENABLE_HEAP_TRACK, ENABLE_LOG_STORE), overridable from the build
    - Timing parameters (timeouts, intervals)
    - Hardware-specific settings (LED pins, chip capabilities)
    - Network settings (NTP servers, WiFi parameters)
@@ -14,19 +16,89 @@
 #ifndef CONFIG_H
 #define CONFIG_H
 
+/* Feature flags; each may be overridden with -D (host/CMakeLists.txt does) */
+#ifndef DEBUG_MODE
 #define DEBUG_MODE 1
+#endif
+#ifndef ENABLE_OTA
 #define ENABLE_OTA 1
+#endif
+#ifndef ENABLE_BENCH
+#define ENABLE_BENCH 0
+#endif
+#ifndef ENABLE_METRICS_HISTORY
+#define ENABLE_METRICS_HISTORY 1
+#endif
+#ifndef ENABLE_OPENMETRICS
+#define ENABLE_OPENMETRICS 1
+#endif
+#ifndef ENABLE_TASK_TOP
+#define ENABLE_TASK_TOP 1
+#endif
+#ifndef ENABLE_TRACE
+#define ENABLE_TRACE 0
+#endif
+#ifndef ENABLE_HEAP_TRACK
+#define ENABLE_HEAP_TRACK 1
+#endif
+#ifndef ENABLE_LOG_STORE
+#define ENABLE_LOG_STORE 1
+#endif
 
 #define WDT_TIMEOUT 20
 #define STACK_CHECK_INTERVAL 60000
 #define WIFI_RECONNECT_DELAY 15000
 #define WIFI_CONNECT_TIMEOUT 30000
 #define MAX_WIFI_RECONNECT_ATTEMPTS 5
+#define STATS_SAMPLE_INTERVAL_MS 500
 
-#define MSG_POOL_SIZE 10
+#define MSG_POOL_SIZE 32
+#define MSG_POOL_CONTROL_SLOTS 2
 #define MAX_MSG_SIZE 256
+
+/* Payload slab classes (bytes incl. terminator x blocks); largest must equal MAX_MSG_SIZE */
+#define MSG_SLAB_SMALL_SIZE 32
+#define MSG_SLAB_SMALL_COUNT 24
+#define MSG_SLAB_MEDIUM_SIZE 96
+#define MSG_SLAB_MEDIUM_COUNT 8
+#define MSG_SLAB_LARGE_SIZE MAX_MSG_SIZE
+#define MSG_SLAB_LARGE_COUNT 4
 #define MAX_BLE_CMD_LENGTH 256
 
+#define BIZ_BATCH_MAX MSG_POOL_SIZE
+#define EXEC_BATCH_MAX 16
+#define EXEC_RESULT_SLOTS 64
+#define EXEC_RESULT_WAIT_MAX_MS 2000
+#define BIZ_LOG_COMMANDS 0
+
+#if ENABLE_BENCH
+  #define BENCH_MAX_COMMANDS 1000000
+  #define BENCH_TASK_STACK 3072
+#endif
+
+/* Load history rings (buckets per resolution) and tasks kept per bucket */
+#if ENABLE_METRICS_HISTORY
+  #define METRICS_HIST_1S_BUCKETS 60
+  #define METRICS_HIST_10S_BUCKETS 60
+  #define METRICS_HIST_60S_BUCKETS 120
+  #define METRICS_TOP_TASKS 4
+  #define METRICS_TASK_NAMES 24
+#endif
+
+/* Timeline trace: 8-byte events per core ring (power of two), 8 KB each at 1024 */
+#if ENABLE_TRACE
+  #define TRACE_EVENTS_PER_CORE 1024
+#endif
+
+/* Heap accounting: fragmentation sampled every 5s, kept 1 hour at 1 min and 28 days at 4 h (~6.4 KB) */
+#if ENABLE_HEAP_TRACK
+  #define HEAP_SAMPLE_INTERVAL_MS 5000
+  #define HEAP_HIST_SHORT_SEC 60
+  #define HEAP_HIST_SHORT_POINTS 60
+  #define HEAP_HIST_LONG_SEC 14400
+  #define HEAP_HIST_LONG_POINTS 168
+#endif
+
 #define NTP_SERVER_1 "pool.ntp.org"
 #define NTP_SERVER_2 "time.nist.gov"
 #define NTP_SERVER_3 "time.google.com"
@@ -37,6 +109,30 @@
 #if DEBUG_MODE
   #define MAX_DEBUG_LOGS 32
   #define FLASH_WRITE_QUEUE_SIZE 32
+  #define MAX_TASKS_MONITORED 64
+
+  /* Append-only log store: data partition label (unused "spiffs" in the stock Arduino
+     schemes; point it elsewhere if the sketch mounts a filesystem) and 4 KB segments used */
+  #define LOG_STORE_PARTITION "spiffs"
+  #define LOG_STORE_SEGMENTS 8
+
+  /* Stack monitor: tracked names, peak history per task, health as % of the stack left free */
+  #define STACK_TRACK_MAX 32
+  #define STACK_TREND_POINTS 6
+  #define STACK_OK_FREE_PCT 40
+  #define STACK_LOW_FREE_PCT 20
+  #define STACK_CRITICAL_FREE_PCT 10
+  #define STACK_HEADROOM_PCT 25
+  #define STACK_HEADROOM_MIN 512
+#endif
+
+/* Lean top-N task CPU tracking for production builds; DEBUG_MODE already tracks every task */
+#if DEBUG_MODE
+  #undef ENABLE_TASK_TOP
+  #define ENABLE_TASK_TOP 0
+#else
+  #define CPU_MONITOR_MAX_TASKS 32
+  #define TASK_TOP_N 5
 #endif
 
 #if defined(CONFIG_IDF_TARGET_ESP32C3)
@@ -109,4 +205,19 @@
   #define NUM_CORES 2
 #endif
 
+/* Biz worker pool; worker i runs on core (i + 1) % NUM_CORES */
+#define BIZ_WORKERS NUM_CORES
+#define BIZ_TASK_STACK 4096
+
+/* Task stacks in bytes; the stack monitor measures each task against its entry here */
+#define WEB_TASK_STACK 10240
+#if NUM_CORES > 1
+  #define SYS_TASK_STACK 12288
+#else
+  #define SYS_TASK_STACK 10240
+#endif
+#define STATS_TASK_STACK 4096
+#define FLASH_TASK_STACK 3072
+#define OTA_TASK_STACK 20480
+
 #endif
@@ -7,8 +7,12 @@
               statistics, identifies which tasks consume most CPU time
    
    Non-DEBUG: Lightweight idle task monitoring for basic CPU load indication
+              and, with ENABLE_TASK_TOP, the TASK_TOP_N busiest tasks. Only a
+              handle, a counter and a name hash are kept per task; names and
+              affinity are resolved for the winners alone.
    
    Used for performance optimization and system health monitoring.
+   updateCpuLoad() is driven by statsTask every STATS_SAMPLE_INTERVAL_MS.
    ============================================================================== */
 
 #include "cpu_monitor.h"
@@ -19,118 +23,190 @@
   #include "debug_handler.h"
 #endif
 
-static uint32_t lastCpuUpdate = 0;
-
 #if !DEBUG_MODE
+#include <esp_timer.h>
+#include <atomic>
+
+/* statsTask is the only caller, so the snapshot buffer need not live on its stack */
+static TaskStatus_t taskStatus[CPU_MONITOR_MAX_TASKS];
 static uint32_t prevIdleRuntime[2] = {0, 0};
-static uint32_t prevTotalRuntime[2] = {0, 0};
+static int64_t lastSampleUs = 0;
 static bool cpuInitialized = false;
 #endif
 
-void updateCpuLoad() {
-  uint32_t now = millis();
-  
+#if ENABLE_TASK_TOP
+/* Last runtime counter per task; the name hash tells a reused TCB from the task it replaced */
+struct TaskDelta {
+  TaskHandle_t handle;
+  uint32_t prevRuntime;
+  uint32_t nameHash;
+};
+
+static TaskDelta deltaBuf[2][CPU_MONITOR_MAX_TASKS];
+static uint8_t deltaCount = 0;
+static uint8_t deltaCur = 0;
+
+static TaskTopEntry topTasks[TASK_TOP_N];
+static uint8_t topCount = 0;
+static uint32_t topSampleMs = 0;
+static std::atomic<uint32_t> topSeq{0};
+
+static uint32_t nameHash(const char* name) {
+  uint32_t h = 2166136261u;
+  for (uint8_t i = 0; i < configMAX_TASK_NAME_LEN && name[i]; i++) {
+    h = (h ^ (uint8_t)name[i]) * 16777619u;
+  }
+  return h;
+}
 
-  if (now - lastCpuUpdate < 500) return;
-  lastCpuUpdate = now;
+static inline BaseType_t getSafeAffinity(TaskHandle_t handle) {
+#if CONFIG_FREERTOS_UNICORE
+  (void)handle;
+  return 0;
+#else
+  if (handle == nullptr) return tskNO_AFFINITY;
+  return xTaskGetAffinity(handle);
+#endif
+}
 
-#if DEBUG_MODE
+/* updateTaskTop: Delta per task against the previous sample, keeping only the TASK_TOP_N largest */
+static void updateTaskTop(UBaseType_t numTasks, uint64_t periodUs) {
+  const TaskDelta* prev = deltaBuf[deltaCur];
+  TaskDelta* next = deltaBuf[deltaCur ^ 1];
 
-  
-  updateTaskMonitoring();
-  
+  uint8_t best[TASK_TOP_N];
+  uint32_t bestDelta[TASK_TOP_N];
+  uint8_t bestCount = 0;
 
-  for (uint8_t i = 0; i < taskCount; i++) {
-    const char* taskName = taskData[i].name.c_str();
-    
+  for (UBaseType_t j = 0; j < numTasks; j++) {
+    const TaskStatus_t& status = taskStatus[j];
+    uint32_t hash = nameHash(status.pcTaskName);
 
-    if (strcmp(taskName, "IDLE") == 0 || strcmp(taskName, "IDLE0") == 0) {
-      uint8_t idlePercent = taskData[i].cpuPercent;
-      coreLoadPct[0] = (idlePercent > 100) ? 0 : (100 - idlePercent);
+    /* The scheduler lists rarely reorder between samples, so try the same position first */
+    int p = -1;
+    if (j < deltaCount && prev[j].handle == status.xHandle) {
+      p = j;
+    } else {
+      for (uint8_t k = 0; k < deltaCount; k++) {
+        if (prev[k].handle == status.xHandle) {
+          p = k;
+          break;
+        }
+      }
     }
-    
-    #if NUM_CORES > 1
 
-    if (strcmp(taskName, "IDLE1") == 0) {
-      uint8_t idlePercent = taskData[i].cpuPercent;
-      coreLoadPct[1] = (idlePercent > 100) ? 0 : (100 - idlePercent);
+    /* Per-task counters start at 0, so a task new since the last sample counts its whole life */
+    uint32_t base = (p >= 0 && prev[p].nameHash == hash) ? prev[p].prevRuntime : 0;
+    uint32_t delta = status.ulRunTimeCounter - base;
+    /* Same name on a reused TCB: the counter went backwards, which as a modular delta is more than
+       any task could run on every core in the period (a genuine 2^32 wrap is not). Restart it */
+    uint64_t maxUs = periodUs * NUM_CORES;
+    if (maxUs > 0 ? delta > maxUs + maxUs / 16 : status.ulRunTimeCounter < base) {
+      delta = status.ulRunTimeCounter;
+    }
+    next[j].handle = status.xHandle;
+    next[j].prevRuntime = status.ulRunTimeCounter;
+    next[j].nameHash = hash;
+
+    if (periodUs == 0 || strncmp(status.pcTaskName, "IDLE", 4) == 0) continue;
+
+    uint8_t pos = bestCount;
+    while (pos > 0 && bestDelta[pos - 1] < delta) pos--;
+    if (pos >= TASK_TOP_N) continue;
+    uint8_t last = (bestCount < TASK_TOP_N) ? bestCount++ : TASK_TOP_N - 1;
+    for (uint8_t k = last; k > pos; k--) {
+      best[k] = best[k - 1];
+      bestDelta[k] = bestDelta[k - 1];
     }
-    #endif
+    best[pos] = j;
+    bestDelta[pos] = delta;
   }
+  deltaCount = numTasks;
+  deltaCur ^= 1;
+  if (periodUs == 0) return;
+
+  uint32_t seq = topSeq.load(std::memory_order_relaxed);
+  topSeq.store(seq + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+
+  for (uint8_t i = 0; i < bestCount; i++) {
+    const TaskStatus_t& status = taskStatus[best[i]];
+    TaskTopEntry& e = topTasks[i];
+    strncpy(e.name, status.pcTaskName, sizeof(e.name) - 1);
+    e.name[sizeof(e.name) - 1] = '\0';
+    /* Affinity is only looked up for the winners; an unpinned task may have run on any core */
+    e.core = getSafeAffinity(status.xHandle);
+    uint64_t capacityUs = periodUs * ((e.core == tskNO_AFFINITY) ? NUM_CORES : 1);
+    uint64_t percentage = ((uint64_t)bestDelta[i] * 100ULL) / capacityUs;
+    e.cpuPercent = (percentage > 100) ? 100 : (uint8_t)percentage;
+  }
+  topCount = bestCount;
+  topSampleMs = millis();
 
-#else
-
-  
-  TaskStatus_t taskStatus[32];
-  UBaseType_t numTasks = uxTaskGetSystemState(taskStatus, 32, NULL);
-  
-  if (numTasks == 0) return;
-  
+  topSeq.store(seq + 2, std::memory_order_release);
+}
 
-  uint32_t idleRuntime[2] = {0, 0};
-  uint32_t totalRuntime[2] = {0, 0};
-  
-  for (UBaseType_t i = 0; i < numTasks; i++) {
-    const char* taskName = taskStatus[i].pcTaskName;
-    uint32_t runtime = taskStatus[i].ulRunTimeCounter;
-    
-
-    #if NUM_CORES > 1
-      BaseType_t affinity = xTaskGetAffinity(taskStatus[i].xHandle);
-    #else
-      BaseType_t affinity = 0;
-    #endif
-    
-
-    if (affinity == 0) {
-      totalRuntime[0] += runtime;
-      if (strcmp(taskName, "IDLE") == 0 || strcmp(taskName, "IDLE0") == 0) {
-        idleRuntime[0] = runtime;
-      }
+uint8_t getTaskTop(TaskTopEntry* out, uint8_t max, uint32_t* sampleMs) {
+  uint32_t seq;
+  uint8_t count;
+  do {
+    seq = topSeq.load(std::memory_order_acquire);
+    if (seq == 0) return 0;
+    if (seq & 1) {
+      taskYIELD();
+      continue;
     }
-    
-    #if NUM_CORES > 1
+    count = (topCount < max) ? topCount : max;
+    memcpy(out, topTasks, count * sizeof(TaskTopEntry));
+    if (sampleMs) *sampleMs = topSampleMs;
+    std::atomic_thread_fence(std::memory_order_acquire);
+  } while ((seq & 1) || topSeq.load(std::memory_order_relaxed) != seq);
+  return count;
+}
+#endif
 
-    else if (affinity == 1) {
-      totalRuntime[1] += runtime;
-      if (strcmp(taskName, "IDLE1") == 0) {
-        idleRuntime[1] = runtime;
-      }
-    }
-    #endif
-  }
-  
+void updateCpuLoad() {
+#if DEBUG_MODE
 
-  if (!cpuInitialized) {
-    for (int core = 0; core < NUM_CORES; core++) {
-      prevIdleRuntime[core] = idleRuntime[core];
-      prevTotalRuntime[core] = totalRuntime[core];
-    }
-    cpuInitialized = true;
-    return;
-  }
-  
+  /* Per-task sampling also derives coreLoadPct from the idle tasks */
+  updateTaskMonitoring();
 
-  for (int core = 0; core < NUM_CORES; core++) {
+#else
 
-    uint32_t idleDelta = idleRuntime[core] - prevIdleRuntime[core];
-    uint32_t totalDelta = totalRuntime[core] - prevTotalRuntime[core];
-    
-    if (totalDelta > 0) {
+  UBaseType_t numTasks = uxTaskGetSystemState(taskStatus, CPU_MONITOR_MAX_TASKS, NULL);
+  if (numTasks == 0) return;
 
-      uint32_t idlePercent = (idleDelta * 100ULL) / totalDelta;
-      if (idlePercent > 100) idlePercent = 100;
-      
+  /* Every core runs for exactly the wall-clock period, so that is the denominator */
+  int64_t nowUs = esp_timer_get_time();
+  uint64_t periodUs = cpuInitialized ? (uint64_t)(nowUs - lastSampleUs) : 0;
+  lastSampleUs = nowUs;
 
-      coreLoadPct[core] = 100 - idlePercent;
+  for (UBaseType_t i = 0; i < numTasks; i++) {
+    const char* taskName = taskStatus[i].pcTaskName;
+    int core;
+    if (strcmp(taskName, "IDLE") == 0 || strcmp(taskName, "IDLE0") == 0) {
+      core = 0;
+#if NUM_CORES > 1
+    } else if (strcmp(taskName, "IDLE1") == 0) {
+      core = 1;
+#endif
     } else {
-      coreLoadPct[core] = 0;
+      continue;
     }
-    
 
-    prevIdleRuntime[core] = idleRuntime[core];
-    prevTotalRuntime[core] = totalRuntime[core];
+    /* Modular difference stays exact across the 32-bit counter wrap */
+    uint32_t idleDelta = taskStatus[i].ulRunTimeCounter - prevIdleRuntime[core];
+    prevIdleRuntime[core] = taskStatus[i].ulRunTimeCounter;
+    if (periodUs == 0) continue;
+
+    uint64_t idlePercent = ((uint64_t)idleDelta * 100ULL) / periodUs;
+    coreLoadPct[core] = (idlePercent > 100) ? 0 : (uint8_t)(100 - idlePercent);
   }
-  
+
+#if ENABLE_TASK_TOP
+  updateTaskTop(numTasks, periodUs);
+#endif
+  cpuInitialized = true;
+
 #endif
 }
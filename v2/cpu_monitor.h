@@ -4,6 +4,7 @@
    Provides CPU usage tracking:
    - Per-task CPU utilization (DEBUG_MODE)
    - Lightweight overall CPU tracking (non-DEBUG_MODE)
+   - Top-N busiest tasks from runtime deltas (non-DEBUG_MODE, ENABLE_TASK_TOP)
    - Runtime statistics collection
    
    Helps identify performance bottlenecks and task scheduling issues.
@@ -14,7 +15,21 @@
 #define CPU_MONITOR_H
 
 #include <Arduino.h>
+#include "config.h"
 
 void updateCpuLoad();
 
+#if ENABLE_TASK_TOP
+
+struct TaskTopEntry {
+  char name[configMAX_TASK_NAME_LEN];
+  BaseType_t core;  /* tskNO_AFFINITY for unpinned tasks */
+  uint8_t cpuPercent;
+};
+
+/* Busiest non-idle tasks of the latest sample, most CPU time first; returns how many were written */
+uint8_t getTaskTop(TaskTopEntry* out, uint8_t max, uint32_t* sampleMs = nullptr);
+
+#endif
+
 #endif
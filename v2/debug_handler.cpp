@@ -2,13 +2,40 @@
    DEBUG_HANDLER.CPP - Debug and Logging Implementation
    
    Implements comprehensive logging system:
-   - Maintains circular log buffers (errors, WiFi events, reboots)
+   - Maintains one ring buffer per log category (errors, WiFi events, reboots)
    - Persists logs to NVS flash via background task
    - Monitors task stack usage to detect potential overflows
    - Tracks CPU usage per task using FreeRTOS statistics
    
    Background flash writes prevent blocking main tasks. Logs are accessible
    via web API for remote debugging.
+
+   Task statistics have a single writer, the stats sampler task. It keeps
+   its working set private and publishes each finished sample into one
+   snapshot guarded by a sequence counter (odd while a write is in progress).
+   Readers copy the snapshot and retry if the counter moved, so they never
+   block the sampler and never see a half-written sample.
+
+   Any task may log, without locks. An append builds the event entry (ID
+   and raw arguments, see log_events.h) on its own stack, then:
+   1. reserves the ring's next ticket with a compare-and-swap, only if that
+      ticket's slot is not still being written one lap earlier;
+   2. marks the slot busy, copies the entry, and commits it by storing the
+      ticket in the slot's state.
+   No producer ever waits on another. Two producers never share a slot:
+   if the ring laps a stalled writer, the new entry is dropped and counted
+   instead. Readers copy a committed slot and re-check its state, so they
+   never return a torn entry. Tickets also serve as the persisted sequence
+   numbers and as the read cursor of /api/debug/logs, which walks them one
+   entry at a time instead of copying whole rings.
+
+   With ENABLE_LOG_STORE, flashWriteTask appends only the entries past the
+   category's last persisted ticket to the append-only store
+   (log_store.h), one record each. Logs left in NVS are moved into an
+   empty store once. Without a usable partition, NVS keeps one blob per
+   category (entries oldest first plus a count). Blobs of older firmware
+   (text entries, or events with a 12-byte string) are converted once and
+   written back; blobs of any other size are ignored.
    ============================================================================== */
 
 #include "debug_handler.h"
@@ -17,91 +44,221 @@
 
 #include "globals.h"
 #include "time_handler.h"
+#include "stack_monitor.h"
+#include "trace.h"
+#include "log_store.h"
 #include <esp_system.h>
+#include <esp_random.h>
+#include <esp_timer.h>
+#include <atomic>
+
+/* Sampler-private working set */
+static TaskMonitorData taskData[MAX_TASKS_MONITORED];
+static uint8_t taskCount = 0;
+static bool statsInitialized = false;
+static CoreRuntimeData coreRuntime[2];
+static int64_t lastSampleUs = 0;
+
+/* Published sample */
+static TaskStatsSnapshot published;
+static std::atomic<uint32_t> publishedSeq(0);
 
-static void addLogEntry(LogEntry* logs, uint8_t& count, const String& msg, uint32_t uptimeSec);
 static void queueFlashWrite(FlashWriteType type);
-static void saveRebootLogsToFlash();
-static void saveWifiLogsToFlash();
-static void saveErrorLogsToFlash();
-static String getTaskStateName(eTaskState s);
-static String getStackHealth(uint32_t hwm);
+static void saveLogsToFlash(LogCategory cat);
 static String getAffinityString(BaseType_t affinity);
 static inline BaseType_t getSafeAffinity(TaskHandle_t handle);
 
-static bool isLikelyWraparound(uint32_t prevRuntime, uint32_t currentRuntime);
-
-static bool isLikelyWraparound(uint32_t prevRuntime, uint32_t currentRuntime) {
+static_assert((int)FLASH_WRITE_REBOOT_LOGS == LOG_CAT_REBOOT && (int)FLASH_WRITE_WIFI_LOGS == LOG_CAT_WIFI &&
+              (int)FLASH_WRITE_ERROR_LOGS == LOG_CAT_ERROR, "FlashWriteType must follow LogCategory");
+
+/* A slot's state is (ticket << 1) once its entry is committed, (ticket << 1) | 1 while
+   the entry is being written, 0 before first use. Ticket t lives in slot t % MAX_DEBUG_LOGS */
+struct LogSlot {
+  std::atomic<uint32_t> state;
+  LogEntry entry;
+};
+
+struct LogRing {
+  LogSlot slots[MAX_DEBUG_LOGS];
+  std::atomic<uint32_t> reserved;  /* Last ticket handed out; tickets start at 1 */
+  std::atomic<uint32_t> cleared;   /* Tickets up to this one are hidden from readers */
+  std::atomic<uint32_t> logged;    /* Entries committed since boot */
+  std::atomic<uint32_t> dropped;   /* Entries given up because their slot was still being written */
+};
+
+enum SlotRead : uint8_t {
+  SLOT_READ,     /* Entry copied */
+  SLOT_PENDING,  /* Ticket reserved, entry not committed yet */
+  SLOT_GONE      /* Overwritten by a later lap */
+};
+
+/* NVS keys per category, unchanged from the array layout */
+static const char* const logKeys[LOG_CAT_COUNT] = { "reboot_logs", "wifi_logs", "error_logs" };
+static const char* const logCountKeys[LOG_CAT_COUNT] = { "reboot_log_count", "wifi_log_count", "error_log_count" };
+
+static LogRing logRings[LOG_CAT_COUNT];
+
+/* Random per boot, bumped by every clear: tickets restart or disappear only across a change */
+static std::atomic<uint32_t> logGeneration(0);
+
+/* Static: 1.25KB is more than the flash task stack should carry. Used by flashWriteTask,
+   and by loadDebugLogs at boot before that task exists */
+static LogEntry logScratch[MAX_DEBUG_LOGS];
+
+#if ENABLE_LOG_STORE
+static bool logStoreReady = false;
+static uint32_t persistedSeq[LOG_CAT_COUNT];  /* Last ticket handed to the store; flashWriteTask only once started */
+#endif
 
-  const uint32_t nearMax = 0xF0000000;
-  const uint32_t nearZero = 0x10000000;
-  return (prevRuntime > nearMax) && (currentRuntime < nearZero);
+/* State the slot must hold before ticket may be written: its previous lap committed */
+static inline uint32_t freeState(uint32_t ticket) {
+  return (ticket > MAX_DEBUG_LOGS) ? (ticket - MAX_DEBUG_LOGS) << 1 : 0;
 }
 
-static void addLogEntry(LogEntry* logs, uint8_t& count, const String& msg, uint32_t uptimeSec) {
-  String trimmed = msg;
-  if (trimmed.length() > 59) trimmed = trimmed.substring(0, 59);
-
-  uint32_t epochTime = 0;
-  if (getTimeInitialized()) {
-    epochTime = getEpochTime();
+/* reserveTicket: Claims the next ticket unless its slot still holds a write in progress */
+static bool reserveTicket(LogRing& ring, uint32_t& ticket) {
+  uint32_t last = ring.reserved.load(std::memory_order_relaxed);
+  for (;;) {
+    uint32_t next = last + 1;
+    /* Only the owner of next - MAX_DEBUG_LOGS can change this slot until next is claimed */
+    if (ring.slots[next % MAX_DEBUG_LOGS].state.load(std::memory_order_acquire) != freeState(next)) return false;
+    if (ring.reserved.compare_exchange_weak(last, next, std::memory_order_acq_rel, std::memory_order_relaxed)) {
+      ticket = next;
+      return true;
+    }
   }
+}
 
-  if (count < MAX_DEBUG_LOGS) {
-    logs[count].uptime = uptimeSec;
-    logs[count].epoch = epochTime;
-    trimmed.toCharArray(logs[count].msg, sizeof(logs[count].msg));
-    count++;
-  } else {
-    memmove(&logs[0], &logs[1], (MAX_DEBUG_LOGS - 1) * sizeof(LogEntry));
-    logs[MAX_DEBUG_LOGS - 1].uptime = uptimeSec;
-    logs[MAX_DEBUG_LOGS - 1].epoch = epochTime;
-    trimmed.toCharArray(logs[MAX_DEBUG_LOGS - 1].msg, sizeof(logs[MAX_DEBUG_LOGS - 1].msg));
+void addLogEvent(LogCategory cat, LogEventId id, const LogEventArgs& args) {
+  LogEntry entry;
+  entry.uptime = millis() / 1000;
+  entry.epoch = getTimeInitialized() ? getEpochTime() : 0;
+  entry.id = id;
+  entry.argc = args.count;
+  entry.flags = 0;
+  memcpy(entry.args, args.v, sizeof(entry.args));
+  const char* str = args.str ? args.str : "";
+  strncpy(entry.str, str, sizeof(entry.str) - 1);
+  entry.str[sizeof(entry.str) - 1] = '\0';
+  if (str[strnlen(entry.str, sizeof(entry.str))]) entry.flags |= LOG_ENTRY_STR_CUT;
+
+  LogRing& ring = logRings[cat];
+  uint32_t ticket;
+  if (!reserveTicket(ring, ticket)) {
+    ring.dropped.fetch_add(1, std::memory_order_relaxed);
+    return;
   }
+
+  LogSlot& slot = ring.slots[ticket % MAX_DEBUG_LOGS];
+  slot.state.store((ticket << 1) | 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  memcpy(&slot.entry, &entry, sizeof(entry));
+  slot.state.store(ticket << 1, std::memory_order_release);
+  ring.logged.fetch_add(1, std::memory_order_relaxed);
+
+  queueFlashWrite((FlashWriteType)cat);
 }
 
-void addRebootLog(const String& msg, uint32_t uptimeSec) {
-  addLogEntry(rebootLogs, rebootLogCount, msg, uptimeSec);
-  queueFlashWrite(FLASH_WRITE_REBOOT_LOGS);
+void getLogCounters(LogCounters& out) {
+  out.reboot = logRings[LOG_CAT_REBOOT].logged.load(std::memory_order_relaxed);
+  out.wifi = logRings[LOG_CAT_WIFI].logged.load(std::memory_order_relaxed);
+  out.error = logRings[LOG_CAT_ERROR].logged.load(std::memory_order_relaxed);
+  out.dropped = 0;
+  for (uint8_t cat = 0; cat < LOG_CAT_COUNT; cat++) out.dropped += logRings[cat].dropped.load(std::memory_order_relaxed);
 }
 
-void addWifiLog(const String& msg, uint32_t uptimeSec) {
-  addLogEntry(wifiLogs, wifiLogCount, msg, uptimeSec);
-  queueFlashWrite(FLASH_WRITE_WIFI_LOGS);
+/* readTicket: Copies ticket's entry and re-checks the state, so a copy torn by a later lap is never returned */
+static SlotRead readTicket(const LogRing& ring, uint32_t ticket, LogEntry& out) {
+  const LogSlot& slot = ring.slots[ticket % MAX_DEBUG_LOGS];
+  uint32_t state = slot.state.load(std::memory_order_acquire);
+  if ((state >> 1) > ticket) return SLOT_GONE;
+  if (state != (ticket << 1)) return SLOT_PENDING;
+  memcpy(&out, &slot.entry, sizeof(out));
+  std::atomic_thread_fence(std::memory_order_acquire);
+  return (slot.state.load(std::memory_order_relaxed) == state) ? SLOT_READ : SLOT_GONE;
 }
 
-void addErrorLog(const String& msg, uint32_t uptimeSec) {
-  addLogEntry(errorLogs, errorLogCount, msg, uptimeSec);
-  queueFlashWrite(FLASH_WRITE_ERROR_LOGS);
+/* firstVisible: Oldest ticket that can still be in the ring and was not cleared */
+static uint32_t firstVisible(const LogRing& ring, uint32_t last) {
+  uint32_t first = (last > MAX_DEBUG_LOGS) ? last - MAX_DEBUG_LOGS + 1 : 1;
+  uint32_t cleared = ring.cleared.load(std::memory_order_acquire);
+  return (first > cleared) ? first : cleared + 1;
 }
 
-static void saveRebootLogsToFlash() {
-  /* Acquire flashWriteMutex mutex (wait up to 1000ms) to safely access shared resource */
-    if (xSemaphoreTake(flashWriteMutex, pdMS_TO_TICKS(1000)) == pdTRUE) {
-    prefs.putBytes("reboot_logs", rebootLogs, sizeof(rebootLogs));
-    prefs.putUChar("reboot_log_count", rebootLogCount);
-    xSemaphoreGive(flashWriteMutex);
+uint8_t copyLogs(LogCategory cat, LogEntry* out) {
+  const LogRing& ring = logRings[cat];
+  uint32_t last = ring.reserved.load(std::memory_order_acquire);
+  uint8_t count = 0;
+  for (uint32_t t = firstVisible(ring, last); t <= last; t++) {
+    if (readTicket(ring, t, out[count]) == SLOT_READ) count++;
   }
+  return count;
 }
 
-static void saveWifiLogsToFlash() {
-  /* Acquire flashWriteMutex mutex (wait up to 1000ms) to safely access shared resource */
-    if (xSemaphoreTake(flashWriteMutex, pdMS_TO_TICKS(1000)) == pdTRUE) {
-    prefs.putBytes("wifi_logs", wifiLogs, sizeof(wifiLogs));
-    prefs.putUChar("wifi_log_count", wifiLogCount);
-    xSemaphoreGive(flashWriteMutex);
+/* seedRing: Places entries (oldest first) at tickets last - count + 1 .. last; boot only, before any producer */
+static void seedRing(LogCategory cat, const LogEntry* entries, uint8_t count, uint32_t last) {
+  LogRing& ring = logRings[cat];
+  uint32_t first = (last > MAX_DEBUG_LOGS) ? last - MAX_DEBUG_LOGS + 1 : 1;
+  for (uint32_t t = first; t <= last; t++) {
+    /* Tickets below the loaded ones are marked committed too, so the next lap finds its slots free */
+    LogSlot& slot = ring.slots[t % MAX_DEBUG_LOGS];
+    if (t > last - count) slot.entry = entries[t - (last - count) - 1];
+    slot.state.store(t << 1, std::memory_order_relaxed);
   }
+  ring.cleared.store(last - count, std::memory_order_relaxed);
+  ring.reserved.store(last, std::memory_order_release);
 }
 
-static void saveErrorLogsToFlash() {
+static void saveLogsToFlash(LogCategory cat) {
+  memset(logScratch, 0, sizeof(logScratch));
+  uint8_t count = copyLogs(cat, logScratch);
+
   /* Acquire flashWriteMutex mutex (wait up to 1000ms) to safely access shared resource */
     if (xSemaphoreTake(flashWriteMutex, pdMS_TO_TICKS(1000)) == pdTRUE) {
-    prefs.putBytes("error_logs", errorLogs, sizeof(errorLogs));
-    prefs.putUChar("error_log_count", errorLogCount);
+    prefs.putBytes(logKeys[cat], logScratch, sizeof(logScratch));
+    prefs.putUChar(logCountKeys[cat], count);
     xSemaphoreGive(flashWriteMutex);
   }
 }
 
+bool nextLogEntry(LogCategory cat, uint32_t after, LogEntry& entry, uint32_t& seq) {
+  const LogRing& ring = logRings[cat];
+  uint32_t last = ring.reserved.load(std::memory_order_acquire);
+  uint32_t first = firstVisible(ring, last);
+  for (uint32_t t = (after >= first) ? after + 1 : first; t <= last; t++) {
+    SlotRead r = readTicket(ring, t, entry);
+    if (r == SLOT_PENDING) return false;
+    if (r == SLOT_READ) {
+      seq = t;
+      return true;
+    }
+  }
+  return false;
+}
+
+uint32_t getLogGeneration() {
+  return logGeneration.load(std::memory_order_acquire);
+}
+
+static void flushLogs(LogCategory cat) {
+#if ENABLE_LOG_STORE
+  if (logStoreReady) {
+    LogEntry entry;
+    uint32_t seq;
+    /* Stops at an entry still being written; its commit queues another flush */
+    while (nextLogEntry(cat, persistedSeq[cat], entry, seq)) {
+      /* Acquire flashWriteMutex mutex (wait up to 1000ms) to safely access shared resource */
+      if (xSemaphoreTake(flashWriteMutex, pdMS_TO_TICKS(1000)) != pdTRUE) return;
+      logStoreAppend(cat, seq, entry);
+      xSemaphoreGive(flashWriteMutex);
+      persistedSeq[cat] = seq;  /* Advance on failure too; a failed append is not retried */
+    }
+    return;
+  }
+#endif
+  saveLogsToFlash(cat);
+}
+
 static void queueFlashWrite(FlashWriteType type) {
   if (flashWriteQueue) {
     FlashWriteRequest req;
@@ -130,43 +287,110 @@ void flashWriteTask(void* param) {
         if (tempReq.type == FLASH_WRITE_ERROR_LOGS) errorPending = true;
       }
 
-      if (rebootPending) saveRebootLogsToFlash();
-      if (wifiPending) saveWifiLogsToFlash();
-      if (errorPending) saveErrorLogsToFlash();
+      TRACE_BEGIN(TRACE_FLASH_WRITE);
+      if (rebootPending) flushLogs(LOG_CAT_REBOOT);
+      if (wifiPending) flushLogs(LOG_CAT_WIFI);
+      if (errorPending) flushLogs(LOG_CAT_ERROR);
+      TRACE_END(TRACE_FLASH_WRITE);
     }
   }
 }
 
-void loadDebugLogs() {
-  /* Acquire flashWriteMutex mutex (wait up to 1000ms) to safely access shared resource */
-    if (xSemaphoreTake(flashWriteMutex, pdMS_TO_TICKS(1000)) == pdTRUE) {
-    rebootLogCount = prefs.getUChar("reboot_log_count", 0);
-    if (rebootLogCount > MAX_DEBUG_LOGS) rebootLogCount = MAX_DEBUG_LOGS;
-    size_t sz = prefs.getBytesLength("reboot_logs");
-    if (sz == sizeof(rebootLogs)) {
-      prefs.getBytes("reboot_logs", rebootLogs, sz);
-    } else {
-      rebootLogCount = 0;
-    }
+static_assert(sizeof(LegacyLogEntry) != sizeof(LogEntry) && sizeof(LogEntryV2) != sizeof(LogEntry) &&
+              sizeof(LegacyLogEntry) != sizeof(LogEntryV2), "Old and new NVS log blobs are told apart by size");
+
+/* migrateNvsLog: Converts a blob of an older entry layout into logScratch and writes it back in the
+   current layout, so it is converted only once; returns count, or 0 if it could not be read.
+   Caller holds flashWriteMutex */
+template <typename Entry>
+static uint8_t migrateNvsLog(uint8_t cat, uint8_t count) {
+  /* Heap: boot only and at most once per category, not worth 2KB of permanent RAM */
+  const size_t len = MAX_DEBUG_LOGS * sizeof(Entry);
+  Entry* old = (Entry*)malloc(len);
+  if (!old) return 0;
+  bool read = prefs.getBytes(logKeys[cat], old, len) == len;
+  memset(logScratch, 0, sizeof(logScratch));
+  if (read) {
+    for (uint8_t i = 0; i < count; i++) logScratch[i] = upgradeLogEntry(old[i]);
+  }
+  free(old);
+  if (!read) return 0;
 
-    wifiLogCount = prefs.getUChar("wifi_log_count", 0);
-    if (wifiLogCount > MAX_DEBUG_LOGS) wifiLogCount = MAX_DEBUG_LOGS;
-    sz = prefs.getBytesLength("wifi_logs");
-    if (sz == sizeof(wifiLogs)) {
-      prefs.getBytes("wifi_logs", wifiLogs, sz);
-    } else {
-      wifiLogCount = 0;
+  prefs.putBytes(logKeys[cat], logScratch, sizeof(logScratch));
+  prefs.putUChar(logCountKeys[cat], count);
+  Serial.printf("Debug logs: converted %u old %s entries\n", count, logKeys[cat]);
+  return count;
+}
+
+/* loadNvsLogs: Fills the rings from NVS at tickets 1..count; returns the total loaded.
+   Caller holds flashWriteMutex */
+static uint16_t loadNvsLogs() {
+  uint16_t total = 0;
+  for (uint8_t cat = 0; cat < LOG_CAT_COUNT; cat++) {
+    uint8_t count = prefs.getUChar(logCountKeys[cat], 0);
+    if (count > MAX_DEBUG_LOGS) count = MAX_DEBUG_LOGS;
+    size_t len = prefs.getBytesLength(logKeys[cat]);
+    if (len == MAX_DEBUG_LOGS * sizeof(LegacyLogEntry)) count = migrateNvsLog<LegacyLogEntry>(cat, count);
+    else if (len == MAX_DEBUG_LOGS * sizeof(LogEntryV2)) count = migrateNvsLog<LogEntryV2>(cat, count);
+    else if (len != sizeof(logScratch)) count = 0;
+    else if (count > 0) prefs.getBytes(logKeys[cat], logScratch, sizeof(logScratch));
+    seedRing((LogCategory)cat, logScratch, count, count);
+    total += count;
+  }
+  return total;
+}
+
+#if ENABLE_LOG_STORE
+/* loadStoreLogs: Fills the rings from the log store, moving NVS logs into it on first use.
+   False if that move failed; the rings then hold the NVS logs and NVS stays in use */
+static bool loadStoreLogs() {
+  if (logStoreLastSeq() > 0) {
+    /* Record sequence numbers are ring tickets, so new entries continue after the stored ones */
+    static uint32_t seqs[MAX_DEBUG_LOGS];
+    for (uint8_t cat = 0; cat < LOG_CAT_COUNT; cat++) {
+      uint8_t count = logStoreRecover((LogCategory)cat, logScratch, seqs);
+      seedRing((LogCategory)cat, logScratch, count, count ? seqs[count - 1] : 0);
     }
+    return true;
+  }
 
-    errorLogCount = prefs.getUChar("error_log_count", 0);
-    if (errorLogCount > MAX_DEBUG_LOGS) errorLogCount = MAX_DEBUG_LOGS;
-    sz = prefs.getBytesLength("error_logs");
-    if (sz == sizeof(errorLogs)) {
-      prefs.getBytes("error_logs", errorLogs, sz);
-    } else {
-      errorLogCount = 0;
+  uint16_t total = loadNvsLogs();
+  if (total == 0) return true;
+  bool moved = true;
+  for (uint8_t cat = 0; cat < LOG_CAT_COUNT; cat++) {
+    uint8_t count = copyLogs((LogCategory)cat, logScratch);
+    for (uint8_t i = 0; i < count; i++) {
+      moved = logStoreAppend((LogCategory)cat, i + 1, logScratch[i]) && moved;
     }
+  }
+  if (!moved) {
+    logStoreErase();
+    Serial.println("Log store: moving NVS logs failed, using NVS");
+    return false;
+  }
+  for (uint8_t cat = 0; cat < LOG_CAT_COUNT; cat++) {
+    prefs.remove(logKeys[cat]);
+    prefs.remove(logCountKeys[cat]);
+  }
+  Serial.printf("Log store: moved %u NVS log entries\n", total);
+  return true;
+}
+#endif
 
+void loadDebugLogs() {
+  /* Acquire flashWriteMutex mutex (wait up to 1000ms) to safely access shared resource */
+    if (xSemaphoreTake(flashWriteMutex, pdMS_TO_TICKS(1000)) == pdTRUE) {
+#if ENABLE_LOG_STORE
+    logStoreReady = logStoreBegin();
+    if (!logStoreReady) loadNvsLogs();
+    else if (!loadStoreLogs()) logStoreReady = false;  /* The rings already hold the NVS logs */
+    for (uint8_t cat = 0; cat < LOG_CAT_COUNT; cat++) {
+      persistedSeq[cat] = logRings[cat].reserved.load(std::memory_order_relaxed);
+    }
+#else
+    loadNvsLogs();
+#endif
+    logGeneration.store(esp_random(), std::memory_order_release);
     xSemaphoreGive(flashWriteMutex);
   }
 }
@@ -174,16 +398,17 @@ void loadDebugLogs() {
 void clearDebugLogs() {
   /* Acquire flashWriteMutex mutex (wait up to 1000ms) to safely access shared resource */
     if (xSemaphoreTake(flashWriteMutex, pdMS_TO_TICKS(1000)) == pdTRUE) {
-    rebootLogCount = wifiLogCount = errorLogCount = 0;
-    memset(rebootLogs, 0, sizeof(rebootLogs));
-    memset(wifiLogs, 0, sizeof(wifiLogs));
-    memset(errorLogs, 0, sizeof(errorLogs));
-    prefs.remove("reboot_logs");
-    prefs.remove("reboot_log_count");
-    prefs.remove("wifi_logs");
-    prefs.remove("wifi_log_count");
-    prefs.remove("error_logs");
-    prefs.remove("error_log_count");
+    /* Producers never wait on a clear: the watermark just hides every ticket handed out so far */
+    for (uint8_t cat = 0; cat < LOG_CAT_COUNT; cat++) {
+      LogRing& ring = logRings[cat];
+      ring.cleared.store(ring.reserved.load(std::memory_order_acquire), std::memory_order_release);
+      prefs.remove(logKeys[cat]);
+      prefs.remove(logCountKeys[cat]);
+    }
+    logGeneration.fetch_add(1, std::memory_order_acq_rel);
+#if ENABLE_LOG_STORE
+    if (logStoreReady) logStoreErase();
+#endif
     xSemaphoreGive(flashWriteMutex);
   }
 }
@@ -204,7 +429,7 @@ String formatResetReason(esp_reset_reason_t reason) {
   }
 }
 
-static String getTaskStateName(eTaskState s) {
+const char* taskStateName(eTaskState s) {
   switch (s) {
     case eRunning: return "RUNNING";
     case eReady: return "READY";
@@ -215,11 +440,13 @@ static String getTaskStateName(eTaskState s) {
   }
 }
 
-static String getStackHealth(uint32_t hwm) {
-  if (hwm > 1500) return "good";
-  if (hwm > 800) return "ok";
-  if (hwm > 300) return "low";
-  return "critical";
+const char* stackHealthName(StackHealth health) {
+  switch (health) {
+    case STACK_GOOD: return "good";
+    case STACK_OK: return "ok";
+    case STACK_LOW: return "low";
+    default: return "critical";
+  }
 }
 
 static String getAffinityString(BaseType_t affinity) {
@@ -236,184 +463,244 @@ static inline BaseType_t getSafeAffinity(TaskHandle_t handle) {
 #endif
 }
 
-void updateTaskMonitoring() {
-  if (millis() - lastTaskSample < 500) return;
-  lastTaskSample = millis();
+/* Open-addressing index from TaskHandle_t to taskData position, rebuilt every sample.
+   Twice as many slots as tasks keeps probe chains short; TASK_INDEX_EMPTY marks a free slot. */
+#define TASK_INDEX_SLOTS (MAX_TASKS_MONITORED * 2)
+#define TASK_INDEX_EMPTY 0xFF
+
+static_assert((TASK_INDEX_SLOTS & (TASK_INDEX_SLOTS - 1)) == 0, "TASK_INDEX_SLOTS must be a power of two");
+static_assert(MAX_TASKS_MONITORED < TASK_INDEX_EMPTY, "taskData positions must fit below TASK_INDEX_EMPTY");
+
+static uint8_t taskIndex[TASK_INDEX_SLOTS];
+
+static inline uint32_t taskIndexSlot(TaskHandle_t handle) {
+  /* TCBs are word aligned; Fibonacci hashing spreads the remaining bits */
+  return ((uint32_t)((uintptr_t)handle >> 2) * 2654435761UL) & (TASK_INDEX_SLOTS - 1);
+}
+
+static void insertTask(TaskHandle_t handle, uint8_t pos) {
+  uint32_t slot = taskIndexSlot(handle);
+  while (taskIndex[slot] != TASK_INDEX_EMPTY) slot = (slot + 1) & (TASK_INDEX_SLOTS - 1);
+  taskIndex[slot] = pos;
+}
 
-  TaskStatus_t statusArray[MAX_TASKS_MONITORED];
+static uint8_t findTask(TaskHandle_t handle) {
+  uint32_t slot = taskIndexSlot(handle);
+  while (taskIndex[slot] != TASK_INDEX_EMPTY) {
+    if (taskData[taskIndex[slot]].handle == handle) return taskIndex[slot];
+    slot = (slot + 1) & (TASK_INDEX_SLOTS - 1);
+  }
+  return TASK_INDEX_EMPTY;
+}
+
+static void buildTaskIndex() {
+  memset(taskIndex, TASK_INDEX_EMPTY, sizeof(taskIndex));
+  for (uint8_t i = 0; i < taskCount; i++) insertTask(taskData[i].handle, i);
+}
+
+static void initTaskData(TaskMonitorData& t, const TaskStatus_t& status) {
+  strncpy(t.name, status.pcTaskName, sizeof(t.name) - 1);
+  t.name[sizeof(t.name) - 1] = '\0';
+  t.priority = status.uxCurrentPriority;
+  t.state = status.eCurrentState;
+  t.prevRuntime = 0;  /* Per-task counters start at 0, so the first delta is the whole life so far */
+  t.runtimeAccumUs = 0;
+  t.stackHighWater = status.xHandle ? uxTaskGetStackHighWaterMark(status.xHandle) : 0;
+  t.stackSize = taskStackSize(t.name);
+  t.stackHealth = stackHealthFor(t.stackHighWater, t.stackSize);
+  t.cpuPercent = 0;
+  t.handle = status.xHandle;
+  t.coreAffinity = getSafeAffinity(status.xHandle);
+}
+
+/* taskRestarted: A same-named task took over a deleted task's TCB, so the counter is not the one sampled
+   last time. Its counter went backwards, which as a modular delta is far more run time than the period
+   held; a genuine 2^32 wrap stays within it. The margin absorbs sampling jitter on a fully busy task */
+static bool taskRestarted(uint32_t counter, uint32_t prevRuntime, uint32_t delta, uint64_t capacityUs) {
+  if (capacityUs == 0) return counter < prevRuntime;
+  return delta > capacityUs + capacityUs / 16;
+}
+
+/* updateIdleLoad: Core load is 100% minus the share of that core's idle task */
+static void updateIdleLoad() {
+  for (uint8_t i = 0; i < taskCount; i++) {
+    const char* taskName = taskData[i].name;
+    uint8_t idlePercent = taskData[i].cpuPercent;
+
+    if (strcmp(taskName, "IDLE") == 0 || strcmp(taskName, "IDLE0") == 0) {
+      coreLoadPct[0] = (idlePercent > 100) ? 0 : (100 - idlePercent);
+    }
+#if NUM_CORES > 1
+    if (strcmp(taskName, "IDLE1") == 0) {
+      coreLoadPct[1] = (idlePercent > 100) ? 0 : (100 - idlePercent);
+    }
+#endif
+  }
+}
+
+static void publishTaskStats() {
+  uint32_t seq = publishedSeq.load(std::memory_order_relaxed);
+  publishedSeq.store(seq + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+
+  published.sampleMs = millis();
+  published.taskCount = taskCount;
+  published.coreLoadPct[0] = coreLoadPct[0];
+  published.coreLoadPct[1] = coreLoadPct[1];
+  memcpy(published.cores, coreRuntime, sizeof(published.cores));
+  memcpy(published.tasks, taskData, taskCount * sizeof(TaskMonitorData));
+
+  publishedSeq.store(seq + 2, std::memory_order_release);
+}
+
+/* readBegin: Waits out a publish in progress; returns the even sequence to validate against */
+static uint32_t readBegin() {
+  for (;;) {
+    uint32_t seq = publishedSeq.load(std::memory_order_acquire);
+    if ((seq & 1) == 0) return seq;
+    taskYIELD();
+  }
+}
+
+/* readRetry: True if a publish started since readBegin(), i.e. the copy may be torn */
+static bool readRetry(uint32_t seq) {
+  std::atomic_thread_fence(std::memory_order_acquire);
+  return publishedSeq.load(std::memory_order_relaxed) != seq;
+}
+
+bool getTaskStatsSnapshot(TaskStatsSnapshot& out) {
+  uint32_t seq;
+  do {
+    seq = readBegin();
+    if (seq == 0) return false;
+    memcpy(&out, &published, offsetof(TaskStatsSnapshot, tasks));
+    uint8_t count = (out.taskCount > MAX_TASKS_MONITORED) ? MAX_TASKS_MONITORED : out.taskCount;
+    memcpy(out.tasks, published.tasks, count * sizeof(TaskMonitorData));
+  } while (readRetry(seq));
+  return true;
+}
+
+bool getCoreStatsSnapshot(CoreRuntimeData* cores, uint8_t* loadPct) {
+  uint32_t seq;
+  do {
+    seq = readBegin();
+    if (seq == 0) return false;
+    memcpy(cores, published.cores, sizeof(published.cores));
+    memcpy(loadPct, published.coreLoadPct, sizeof(published.coreLoadPct));
+  } while (readRetry(seq));
+  return true;
+}
+
+uint8_t getTaskCpuSamples(TaskCpuSample* out, uint8_t max) {
+  uint32_t seq;
+  uint8_t count;
+  do {
+    seq = readBegin();
+    if (seq == 0) return 0;
+    count = (published.taskCount < max) ? published.taskCount : max;
+    for (uint8_t i = 0; i < count; i++) {
+      memcpy(out[i].name, published.tasks[i].name, sizeof(out[i].name));
+      out[i].cpuPercent = published.tasks[i].cpuPercent;
+    }
+  } while (readRetry(seq));
+  return count;
+}
+
+/* updateTaskMonitoring: Takes one sample and publishes it; called only by the stats sampler */
+void updateTaskMonitoring() {
+  /* Static: ~2.5KB would crowd the stats task stack, and there is only one sampler */
+  static TaskStatus_t statusArray[MAX_TASKS_MONITORED];
   UBaseType_t numTasks = uxTaskGetSystemState(statusArray, MAX_TASKS_MONITORED, NULL);
   if (numTasks == 0) {
-    addErrorLog(F("Failed to get task state"), millis() / 1000);
+    LOG_ERROR(EVT_TASK_STATE_FAILED);
     return;
   }
 
+  /* Every core runs for exactly the wall-clock period, so that is the denominator */
+  int64_t nowUs = esp_timer_get_time();
+  uint64_t periodUs = statsInitialized ? (uint64_t)(nowUs - lastSampleUs) : 0;
+  lastSampleUs = nowUs;
+
   for (int c = 0; c < NUM_CORES; c++) {
-    coreRuntime[c].totalRuntime100ms = 0;
+    coreRuntime[c].runtimeUs = 0;
     coreRuntime[c].taskCount = 0;
     coreRuntime[c].cpuPercentTotal = 0;
   }
-  noAffinityRuntime100ms = 0;
 
-  for (uint8_t j = 0; j < numTasks; j++) {
-    BaseType_t affinity = getSafeAffinity(statusArray[j].xHandle);
-    uint32_t runtime = statusArray[j].ulRunTimeCounter;
+  /* One pass over the snapshot: known handles are updated in place, unknown ones appended */
+  buildTaskIndex();
+  bool seen[MAX_TASKS_MONITORED] = {};
 
-    if (affinity == tskNO_AFFINITY) {
-      noAffinityRuntime100ms += (uint64_t)runtime;
-    } else if (affinity >= 0 && affinity < NUM_CORES) {
-      coreRuntime[affinity].totalRuntime100ms += (uint64_t)runtime;
-      coreRuntime[affinity].taskCount++;
+  for (uint8_t j = 0; j < numTasks; j++) {
+    const TaskStatus_t& status = statusArray[j];
+    uint8_t i = findTask(status.xHandle);
+
+    if (i == TASK_INDEX_EMPTY) {
+      if (taskCount >= MAX_TASKS_MONITORED) continue;
+      i = taskCount++;
+      initTaskData(taskData[i], status);
+      insertTask(status.xHandle, i);
+    } else if (strncmp(taskData[i].name, status.pcTaskName, sizeof(taskData[i].name) - 1) != 0) {
+      /* A new task reused a deleted task's TCB; restart its statistics */
+      initTaskData(taskData[i], status);
     }
-  }
+    seen[i] = true;
 
-  uint64_t coreDelta[2] = { 0, 0 };
-  for (int c = 0; c < NUM_CORES; c++) {
-    coreDelta[c] = coreRuntime[c].totalRuntime100ms - coreRuntime[c].prevTotalRuntime100ms;
-    if (coreDelta[c] == 0) coreDelta[c] = 1;
-  }
+    BaseType_t affinity = getSafeAffinity(status.xHandle);
+    taskData[i].coreAffinity = affinity;
 
-  if (!statsInitialized) {
-    taskCount = min((uint8_t)numTasks, (uint8_t)MAX_TASKS_MONITORED);
-    for (uint8_t i = 0; i < taskCount; i++) {
-      taskData[i].name = String(statusArray[i].pcTaskName);
-      taskData[i].priority = statusArray[i].uxCurrentPriority;
-      taskData[i].state = statusArray[i].eCurrentState;
-      taskData[i].runtime = statusArray[i].ulRunTimeCounter;
-      taskData[i].prevRuntime = statusArray[i].ulRunTimeCounter;
-      taskData[i].runtimeAccumUs = 0;
-      taskData[i].stackHighWater = statusArray[i].xHandle ? uxTaskGetStackHighWaterMark(statusArray[i].xHandle) : 0;
-      taskData[i].stackHealth = getStackHealth(taskData[i].stackHighWater);
-      taskData[i].cpuPercent = 0;
-      taskData[i].handle = statusArray[i].xHandle;
-      taskData[i].coreAffinity = getSafeAffinity(statusArray[i].xHandle);
-    }
-    for (int c = 0; c < NUM_CORES; c++) {
-      coreRuntime[c].prevTotalRuntime100ms = coreRuntime[c].totalRuntime100ms;
-    }
-    statsInitialized = true;
-    return;
-  }
+    /* An unpinned task may have run on any core */
+    uint64_t capacityUs = periodUs * ((affinity == tskNO_AFFINITY) ? NUM_CORES : 1);
+    bool knownCore = affinity == tskNO_AFFINITY || (affinity >= 0 && affinity < NUM_CORES);
 
-  for (uint8_t i = 0; i < taskCount; i++) {
-    bool found = false;
-    for (uint8_t j = 0; j < numTasks; j++) {
-      if (taskData[i].handle == statusArray[j].xHandle) {
-        uint32_t currentRuntime100ms = statusArray[j].ulRunTimeCounter;
-
-        uint32_t taskDelta;
-        if (currentRuntime100ms >= taskData[i].prevRuntime) {
-
-          taskDelta = currentRuntime100ms - taskData[i].prevRuntime;
-        } else {
-
-          if (isLikelyWraparound(taskData[i].prevRuntime, currentRuntime100ms)) {
-
-            taskDelta = (0xFFFFFFFF - taskData[i].prevRuntime) + currentRuntime100ms + 1;
-          } else {
-
-            Serial.printf("[DEBUG] Task %s counter reset: %u -> %u (not wraparound)\n", 
-                         taskData[i].name.c_str(), 
-                         taskData[i].prevRuntime, 
-                         currentRuntime100ms);
-            taskDelta = 0;
-          }
-        }
-
-        taskData[i].runtimeAccumUs += (uint64_t)taskDelta;
-
-        BaseType_t affinity = getSafeAffinity(statusArray[j].xHandle);
-        taskData[i].coreAffinity = affinity;
-
-        if (affinity == tskNO_AFFINITY) {
-          uint64_t totalCoreDelta = 0;
-          for (int c = 0; c < NUM_CORES; c++) totalCoreDelta += coreDelta[c];
-          if (totalCoreDelta > 0) {
-            uint64_t percentage = ((uint64_t)taskDelta * 100ULL) / totalCoreDelta;
-            taskData[i].cpuPercent = (percentage > 100) ? 100 : (uint8_t)percentage;
-          } else {
-            taskData[i].cpuPercent = 0;
-          }
-        } else if (affinity >= 0 && affinity < NUM_CORES) {
-          if (coreDelta[affinity] > 0) {
-            uint64_t percentage = ((uint64_t)taskDelta * 100ULL) / coreDelta[affinity];
-            taskData[i].cpuPercent = (percentage > 100) ? 100 : (uint8_t)percentage;
-          } else {
-            taskData[i].cpuPercent = 0;
-          }
-          coreRuntime[affinity].cpuPercentTotal += taskData[i].cpuPercent;
-        } else {
-          taskData[i].cpuPercent = 0;
-        }
-
-        taskData[i].priority = statusArray[j].uxCurrentPriority;
-        taskData[i].state = statusArray[j].eCurrentState;
-        taskData[i].runtime = currentRuntime100ms;
-        taskData[i].prevRuntime = currentRuntime100ms;
-        taskData[i].stackHighWater = statusArray[j].xHandle ? uxTaskGetStackHighWaterMark(statusArray[j].xHandle) : 0;
-        taskData[i].stackHealth = getStackHealth(taskData[i].stackHighWater);
-        taskData[i].handle = statusArray[j].xHandle;
-        found = true;
-        break;
-      }
+    /* Modular difference is exact as long as a task runs < 2^32us (~71 min) between samples */
+    uint32_t taskDelta = status.ulRunTimeCounter - taskData[i].prevRuntime;
+    if (taskRestarted(status.ulRunTimeCounter, taskData[i].prevRuntime, taskDelta, knownCore ? capacityUs : 0)) {
+      initTaskData(taskData[i], status);
+      taskDelta = status.ulRunTimeCounter;
     }
-    if (!found) {
+    taskData[i].prevRuntime = status.ulRunTimeCounter;
+    taskData[i].runtimeAccumUs += taskDelta;
+
+    if (capacityUs > 0 && knownCore) {
+      uint64_t percentage = ((uint64_t)taskDelta * 100ULL) / capacityUs;
+      taskData[i].cpuPercent = (percentage > 100) ? 100 : (uint8_t)percentage;
+    } else {
       taskData[i].cpuPercent = 0;
-      taskData[i].state = eDeleted;
     }
-  }
 
-  for (uint8_t j = 0; j < numTasks && taskCount < MAX_TASKS_MONITORED; j++) {
-    bool exists = false;
-    for (uint8_t i = 0; i < taskCount; i++) {
-      if (taskData[i].handle == statusArray[j].xHandle) {
-        exists = true;
-        break;
-      }
-    }
-    if (!exists) {
-      taskData[taskCount].name = String(statusArray[j].pcTaskName);
-      taskData[taskCount].priority = statusArray[j].uxCurrentPriority;
-      taskData[taskCount].state = statusArray[j].eCurrentState;
-      taskData[taskCount].runtime = statusArray[j].ulRunTimeCounter;
-      taskData[taskCount].prevRuntime = statusArray[j].ulRunTimeCounter;
-      taskData[taskCount].runtimeAccumUs = 0;
-      taskData[taskCount].stackHighWater = statusArray[j].xHandle ? uxTaskGetStackHighWaterMark(statusArray[j].xHandle) : 0;
-      taskData[taskCount].stackHealth = getStackHealth(taskData[taskCount].stackHighWater);
-      taskData[taskCount].cpuPercent = 0;
-      taskData[taskCount].handle = statusArray[j].xHandle;
-      taskData[taskCount].coreAffinity = getSafeAffinity(statusArray[j].xHandle);
-      taskCount++;
+    if (affinity >= 0 && affinity < NUM_CORES) {
+      coreRuntime[affinity].runtimeUs += taskDelta;
+      coreRuntime[affinity].taskCount++;
+      coreRuntime[affinity].cpuPercentTotal += taskData[i].cpuPercent;
     }
+
+    taskData[i].priority = status.uxCurrentPriority;
+    taskData[i].state = status.eCurrentState;
+    taskData[i].stackHighWater = status.xHandle ? uxTaskGetStackHighWaterMark(status.xHandle) : 0;
+    taskData[i].stackHealth = stackHealthFor(taskData[i].stackHighWater, taskData[i].stackSize);
   }
 
-  for (int c = 0; c < NUM_CORES; c++) {
-    coreRuntime[c].prevTotalRuntime100ms = coreRuntime[c].totalRuntime100ms;
+  /* Tasks missing from the snapshot have been deleted; close the gaps, keeping order */
+  uint8_t kept = 0;
+  for (uint8_t i = 0; i < taskCount; i++) {
+    if (!seen[i]) continue;
+    if (kept != i) taskData[kept] = taskData[i];
+    kept++;
   }
+  taskCount = kept;
+  statsInitialized = true;
+
+  updateIdleLoad();
+  publishTaskStats();
 }
 
+/* checkTaskStacks: Hands the latest sample to the stack monitor every STACK_CHECK_INTERVAL; statsTask only */
 void checkTaskStacks() {
   uint32_t now = millis();
   if (now - lastStackCheck < STACK_CHECK_INTERVAL) return;
   lastStackCheck = now;
-
-  if (webTaskHandle) {
-    UBaseType_t hwm = uxTaskGetStackHighWaterMark(webTaskHandle);
-    if (hwm < 500) {
-      addErrorLog(String("webTask low stack: ") + hwm, millis() / 1000);
-    }
-  }
-  if (bizTaskHandle) {
-    UBaseType_t hwm = uxTaskGetStackHighWaterMark(bizTaskHandle);
-    if (hwm < 500) {
-      addErrorLog(String("bizTask low stack: ") + hwm, millis() / 1000);
-    }
-  }
-  if (sysTaskHandle) {
-    UBaseType_t hwm = uxTaskGetStackHighWaterMark(sysTaskHandle);
-    if (hwm < 500) {
-      addErrorLog(String("sysTask low stack: ") + hwm, millis() / 1000);
-    }
-  }
+  stackMonitorUpdate(taskData, taskCount);
 }
 
 #endif
\ No newline at end of file
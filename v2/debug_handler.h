@@ -7,7 +7,9 @@
    - Task stack monitoring
    - FreeRTOS runtime statistics
    
-   Logs are circular buffers that persist across reboots for debugging.
+   Logs are ring buffers (one per category) that persist across reboots
+   for debugging. Entries are binary events (log_events.h): an ID and raw
+   arguments, formatted only when read.
    ============================================================================== */
 
 /* Header guard to prevent multiple inclusion of debug_handler.h */
@@ -19,14 +21,87 @@
 #if DEBUG_MODE
 
 #include <Arduino.h>
+#include <type_traits>
+#include "types.h"
+#include "log_events.h"
+
+struct LogEventArgs {
+  uint32_t v[LOG_EVENT_ARGS];
+  uint8_t count;
+  const char* str;
+};
+
+/* Stamps and appends an event without taking any lock: the time-valid flag is an atomic and the slot is
+   claimed by CAS (retried only while other producers race). Full rings drop. Use the LOG_* macros */
+void addLogEvent(LogCategory cat, LogEventId id, const LogEventArgs& args);
+
+static inline void packLogArg(LogEventArgs& a, const char* s) { a.str = s; }
+static inline void packLogArg(LogEventArgs& a, char* s) { a.str = s; }
+static inline void packLogArg(LogEventArgs& a, const String& s) { a.str = s.c_str(); }
+
+template <typename T>
+static inline void packLogArg(LogEventArgs& a, T v) {
+  static_assert(std::is_integral<T>::value || std::is_enum<T>::value, "Log event arguments are integers or strings");
+  a.v[a.count++] = (uint32_t)v;
+}
+
+template <typename T>
+constexpr bool isLogIntArg() {
+  return std::is_integral<typename std::decay<T>::type>::value || std::is_enum<typename std::decay<T>::type>::value;
+}
+
+/* Checks the arguments against the event's format at compile time, then packs them */
+template <LogEventId ID, typename... Args>
+static inline void logEvent(LogCategory cat, const Args&... args) {
+  static_assert(logFormatArgs(logEventFormat(ID), false) <= LOG_EVENT_ARGS, "Too many integer conversions in the format");
+  static_assert(logFormatArgs(logEventFormat(ID), true) <= 1, "At most one %s per format");
+  static_assert((0 + ... + (isLogIntArg<Args>() ? 1 : 0)) == logFormatArgs(logEventFormat(ID), false) &&
+                (0 + ... + (isLogIntArg<Args>() ? 0 : 1)) == logFormatArgs(logEventFormat(ID), true),
+                "Arguments do not match the event's format");
+  LogEventArgs a = {};
+  (packLogArg(a, args), ...);
+  addLogEvent(cat, ID, a);
+}
+
+/* Copies a category's entries oldest first into out[MAX_DEBUG_LOGS]; returns how many */
+uint8_t copyLogs(LogCategory cat, LogEntry* out);
+
+/* Oldest committed entry with a ticket past `after`, and its ticket in seq. False at the end,
+   or at an entry still being written so a cursor never skips it. Tickets only grow until the
+   log generation changes */
+bool nextLogEntry(LogCategory cat, uint32_t after, LogEntry& entry, uint32_t& seq);
+
+/* Changes on every boot and every clear, when tickets may restart or entries vanish */
+uint32_t getLogGeneration();
+
+struct LogCounters {
+  uint32_t reboot;
+  uint32_t wifi;
+  uint32_t error;
+  uint32_t dropped;  /* All categories: the ring lapped a writer that had not committed yet */
+};
+
+/* Entries logged since boot; the rings only keep the last MAX_DEBUG_LOGS of each */
+void getLogCounters(LogCounters& out);
 
-void addErrorLog(const String& msg, uint32_t uptimeSec);
+void updateTaskMonitoring();
 
-void addRebootLog(const String& msg, uint32_t uptimeSec);
+/* Consistent copies of the latest sample; false until the sampler has published one */
+bool getTaskStatsSnapshot(TaskStatsSnapshot& out);
 
-void addWifiLog(const String& msg, uint32_t uptimeSec);
+bool getCoreStatsSnapshot(CoreRuntimeData* cores, uint8_t* loadPct);
 
-void updateTaskMonitoring();
+struct TaskCpuSample {
+  char name[configMAX_TASK_NAME_LEN];
+  uint8_t cpuPercent;
+};
+
+/* Name and CPU% of every task in the latest sample; returns how many were written */
+uint8_t getTaskCpuSamples(TaskCpuSample* out, uint8_t max);
+
+const char* taskStateName(eTaskState s);
+
+const char* stackHealthName(StackHealth health);
 
 void checkTaskStacks();
 
@@ -38,15 +113,15 @@ String formatResetReason(esp_reset_reason_t reason);
 
 void flashWriteTask(void* param);
 
-#define LOG_ERROR(msg, uptime) addErrorLog(msg, uptime)
-#define LOG_WIFI(msg, uptime) addWifiLog(msg, uptime)
-#define LOG_REBOOT(msg, uptime) addRebootLog(msg, uptime)
+#define LOG_ERROR(id, ...) logEvent<id>(LOG_CAT_ERROR, ##__VA_ARGS__)
+#define LOG_WIFI(id, ...) logEvent<id>(LOG_CAT_WIFI, ##__VA_ARGS__)
+#define LOG_REBOOT(id, ...) logEvent<id>(LOG_CAT_REBOOT, ##__VA_ARGS__)
 
 #else
 
-#define LOG_ERROR(msg, uptime) (void)0
-#define LOG_WIFI(msg, uptime) (void)0
-#define LOG_REBOOT(msg, uptime) (void)0
+#define LOG_ERROR(id, ...) (void)0
+#define LOG_WIFI(id, ...) (void)0
+#define LOG_REBOOT(id, ...) (void)0
 
 #endif
 
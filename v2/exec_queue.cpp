@@ -0,0 +1,286 @@
+/* ==============================================================================
+   EXEC_QUEUE.CPP - Prioritised Command Queue Implementation
+
+   One FreeRTOS queue per lane carries ExecMessage pointers. Each lane queue
+   is as deep as the number of pool slots that lane can ever hold, so once a
+   slot is allocated the send cannot fail for lack of room.
+
+   Every message is stamped with its enqueue time; the dequeue side turns
+   that into per-lane wait statistics (moving average and maximum).
+   Counters are atomics because producers (webTask) and the biz workers
+   may run on different cores.
+
+   Worker pool: the lane queues are shared, so whichever worker is free
+   takes the next message, on either core. Keyed commands go to the home
+   queue of one worker instead, which serialises them. Idle workers park in
+   ulTaskNotifyTake() with their bit set in idleWorkers; a producer claims
+   one bit per message it queues and notifies that worker. A worker sets
+   its bit before its last pending check, so no submission is missed.
+   ============================================================================== */
+
+#include "exec_queue.h"
+#include "globals.h"
+#include "msg_pool.h"
+#include "cmd_registry.h"
+#include "exec_result.h"
+#include "exec_stats.h"
+#include <atomic>
+
+static_assert(EXEC_BATCH_MAX <= MSG_POOL_SIZE - MSG_POOL_CONTROL_SLOTS, "A batch must fit in the bulk slots");
+static_assert(BIZ_WORKERS >= 1 && BIZ_WORKERS <= 32, "idleWorkers is a 32-bit mask");
+
+/* Control may borrow bulk slots, so it can hold the whole pool; bulk cannot touch control slots */
+static const UBaseType_t kLaneDepth[EXEC_LANE_COUNT] = {
+  MSG_POOL_SIZE,
+  MSG_POOL_SIZE - MSG_POOL_CONTROL_SLOTS
+};
+
+struct LaneCounters {
+  std::atomic<uint32_t> enqueued;
+  std::atomic<uint32_t> dequeued;
+  std::atomic<uint32_t> dropped;
+  std::atomic<uint32_t> highWater;
+  std::atomic<uint32_t> waitAvgUs;
+  std::atomic<uint32_t> waitMaxUs;
+};
+
+static LaneCounters laneCounters[EXEC_LANE_COUNT];
+static std::atomic<uint32_t> idleWorkers(0);
+
+static void atomicMax(std::atomic<uint32_t>& slot, uint32_t value) {
+  uint32_t cur = slot.load(std::memory_order_relaxed);
+  while (value > cur &&
+         !slot.compare_exchange_weak(cur, value, std::memory_order_relaxed)) {
+  }
+}
+
+/* Exponential moving average with weight 1/8; cannot overflow however long the uptime */
+static void atomicAverage(std::atomic<uint32_t>& slot, uint32_t sample) {
+  uint32_t cur = slot.load(std::memory_order_relaxed);
+  uint32_t next;
+  do {
+    next = (uint32_t)((int32_t)cur + (((int32_t)sample - (int32_t)cur) / 8));
+  } while (!slot.compare_exchange_weak(cur, next, std::memory_order_relaxed));
+}
+
+void execQueueInit() {
+  for (int lane = 0; lane < EXEC_LANE_COUNT; lane++) {
+    execQ[lane] = xQueueCreate(kLaneDepth[lane], sizeof(ExecMessage*));
+    if (!execQ[lane]) {
+      Serial.printf("ERROR: Failed to create %s exec queue!\n", execLaneName((ExecLane)lane));
+    }
+  }
+  /* A worker's home queue can hold every bulk slot, like the shared bulk lane */
+  for (int worker = 0; worker < BIZ_WORKERS; worker++) {
+    execHomeQ[worker] = xQueueCreate(kLaneDepth[EXEC_LANE_BULK], sizeof(ExecMessage*));
+    if (!execHomeQ[worker]) {
+      Serial.printf("ERROR: Failed to create home queue for biz worker %d!\n", worker);
+    }
+  }
+}
+
+ExecLane execLaneFor(const char* line) {
+  const CmdEntry* entry = cmdFind(line);
+  return (entry && (entry->flags & CMD_FLAG_CONTROL)) ? EXEC_LANE_CONTROL : EXEC_LANE_BULK;
+}
+
+/* execWorkerForKey: FNV-1a of the key picks the worker that owns it */
+uint8_t execWorkerForKey(const char* key) {
+  if (!key || !*key) return EXEC_NO_WORKER;
+  uint32_t hash = 2166136261UL;
+  while (*key) {
+    hash ^= (uint8_t)*key++;
+    hash *= 16777619UL;
+  }
+  return (uint8_t)(hash % BIZ_WORKERS);
+}
+
+static uint32_t homeDepth() {
+  uint32_t depth = 0;
+  for (int worker = 0; worker < BIZ_WORKERS; worker++) {
+    if (execHomeQ[worker]) depth += uxQueueMessagesWaiting(execHomeQ[worker]);
+  }
+  return depth;
+}
+
+static uint32_t totalDepth() {
+  uint32_t depth = homeDepth();
+  for (int lane = 0; lane < EXEC_LANE_COUNT; lane++) {
+    if (execQ[lane]) depth += uxQueueMessagesWaiting(execQ[lane]);
+  }
+  return depth;
+}
+
+void execWorkerIdle(uint8_t worker, bool idle) {
+  uint32_t bit = 1UL << worker;
+  if (idle) {
+    idleWorkers.fetch_or(bit, std::memory_order_seq_cst);
+  } else {
+    idleWorkers.fetch_and(~bit, std::memory_order_relaxed);
+  }
+}
+
+static void notifyWorker(uint8_t worker) {
+  TaskHandle_t handle = bizTaskHandles[worker];
+  if (handle) xTaskNotifyGive(handle);
+}
+
+/* wakeWorkers: Claims up to `count` idle workers for shared-lane work and notifies them */
+static void wakeWorkers(uint8_t count) {
+  uint32_t idle = idleWorkers.load(std::memory_order_seq_cst);
+  while (count > 0 && idle != 0) {
+    uint8_t worker = (uint8_t)__builtin_ctz(idle);
+    uint32_t bit = 1UL << worker;
+    if (idleWorkers.compare_exchange_weak(idle, idle & ~bit, std::memory_order_seq_cst)) {
+      notifyWorker(worker);
+      idle &= ~bit;
+      count--;
+    }
+  }
+}
+
+/* wakeFor: Keyed work can only run on its home worker; anything else goes to any idle worker */
+static void wakeFor(uint8_t home, uint8_t count) {
+  if (home == EXEC_NO_WORKER) {
+    wakeWorkers(count);
+  } else {
+    execWorkerIdle(home, false);
+    notifyWorker(home);
+  }
+}
+
+/* queueFor: Control always takes the shared control lane; keyed bulk goes to its home worker */
+static QueueHandle_t queueFor(const ExecMessage* msg) {
+  if (msg->lane == EXEC_LANE_BULK && msg->home != EXEC_NO_WORKER) return execHomeQ[msg->home];
+  return execQ[msg->lane];
+}
+
+/* enqueueMessage: Fills, stamps and queues an allocated message on its lane; frees it on failure.
+   Returns the completion ID (0 on failure); msg must not be touched after a successful send. */
+static uint32_t enqueueMessage(ExecMessage* msg, const char* cmd, size_t len, uint32_t receivedUs, uint8_t home) {
+  LaneCounters& counters = laneCounters[msg->lane];
+  memcpy(msg->payload, cmd, len);
+  msg->payload[len] = '\0';
+  msg->length = len;
+  msg->receivedUs = receivedUs;
+  msg->home = home;
+  uint32_t enqueuedUs = msg->enqueuedUs = micros();
+  uint32_t id = msg->id = execResultOpen(enqueuedUs);
+
+  QueueHandle_t queue = queueFor(msg);
+  if (!queue || xQueueSend(queue, &msg, 0) != pdTRUE) {
+    execResultFinish(id, EXEC_STATE_DROPPED, 0);
+    freeMessage(msg);
+    counters.dropped.fetch_add(1, std::memory_order_relaxed);
+    execStatsNoteRejected(false, 1);
+    return 0;
+  }
+
+  counters.enqueued.fetch_add(1, std::memory_order_relaxed);
+  uint32_t depth = uxQueueMessagesWaiting(execQ[msg->lane]);
+  if (msg->lane == EXEC_LANE_BULK) depth += homeDepth();
+  atomicMax(counters.highWater, depth);
+  execStatsRecord(EXEC_STAGE_ACCEPT, enqueuedUs - receivedUs);
+  execStatsNoteDepth(totalDepth());
+  return id;
+}
+
+ExecSubmitResult execSubmit(const char* cmd, size_t len, uint32_t receivedUs, uint32_t* idOut, const char* key) {
+  ExecLane lane = execLaneFor(cmd);
+  uint8_t home = (lane == EXEC_LANE_BULK) ? execWorkerForKey(key) : EXEC_NO_WORKER;
+
+  if (len >= MAX_MSG_SIZE) len = MAX_MSG_SIZE - 1;
+  ExecMessage* msg = allocMessage(lane, len);
+  if (!msg) {
+    laneCounters[lane].dropped.fetch_add(1, std::memory_order_relaxed);
+    execStatsNoteRejected(true, 1);
+    return EXEC_SUBMIT_POOL_EXHAUSTED;
+  }
+
+  uint32_t id = enqueueMessage(msg, cmd, len, receivedUs, home);
+  if (id == 0) return EXEC_SUBMIT_QUEUE_FULL;
+  if (idOut) *idOut = id;
+  wakeFor(home, 1);
+  return EXEC_SUBMIT_OK;
+}
+
+ExecSubmitResult execSubmitBatch(const char* const* cmds, const uint16_t* lens, uint8_t count,
+                                 uint32_t receivedUs, uint32_t* idsOut, const char* key) {
+  ExecMessage* msgs[EXEC_BATCH_MAX];
+  uint8_t home = execWorkerForKey(key);
+  if (count == 0 || count > EXEC_BATCH_MAX) return EXEC_SUBMIT_POOL_EXHAUSTED;
+
+  if (!allocMessageBatch(msgs, lens, count)) {
+    laneCounters[EXEC_LANE_BULK].dropped.fetch_add(count, std::memory_order_relaxed);
+    execStatsNoteRejected(true, count);
+    return EXEC_SUBMIT_POOL_EXHAUSTED;
+  }
+
+  /* Lane queues are sized to the slots they can hold, so these sends cannot run out of room */
+  ExecSubmitResult result = EXEC_SUBMIT_OK;
+  uint8_t shared = 0;
+  for (uint8_t i = 0; i < count; i++) {
+    ExecLane lane = msgs[i]->lane = execLaneFor(cmds[i]);
+    uint8_t msgHome = (lane == EXEC_LANE_BULK) ? home : EXEC_NO_WORKER;
+    uint32_t id = enqueueMessage(msgs[i], cmds[i], lens[i], receivedUs, msgHome);
+    if (id == 0) result = EXEC_SUBMIT_QUEUE_FULL;
+    if (idsOut) idsOut[i] = id;
+    if (msgHome == EXEC_NO_WORKER) shared++;
+  }
+  wakeWorkers(shared);
+  if (home != EXEC_NO_WORKER && shared < count) wakeFor(home, 1);
+  return result;
+}
+
+static bool receiveFrom(QueueHandle_t queue, ExecMessage** msg) {
+  return queue && xQueueReceive(queue, msg, 0) == pdTRUE;
+}
+
+/* execDequeue: Oldest control message, else (if allowed) the worker's keyed work, else shared bulk */
+ExecMessage* execDequeue(uint8_t worker, bool includeBulk) {
+  ExecMessage* msg = nullptr;
+  if (!receiveFrom(execQ[EXEC_LANE_CONTROL], &msg)) {
+    if (!includeBulk) return nullptr;
+    if (!receiveFrom(execHomeQ[worker], &msg) && !receiveFrom(execQ[EXEC_LANE_BULK], &msg)) return nullptr;
+  }
+  if (!msg) return nullptr;
+
+  LaneCounters& counters = laneCounters[msg->lane];
+  msg->dequeuedUs = micros();
+  uint32_t waitUs = msg->dequeuedUs - msg->enqueuedUs;
+  execStatsRecord(EXEC_STAGE_QUEUE, waitUs);
+  counters.dequeued.fetch_add(1, std::memory_order_relaxed);
+  atomicAverage(counters.waitAvgUs, waitUs);
+  atomicMax(counters.waitMaxUs, waitUs);
+  return msg;
+}
+
+static bool hasMessages(QueueHandle_t queue) {
+  return queue && uxQueueMessagesWaiting(queue) > 0;
+}
+
+bool execPending(uint8_t worker, bool includeBulk) {
+  if (hasMessages(execQ[EXEC_LANE_CONTROL])) return true;
+  return includeBulk && (hasMessages(execHomeQ[worker]) || hasMessages(execQ[EXEC_LANE_BULK]));
+}
+
+void getExecLaneStats(ExecLane lane, ExecLaneStats& out) {
+  const LaneCounters& counters = laneCounters[lane];
+  uint32_t depth = execQ[lane] ? uxQueueMessagesWaiting(execQ[lane]) : 0;
+  if (lane == EXEC_LANE_BULK) depth += homeDepth();
+  out.depth = (uint16_t)depth;
+  out.highWater = (uint16_t)counters.highWater.load(std::memory_order_relaxed);
+  out.enqueued = counters.enqueued.load(std::memory_order_relaxed);
+  out.dequeued = counters.dequeued.load(std::memory_order_relaxed);
+  out.dropped = counters.dropped.load(std::memory_order_relaxed);
+  out.waitMaxUs = counters.waitMaxUs.load(std::memory_order_relaxed);
+  out.waitAvgUs = counters.waitAvgUs.load(std::memory_order_relaxed);
+}
+
+const char* execLaneName(ExecLane lane) {
+  switch (lane) {
+    case EXEC_LANE_CONTROL: return "control";
+    case EXEC_LANE_BULK: return "bulk";
+    default: return "unknown";
+  }
+}
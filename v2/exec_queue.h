@@ -0,0 +1,60 @@
+/* ==============================================================================
+   EXEC_QUEUE.H - Prioritised Command Queue Interface
+
+   Commands submitted through /api/exec travel to the biz workers on one of
+   two lanes:
+   - Control lane: commands flagged CMD_FLAG_CONTROL (restart, stop, ...)
+   - Bulk lane: everything else
+   Workers always drain the control lane first, so a control command never
+   waits behind queued bulk work. Control also has reserved pool slots.
+
+   Both lanes are shared by all BIZ_WORKERS workers, so unkeyed commands may
+   run concurrently and finish out of order. Bulk commands submitted with a
+   key are routed to the home queue of one worker (hash of the key) and run
+   in submission order relative to each other.
+
+   Producers wake idle workers with a task notification; there is no polling.
+   ============================================================================== */
+
+/* Header guard to prevent multiple inclusion of exec_queue.h */
+#ifndef EXEC_QUEUE_H
+#define EXEC_QUEUE_H
+
+#include <Arduino.h>
+#include "types.h"
+
+enum ExecSubmitResult : uint8_t {
+  EXEC_SUBMIT_OK = 0,
+  EXEC_SUBMIT_POOL_EXHAUSTED,
+  EXEC_SUBMIT_QUEUE_FULL
+};
+
+#define EXEC_NO_WORKER 0xFF  /* ExecMessage::home for commands any worker may run */
+
+void execQueueInit();
+
+ExecLane execLaneFor(const char* line);
+
+uint8_t execWorkerForKey(const char* key);
+
+/* receivedUs is when the request arrived (micros()); idOut (optional) receives the completion ID;
+   key (optional) serialises the command with every other command that uses the same key */
+ExecSubmitResult execSubmit(const char* cmd, size_t len, uint32_t receivedUs, uint32_t* idOut = nullptr,
+                            const char* key = nullptr);
+
+/* Reserves pool slots for every command at once; on failure nothing is queued */
+ExecSubmitResult execSubmitBatch(const char* const* cmds, const uint16_t* lens, uint8_t count,
+                                 uint32_t receivedUs, uint32_t* idsOut = nullptr, const char* key = nullptr);
+
+ExecMessage* execDequeue(uint8_t worker, bool includeBulk);
+
+bool execPending(uint8_t worker, bool includeBulk);
+
+/* Workers mark themselves idle before their final pending check and busy once woken */
+void execWorkerIdle(uint8_t worker, bool idle);
+
+void getExecLaneStats(ExecLane lane, ExecLaneStats& out);
+
+const char* execLaneName(ExecLane lane);
+
+#endif
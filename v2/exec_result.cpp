@@ -0,0 +1,161 @@
+/* ==============================================================================
+   EXEC_RESULT.CPP - Command Completion Tracking Implementation
+
+   IDs come from one atomic counter and pick their slot by their low bits.
+   A slot whose command is still queued or running is never taken over:
+   the ID is skipped and the next one tried. Commands do not finish in the
+   order they were issued (a keyed command can wait behind a slow one while
+   other workers finish many more), so this is needed even though the ring
+   is larger than the message pool; that only guarantees the probe ends.
+
+   A slot is claimed by swapping its ID for EXEC_ID_CLAIMED, then its fields
+   are written and the new ID published; readers only trust a slot whose ID
+   matches the one they asked for.
+
+   Waiter hand-off: the waiter registers its task handle before re-checking
+   the state, and bizTask publishes the state before reading the waiter, so
+   one side always sees the other and no wake-up is lost.
+   ============================================================================== */
+
+#include "exec_result.h"
+#include "globals.h"
+#include <esp_task_wdt.h>
+#include <atomic>
+
+static_assert(EXEC_RESULT_SLOTS > MSG_POOL_SIZE,
+              "Each in-flight message holds a slot; a free one must remain for execResultOpen() to find");
+static_assert((EXEC_RESULT_SLOTS & (EXEC_RESULT_SLOTS - 1)) == 0, "EXEC_RESULT_SLOTS must be a power of two");
+
+#define EXEC_WAIT_SLICE_MS 100
+#define EXEC_ID_CLAIMED 0xFFFFFFFFUL  /* Slot being refilled; never handed out as an ID */
+
+struct ResultSlot {
+  std::atomic<uint32_t> id;
+  std::atomic<uint8_t> state;
+  uint8_t result;
+  uint32_t enqueuedUs;
+  uint32_t startUs;
+  uint32_t doneUs;
+  std::atomic<TaskHandle_t> waiter;
+};
+
+static ResultSlot resultSlots[EXEC_RESULT_SLOTS];
+static std::atomic<uint32_t> nextResultId(1);
+
+static inline ResultSlot& slotFor(uint32_t id) {
+  return resultSlots[id & (EXEC_RESULT_SLOTS - 1)];
+}
+
+/* claimSlot: Takes the slot over unless its command is still queued or running, or another
+   submitter is refilling it */
+static bool claimSlot(ResultSlot& slot) {
+  uint32_t prev = slot.id.load(std::memory_order_acquire);
+  if (prev == EXEC_ID_CLAIMED) return false;
+  uint8_t state = slot.state.load(std::memory_order_acquire);
+  if (state == EXEC_STATE_QUEUED || state == EXEC_STATE_RUNNING) return false;
+  /* Only a claim makes a slot busy, and it changes the ID first, so this fails if one got in between */
+  return slot.id.compare_exchange_strong(prev, EXEC_ID_CLAIMED, std::memory_order_acq_rel,
+                                         std::memory_order_relaxed);
+}
+
+uint32_t execResultOpen(uint32_t enqueuedUs) {
+  /* The caller already holds a message, so busy slots number fewer than MSG_POOL_SIZE and a free
+     one turns up within EXEC_RESULT_SLOTS IDs. Skipped IDs are never issued and read as expired */
+  uint32_t id;
+  do {
+    id = nextResultId.fetch_add(1, std::memory_order_relaxed);
+  } while (id == 0 || id == EXEC_ID_CLAIMED || !claimSlot(slotFor(id)));  /* 0 means "no ID" */
+
+  ResultSlot& slot = slotFor(id);
+  slot.state.store(EXEC_STATE_QUEUED, std::memory_order_relaxed);
+  slot.result = 0;
+  slot.enqueuedUs = enqueuedUs;
+  slot.startUs = enqueuedUs;
+  slot.doneUs = enqueuedUs;
+  slot.waiter.store(nullptr, std::memory_order_relaxed);
+  slot.id.store(id, std::memory_order_release);
+  return id;
+}
+
+void execResultStart(uint32_t id) {
+  ResultSlot& slot = slotFor(id);
+  if (id == 0 || slot.id.load(std::memory_order_acquire) != id) return;
+  slot.startUs = micros();
+  slot.state.store(EXEC_STATE_RUNNING, std::memory_order_release);
+}
+
+void execResultFinish(uint32_t id, ExecState state, uint8_t result) {
+  ResultSlot& slot = slotFor(id);
+  if (id == 0 || slot.id.load(std::memory_order_acquire) != id) return;
+  slot.result = result;
+  slot.doneUs = micros();
+  if (state == EXEC_STATE_DROPPED) slot.startUs = slot.doneUs;
+  slot.state.store(state, std::memory_order_seq_cst);
+
+  TaskHandle_t waiter = slot.waiter.exchange(nullptr, std::memory_order_seq_cst);
+  if (waiter) xTaskNotifyGive(waiter);
+}
+
+bool execResultGet(uint32_t id, ExecResultInfo& out) {
+  out.id = id;
+  out.state = EXEC_STATE_UNKNOWN;
+  out.result = 0;
+  out.queueUs = 0;
+  out.runUs = 0;
+
+  uint32_t issued = nextResultId.load(std::memory_order_relaxed);
+  if (id == 0 || id == EXEC_ID_CLAIMED || (int32_t)(id - issued) >= 0) return false;
+
+  ResultSlot& slot = slotFor(id);
+  if (slot.id.load(std::memory_order_acquire) != id) {
+    out.state = EXEC_STATE_EXPIRED;
+    return true;
+  }
+
+  ExecState state = (ExecState)slot.state.load(std::memory_order_acquire);
+  out.result = slot.result;
+  if (state >= EXEC_STATE_RUNNING) out.queueUs = slot.startUs - slot.enqueuedUs;
+  if (state >= EXEC_STATE_DONE) out.runUs = slot.doneUs - slot.startUs;
+
+  /* The slot may have been recycled while we copied it */
+  out.state = (slot.id.load(std::memory_order_acquire) == id) ? state : EXEC_STATE_EXPIRED;
+  return true;
+}
+
+/* execResultWait: Blocks the calling task until the command settles or waitMs elapses */
+bool execResultWait(uint32_t id, uint32_t waitMs, ExecResultInfo& out) {
+  if (!execResultGet(id, out)) return false;
+
+  ResultSlot& slot = slotFor(id);
+  TaskHandle_t self = nullptr;
+  uint32_t start = millis();
+  while (out.state == EXEC_STATE_QUEUED || out.state == EXEC_STATE_RUNNING) {
+    uint32_t elapsed = millis() - start;
+    if (elapsed >= waitMs) break;
+
+    if (!self) self = xTaskGetCurrentTaskHandle();
+    slot.waiter.store(self, std::memory_order_seq_cst);
+    execResultGet(id, out);
+    if (out.state != EXEC_STATE_QUEUED && out.state != EXEC_STATE_RUNNING) break;
+
+    uint32_t slice = waitMs - elapsed;
+    if (slice > EXEC_WAIT_SLICE_MS) slice = EXEC_WAIT_SLICE_MS;
+    ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(slice));
+    esp_task_wdt_reset();
+    execResultGet(id, out);
+  }
+
+  if (self) slot.waiter.compare_exchange_strong(self, nullptr, std::memory_order_relaxed);
+  return true;
+}
+
+const char* execStateName(ExecState state) {
+  switch (state) {
+    case EXEC_STATE_QUEUED: return "queued";
+    case EXEC_STATE_RUNNING: return "running";
+    case EXEC_STATE_DONE: return "done";
+    case EXEC_STATE_DROPPED: return "dropped";
+    case EXEC_STATE_EXPIRED: return "expired";
+    default: return "unknown";
+  }
+}
@@ -0,0 +1,51 @@
+/* ==============================================================================
+   EXEC_RESULT.H - Command Completion Tracking Interface
+
+   Every command accepted by /api/exec gets a non-zero ID and a completion
+   slot recording its state, registry result code and timings. Slots live in
+   a fixed ring indexed by ID; a slot is reused once EXEC_RESULT_SLOTS newer
+   commands have been issued, and only after its own command has finished,
+   so a queued command never loses its slot and results stay readable for a
+   while after completion.
+
+   A web handler can block on a slot with execResultWait(); bizTask wakes it
+   with a task notification the moment the command finishes.
+   ============================================================================== */
+
+/* Header guard to prevent multiple inclusion of exec_result.h */
+#ifndef EXEC_RESULT_H
+#define EXEC_RESULT_H
+
+#include <Arduino.h>
+#include "types.h"
+
+enum ExecState : uint8_t {
+  EXEC_STATE_UNKNOWN = 0,
+  EXEC_STATE_QUEUED,
+  EXEC_STATE_RUNNING,
+  EXEC_STATE_DONE,
+  EXEC_STATE_DROPPED,
+  EXEC_STATE_EXPIRED
+};
+
+struct ExecResultInfo {
+  uint32_t id;
+  ExecState state;
+  uint8_t result;
+  uint32_t queueUs;
+  uint32_t runUs;
+};
+
+uint32_t execResultOpen(uint32_t enqueuedUs);
+
+void execResultStart(uint32_t id);
+
+void execResultFinish(uint32_t id, ExecState state, uint8_t result);
+
+bool execResultGet(uint32_t id, ExecResultInfo& out);
+
+bool execResultWait(uint32_t id, uint32_t waitMs, ExecResultInfo& out);
+
+const char* execStateName(ExecState state);
+
+#endif
@@ -0,0 +1,138 @@
+/* ==============================================================================
+   EXEC_STATS.CPP - Command Pipeline Latency Instrumentation Implementation
+
+   Histogram bucket 0 counts samples below 1us; bucket i (i >= 1) counts
+   samples in [2^(i-1), 2^i) us and the last bucket absorbs everything above.
+   Percentiles are interpolated linearly inside the bucket that contains
+   the requested rank, which keeps the error below one bucket width while
+   the whole histogram set costs well under 1KB of static RAM.
+
+   Recording is a couple of relaxed atomic increments, so it is safe from
+   the web task and bizTask on either core.
+   ============================================================================== */
+
+#include "exec_stats.h"
+#include <atomic>
+
+#define EXEC_HIST_BUCKETS 25  /* Last bucket starts at 2^23us (~8.4s) */
+
+struct LatencyHistogram {
+  std::atomic<uint32_t> buckets[EXEC_HIST_BUCKETS];
+  std::atomic<uint32_t> maxUs;
+};
+
+static LatencyHistogram histograms[EXEC_STAGE_COUNT];
+static std::atomic<uint32_t> depthHighWater(0);
+static std::atomic<uint32_t> rejectedPool(0);
+static std::atomic<uint32_t> rejectedQueue(0);
+
+static inline uint8_t bucketFor(uint32_t us) {
+  uint8_t bucket = 0;
+  while (us > 0 && bucket < EXEC_HIST_BUCKETS - 1) {
+    us >>= 1;
+    bucket++;
+  }
+  return bucket;
+}
+
+static inline uint32_t bucketLow(uint8_t bucket) {
+  return bucket == 0 ? 0 : (1UL << (bucket - 1));
+}
+
+static inline uint32_t bucketHigh(uint8_t bucket) {
+  return 1UL << bucket;
+}
+
+static void storeMax(std::atomic<uint32_t>& slot, uint32_t value) {
+  uint32_t cur = slot.load(std::memory_order_relaxed);
+  while (value > cur &&
+         !slot.compare_exchange_weak(cur, value, std::memory_order_relaxed)) {
+  }
+}
+
+void execStatsRecord(ExecStage stage, uint32_t us) {
+  if (stage >= EXEC_STAGE_COUNT) return;
+  LatencyHistogram& h = histograms[stage];
+  h.buckets[bucketFor(us)].fetch_add(1, std::memory_order_relaxed);
+  storeMax(h.maxUs, us);
+}
+
+void execStatsComplete(const ExecMessage* msg, uint32_t doneUs) {
+  execStatsRecord(EXEC_STAGE_RUN, doneUs - msg->dequeuedUs);
+  execStatsRecord(EXEC_STAGE_TOTAL, doneUs - msg->receivedUs);
+}
+
+void execStatsNoteDepth(uint32_t depth) {
+  storeMax(depthHighWater, depth);
+}
+
+void execStatsNoteRejected(bool poolExhausted, uint32_t count) {
+  (poolExhausted ? rejectedPool : rejectedQueue).fetch_add(count, std::memory_order_relaxed);
+}
+
+/* percentileOf: Interpolated value at the given rank (per mille) from a bucket snapshot */
+static uint32_t percentileOf(const uint32_t* buckets, uint32_t total, uint32_t perMille, uint32_t maxUs) {
+  if (total == 0) return 0;
+  uint32_t rank = (uint32_t)(((uint64_t)total * perMille + 999) / 1000);
+  if (rank == 0) rank = 1;
+
+  uint32_t seen = 0;
+  for (uint8_t b = 0; b < EXEC_HIST_BUCKETS; b++) {
+    if (buckets[b] == 0) continue;
+    if (seen + buckets[b] >= rank) {
+      uint32_t low = bucketLow(b);
+      uint32_t high = (b == EXEC_HIST_BUCKETS - 1 || maxUs < bucketHigh(b)) ? maxUs : bucketHigh(b);
+      if (high < low) high = low;
+      return low + (uint32_t)(((uint64_t)(high - low) * (rank - seen)) / buckets[b]);
+    }
+    seen += buckets[b];
+  }
+  return maxUs;
+}
+
+void getExecLatency(ExecStage stage, ExecLatencySummary& out) {
+  out = ExecLatencySummary();
+  if (stage >= EXEC_STAGE_COUNT) return;
+
+  const LatencyHistogram& h = histograms[stage];
+  uint32_t snapshot[EXEC_HIST_BUCKETS];
+  uint32_t total = 0;
+  for (uint8_t b = 0; b < EXEC_HIST_BUCKETS; b++) {
+    snapshot[b] = h.buckets[b].load(std::memory_order_relaxed);
+    total += snapshot[b];
+  }
+
+  out.count = total;
+  out.maxUs = h.maxUs.load(std::memory_order_relaxed);
+  out.p50Us = percentileOf(snapshot, total, 500, out.maxUs);
+  out.p95Us = percentileOf(snapshot, total, 950, out.maxUs);
+  out.p99Us = percentileOf(snapshot, total, 990, out.maxUs);
+}
+
+void getExecPipelineCounters(ExecPipelineCounters& out) {
+  out.depthHighWater = depthHighWater.load(std::memory_order_relaxed);
+  out.rejectedPoolExhausted = rejectedPool.load(std::memory_order_relaxed);
+  out.rejectedQueueFull = rejectedQueue.load(std::memory_order_relaxed);
+}
+
+void execStatsReset() {
+  for (uint8_t s = 0; s < EXEC_STAGE_COUNT; s++) {
+    for (uint8_t b = 0; b < EXEC_HIST_BUCKETS; b++) {
+      histograms[s].buckets[b].store(0, std::memory_order_relaxed);
+    }
+    histograms[s].maxUs.store(0, std::memory_order_relaxed);
+  }
+  depthHighWater.store(0, std::memory_order_relaxed);
+  rejectedPool.store(0, std::memory_order_relaxed);
+  rejectedQueue.store(0, std::memory_order_relaxed);
+}
+
+const char* execStageName(ExecStage stage) {
+  switch (stage) {
+    case EXEC_STAGE_ACCEPT: return "accept";
+    case EXEC_STAGE_QUEUE: return "queue";
+    case EXEC_STAGE_RUN: return "run";
+    case EXEC_STAGE_TOTAL: return "total";
+    default: return "unknown";
+  }
+}
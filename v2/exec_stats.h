@@ -0,0 +1,59 @@
+/* ==============================================================================
+   EXEC_STATS.H - Command Pipeline Latency Instrumentation Interface
+
+   Splits the life of an /api/exec command into stages and keeps a fixed-size
+   log2 histogram for each:
+   - accept: HTTP handler entry -> queued (JSON parse, validation, pool alloc)
+   - queue:  queued -> taken by bizTask
+   - run:    taken by bizTask -> command finished
+   - total:  HTTP handler entry -> command finished
+   Also tracks the combined queue-depth high-water mark and the number of
+   commands rejected because the pool was exhausted or a queue was full.
+   ============================================================================== */
+
+/* Header guard to prevent multiple inclusion of exec_stats.h */
+#ifndef EXEC_STATS_H
+#define EXEC_STATS_H
+
+#include <Arduino.h>
+#include "types.h"
+
+enum ExecStage : uint8_t {
+  EXEC_STAGE_ACCEPT = 0,
+  EXEC_STAGE_QUEUE,
+  EXEC_STAGE_RUN,
+  EXEC_STAGE_TOTAL,
+  EXEC_STAGE_COUNT
+};
+
+struct ExecLatencySummary {
+  uint32_t count;
+  uint32_t p50Us;
+  uint32_t p95Us;
+  uint32_t p99Us;
+  uint32_t maxUs;
+};
+
+struct ExecPipelineCounters {
+  uint32_t depthHighWater;
+  uint32_t rejectedPoolExhausted;
+  uint32_t rejectedQueueFull;
+};
+
+void execStatsRecord(ExecStage stage, uint32_t us);
+
+void execStatsComplete(const ExecMessage* msg, uint32_t doneUs);
+
+void execStatsNoteDepth(uint32_t depth);
+
+void execStatsNoteRejected(bool poolExhausted, uint32_t count);
+
+void getExecLatency(ExecStage stage, ExecLatencySummary& out);
+
+void getExecPipelineCounters(ExecPipelineCounters& out);
+
+void execStatsReset();
+
+const char* execStageName(ExecStage stage);
+
+#endif
@@ -34,7 +34,6 @@ WebServer server(80);
 Preferences prefs;
 
 SemaphoreHandle_t wifiMutex = nullptr;
-SemaphoreHandle_t poolMutex = nullptr;
 SemaphoreHandle_t timeMutex = nullptr;
 volatile bool serverStarted = false;
 volatile bool bootComplete = false;
@@ -54,40 +53,29 @@ uint8_t wifiReconnectAttempts = 0;
 ExecMessage msgPool[MSG_POOL_SIZE];  /* Pre-allocated message pool avoids malloc/free */
 
 volatile BizState gBizState = BIZ_STOPPED;
-QueueHandle_t execQ = nullptr;
+QueueHandle_t execQ[EXEC_LANE_COUNT] = { nullptr, nullptr };
+QueueHandle_t execHomeQ[BIZ_WORKERS] = {};
 volatile uint32_t bizProcessed = 0;
+volatile uint32_t bizCmdRate = 0;
+volatile uint32_t bizWorkerProcessed[BIZ_WORKERS] = {};
 
 TaskHandle_t webTaskHandle = nullptr;
-TaskHandle_t bizTaskHandle = nullptr;
+TaskHandle_t bizTaskHandles[BIZ_WORKERS] = {};
 TaskHandle_t sysTaskHandle = nullptr;
+TaskHandle_t statsTaskHandle = nullptr;
 
 #if ESP32_HAS_TEMP
 temperature_sensor_handle_t s_temp_sensor = NULL;
 #endif
 
-bool timeInitialized = false;
+std::atomic<bool> timeInitialized(false);
 time_t lastNtpSync = 0;
 
 volatile uint8_t coreLoadPct[2] = { 0, 0 };
 
 #if DEBUG_MODE
-TaskMonitorData taskData[MAX_TASKS_MONITORED];
-uint8_t taskCount = 0;
-uint32_t lastTaskSample = 0;
-bool statsInitialized = false;
-
-CoreRuntimeData coreRuntime[2];
-uint64_t noAffinityRuntime100ms = 0;
-
 uint32_t lastStackCheck = 0;
 
-LogEntry rebootLogs[MAX_DEBUG_LOGS];
-uint8_t rebootLogCount = 0;
-LogEntry wifiLogs[MAX_DEBUG_LOGS];
-uint8_t wifiLogCount = 0;
-LogEntry errorLogs[MAX_DEBUG_LOGS];
-uint8_t errorLogCount = 0;
-
 QueueHandle_t flashWriteQueue = nullptr;
 TaskHandle_t flashWriteTaskHandle = nullptr;
 SemaphoreHandle_t flashWriteMutex = nullptr;
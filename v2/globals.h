@@ -22,6 +22,7 @@
 #include <freertos/FreeRTOS.h>
 #include <freertos/queue.h>
 
+#include <atomic>
 #include "config.h"
 #include "types.h"
 
@@ -48,7 +49,6 @@ extern WebServer server;
 extern Preferences prefs;
 
 extern SemaphoreHandle_t wifiMutex;
-extern SemaphoreHandle_t poolMutex;
 extern SemaphoreHandle_t timeMutex;
 extern volatile bool serverStarted;
 extern volatile bool bootComplete;
@@ -68,41 +68,29 @@ extern uint8_t wifiReconnectAttempts;
 extern ExecMessage msgPool[MSG_POOL_SIZE];  /* Pre-allocated message pool avoids malloc/free */
 
 extern volatile BizState gBizState;
-extern QueueHandle_t execQ;
+extern QueueHandle_t execQ[EXEC_LANE_COUNT];
+extern QueueHandle_t execHomeQ[BIZ_WORKERS];  /* Per-worker queues for keyed (ordered) commands */
 extern volatile uint32_t bizProcessed;
+extern volatile uint32_t bizCmdRate;
+extern volatile uint32_t bizWorkerProcessed[BIZ_WORKERS];
 
 extern TaskHandle_t webTaskHandle;
-extern TaskHandle_t bizTaskHandle;
+extern TaskHandle_t bizTaskHandles[BIZ_WORKERS];
 extern TaskHandle_t sysTaskHandle;
+extern TaskHandle_t statsTaskHandle;
 
 #if ESP32_HAS_TEMP
 extern temperature_sensor_handle_t s_temp_sensor;
 #endif
 
-extern bool timeInitialized;
+extern std::atomic<bool> timeInitialized;  /* Set once after the first NTP sync; read without timeMutex */
 extern time_t lastNtpSync;
 
-extern volatile uint8_t coreLoadPct[2];
+extern volatile uint8_t coreLoadPct[2];  /* Written only by the stats sampler */
 
 #if DEBUG_MODE
-#define MAX_TASKS_MONITORED 64
-
-extern TaskMonitorData taskData[MAX_TASKS_MONITORED];
-extern uint8_t taskCount;
-extern uint32_t lastTaskSample;
-extern bool statsInitialized;
-
-extern CoreRuntimeData coreRuntime[2];
-extern uint64_t noAffinityRuntime100ms;
 extern uint32_t lastStackCheck;
 
-extern LogEntry rebootLogs[MAX_DEBUG_LOGS];
-extern uint8_t rebootLogCount;
-extern LogEntry wifiLogs[MAX_DEBUG_LOGS];
-extern uint8_t wifiLogCount;
-extern LogEntry errorLogs[MAX_DEBUG_LOGS];
-extern uint8_t errorLogCount;
-
 extern QueueHandle_t flashWriteQueue;
 extern TaskHandle_t flashWriteTaskHandle;
 extern SemaphoreHandle_t flashWriteMutex;
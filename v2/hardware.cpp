@@ -22,7 +22,7 @@ float getInternalTemperatureC() {
   }
   #if DEBUG_MODE
   else {
-    addErrorLog(F("Failed to read temperature"), millis() / 1000);
+    LOG_ERROR(EVT_TEMP_READ_FAILED);
   }
   #endif
 #endif
@@ -0,0 +1,371 @@
+/* ==============================================================================
+   HEAP_TRACKER.CPP - Per-Subsystem Heap Accounting Implementation
+
+   Every tracked block carries an 8-byte header (size, tag, magic) in front
+   of the caller's pointer. Counters for all tags share one spinlock held
+   for a handful of instructions per call, so allocations on the web, OTA
+   and BLE tasks (either core) never see a torn update.
+
+   History points store heap sizes in HEAP_HIST_UNIT-byte units to keep a
+   multi-week ring small; the API scales them back to bytes.
+   ============================================================================== */
+
+#include "heap_tracker.h"
+
+#if ENABLE_HEAP_TRACK
+
+#include "globals.h"
+#include "web_handler.h"
+#include <esp_timer.h>
+#include <atomic>
+
+#define HEAP_BLOCK_MAGIC 0xA5
+#define HEAP_HIST_UNIT 16
+#define HEAP_HIST_LEVELS 2
+
+/* 8 bytes keeps the caller's block as aligned as malloc's own */
+struct HeapBlockHeader {
+  uint32_t size;
+  uint8_t tag;
+  uint8_t magic;
+  uint16_t reserved;
+};
+
+static_assert(sizeof(HeapBlockHeader) == 8, "Heap block header must stay 8 bytes");
+
+struct TagAccount {
+  uint32_t live;
+  uint32_t peak;
+  uint32_t windowPeak;  /* Highest live since the last history sample */
+  uint32_t maxBlock;
+  uint32_t allocs;
+  uint32_t frees;
+  uint32_t failed;
+  uint64_t allocBytes;
+  uint32_t footprint;
+};
+
+struct HeapPoint {
+  uint32_t startSec;
+  uint32_t allocs[HEAP_TAG_COUNT];
+  uint16_t freeMin;     /* HEAP_HIST_UNIT bytes */
+  uint16_t largestMin;  /* HEAP_HIST_UNIT bytes */
+  uint16_t livePeak[HEAP_TAG_COUNT];  /* HEAP_HIST_UNIT bytes, footprint included */
+};
+
+struct HeapAccum {
+  uint32_t startSec;
+  uint32_t freeMin;
+  uint32_t largestMin;
+  uint32_t livePeak[HEAP_TAG_COUNT];
+  uint32_t allocsAtStart[HEAP_TAG_COUNT];
+};
+
+struct HeapRing {
+  HeapPoint* points;
+  uint16_t capacity;
+  uint32_t periodSec;
+  std::atomic<uint32_t> closed;
+  HeapAccum acc;
+};
+
+static const char* const tagNames[HEAP_TAG_COUNT] = { "web", "ota", "ble" };
+
+static TagAccount accounts[HEAP_TAG_COUNT];
+static portMUX_TYPE accountsMux = portMUX_INITIALIZER_UNLOCKED;
+
+static HeapPoint pointsShort[HEAP_HIST_SHORT_POINTS];
+static HeapPoint pointsLong[HEAP_HIST_LONG_POINTS];
+
+static HeapRing rings[HEAP_HIST_LEVELS] = {
+  { pointsShort, HEAP_HIST_SHORT_POINTS, HEAP_HIST_SHORT_SEC, {0}, {} },
+  { pointsLong, HEAP_HIST_LONG_POINTS, HEAP_HIST_LONG_SEC, {0}, {} }
+};
+
+/* Rate over the last closed short point; written by statsTask, read by handlers */
+static uint32_t allocsPerMin[HEAP_TAG_COUNT];
+static uint32_t bytesPerMin[HEAP_TAG_COUNT];
+
+static inline uint32_t uptimeSec() {
+  return (uint32_t)(esp_timer_get_time() / 1000000LL);
+}
+
+/* toUnits: Free sizes round down and usage rounds up, so neither looks better than it was */
+static inline uint16_t toUnits(uint32_t bytes, bool roundUp) {
+  uint32_t units = (bytes + (roundUp ? HEAP_HIST_UNIT - 1 : 0)) / HEAP_HIST_UNIT;
+  return units > 0xFFFF ? 0xFFFF : (uint16_t)units;
+}
+
+/* chargeAlloc: accountsMux must be held */
+static void chargeAlloc(TagAccount& a, uint32_t size) {
+  a.allocs++;
+  a.allocBytes += size;
+  a.live += size;
+  if (a.live > a.peak) a.peak = a.live;
+  if (a.live > a.windowPeak) a.windowPeak = a.live;
+  if (size > a.maxBlock) a.maxBlock = size;
+}
+
+static HeapBlockHeader* headerOf(void* ptr) {
+  HeapBlockHeader* hdr = (HeapBlockHeader*)ptr - 1;
+  if (hdr->magic != HEAP_BLOCK_MAGIC || hdr->tag >= HEAP_TAG_COUNT) {
+    Serial.printf("[heap] untracked or double-freed block %p\n", ptr);
+    return nullptr;
+  }
+  return hdr;
+}
+
+void* heapTrackAlloc(HeapTag tag, size_t size) {
+  HeapBlockHeader* hdr = (HeapBlockHeader*)malloc(sizeof(HeapBlockHeader) + size);
+
+  portENTER_CRITICAL(&accountsMux);
+  if (hdr) {
+    chargeAlloc(accounts[tag], size);
+  } else {
+    accounts[tag].failed++;
+  }
+  portEXIT_CRITICAL(&accountsMux);
+
+  if (!hdr) return nullptr;
+  hdr->size = size;
+  hdr->tag = tag;
+  hdr->magic = HEAP_BLOCK_MAGIC;
+  hdr->reserved = 0;
+  return hdr + 1;
+}
+
+void* heapTrackRealloc(void* ptr, size_t size) {
+  if (!ptr) return nullptr;  /* No tag to charge; callers allocate first */
+  HeapBlockHeader* hdr = headerOf(ptr);
+  if (!hdr) return nullptr;
+
+  uint8_t tag = hdr->tag;
+  uint32_t oldSize = hdr->size;
+  HeapBlockHeader* moved = (HeapBlockHeader*)realloc(hdr, sizeof(HeapBlockHeader) + size);
+
+  /* A resize counts as one allocation of the new size, net of the old one */
+  portENTER_CRITICAL(&accountsMux);
+  TagAccount& a = accounts[tag];
+  if (moved) {
+    a.live -= oldSize;
+    a.frees++;
+    chargeAlloc(a, size);
+  } else {
+    a.failed++;
+  }
+  portEXIT_CRITICAL(&accountsMux);
+
+  if (!moved) return nullptr;
+  moved->size = size;
+  return moved + 1;
+}
+
+void heapTrackFree(void* ptr) {
+  if (!ptr) return;
+  HeapBlockHeader* hdr = headerOf(ptr);
+  if (!hdr) return;  /* Leaking beats corrupting the heap */
+
+  portENTER_CRITICAL(&accountsMux);
+  TagAccount& a = accounts[hdr->tag];
+  a.live -= hdr->size;
+  a.frees++;
+  portEXIT_CRITICAL(&accountsMux);
+
+  hdr->magic = 0;
+  free(hdr);
+}
+
+char* heapTrackStrdup(HeapTag tag, const char* str) {
+  size_t len = strlen(str) + 1;
+  char* copy = (char*)heapTrackAlloc(tag, len);
+  if (copy) memcpy(copy, str, len);
+  return copy;
+}
+
+void heapTrackSetFootprint(HeapTag tag, uint32_t bytes) {
+  portENTER_CRITICAL(&accountsMux);
+  accounts[tag].footprint = bytes;
+  portEXIT_CRITICAL(&accountsMux);
+}
+
+void getHeapTagTotals(HeapTagTotals* out) {
+  portENTER_CRITICAL(&accountsMux);
+  for (uint8_t t = 0; t < HEAP_TAG_COUNT; t++) {
+    out[t].live = accounts[t].live + accounts[t].footprint;
+    out[t].allocs = accounts[t].allocs;
+    out[t].failed = accounts[t].failed;
+  }
+  portEXIT_CRITICAL(&accountsMux);
+}
+
+const char* heapTagName(HeapTag tag) {
+  return tag < HEAP_TAG_COUNT ? tagNames[tag] : "?";
+}
+
+static void openAccum(HeapAccum& acc, uint32_t now, const uint32_t* allocs) {
+  acc.startSec = now;
+  acc.freeMin = UINT32_MAX;
+  acc.largestMin = UINT32_MAX;
+  for (uint8_t t = 0; t < HEAP_TAG_COUNT; t++) {
+    acc.livePeak[t] = 0;
+    acc.allocsAtStart[t] = allocs[t];
+  }
+}
+
+static void closePoint(HeapRing& ring, const uint32_t* allocs) {
+  const HeapAccum& acc = ring.acc;
+  uint32_t index = ring.closed.load(std::memory_order_relaxed);
+  HeapPoint& p = ring.points[index % ring.capacity];
+
+  p.startSec = acc.startSec;
+  p.freeMin = toUnits(acc.freeMin, false);
+  p.largestMin = toUnits(acc.largestMin, false);
+  for (uint8_t t = 0; t < HEAP_TAG_COUNT; t++) {
+    p.livePeak[t] = toUnits(acc.livePeak[t], true);
+    p.allocs[t] = allocs[t] - acc.allocsAtStart[t];
+  }
+
+  ring.closed.store(index + 1, std::memory_order_release);
+}
+
+void heapTrackSample() {
+  static uint32_t lastMs = 0;
+  static bool started = false;
+  uint32_t nowMs = millis();
+  if (started && nowMs - lastMs < HEAP_SAMPLE_INTERVAL_MS) return;
+  lastMs = nowMs;
+
+  uint32_t now = uptimeSec();
+  uint32_t freeBytes = ESP.getFreeHeap();
+  uint32_t largest = ESP.getMaxAllocHeap();
+
+  uint32_t peak[HEAP_TAG_COUNT];
+  uint32_t allocs[HEAP_TAG_COUNT];
+  uint64_t bytes[HEAP_TAG_COUNT];
+  portENTER_CRITICAL(&accountsMux);
+  for (uint8_t t = 0; t < HEAP_TAG_COUNT; t++) {
+    TagAccount& a = accounts[t];
+    peak[t] = a.windowPeak + a.footprint;
+    allocs[t] = a.allocs;
+    bytes[t] = a.allocBytes;
+    a.windowPeak = a.live;
+  }
+  portEXIT_CRITICAL(&accountsMux);
+
+  if (!started) {
+    started = true;
+    for (uint8_t l = 0; l < HEAP_HIST_LEVELS; l++) openAccum(rings[l].acc, now, allocs);
+  }
+
+  static uint64_t rateBytesAtStart[HEAP_TAG_COUNT];
+  for (uint8_t l = 0; l < HEAP_HIST_LEVELS; l++) {
+    HeapRing& ring = rings[l];
+    HeapAccum& acc = ring.acc;
+    if (freeBytes < acc.freeMin) acc.freeMin = freeBytes;
+    if (largest < acc.largestMin) acc.largestMin = largest;
+    for (uint8_t t = 0; t < HEAP_TAG_COUNT; t++) {
+      if (peak[t] > acc.livePeak[t]) acc.livePeak[t] = peak[t];
+    }
+
+    if (now - acc.startSec < ring.periodSec) continue;
+    if (l == 0) {
+      uint32_t elapsed = now - acc.startSec;
+      for (uint8_t t = 0; t < HEAP_TAG_COUNT; t++) {
+        allocsPerMin[t] = (uint32_t)((uint64_t)(allocs[t] - acc.allocsAtStart[t]) * 60 / elapsed);
+        bytesPerMin[t] = (uint32_t)((bytes[t] - rateBytesAtStart[t]) * 60 / elapsed);
+        rateBytesAtStart[t] = bytes[t];
+      }
+    }
+    closePoint(ring, allocs);
+    openAccum(acc, now, allocs);
+  }
+}
+
+/* readPoint: Copies point k if it is still in the ring; false once the writer has reused its slot */
+static bool readPoint(const HeapRing& ring, uint32_t k, HeapPoint& out) {
+  memcpy(&out, &ring.points[k % ring.capacity], sizeof(out));
+  std::atomic_thread_fence(std::memory_order_acquire);
+  return ring.closed.load(std::memory_order_relaxed) - k < ring.capacity;
+}
+
+void registerHeapRoutes() {
+  server.on("/api/heap", HTTP_GET, handleApiHeap);
+  server.on("/api/heap/history", HTTP_GET, handleApiHeapHistory);
+}
+
+/* handleApiHeap: Streamed so the report itself does not show up under the web tag */
+void handleApiHeap() {
+  TagAccount snap[HEAP_TAG_COUNT];
+  portENTER_CRITICAL(&accountsMux);
+  memcpy(snap, accounts, sizeof(snap));
+  portEXIT_CRITICAL(&accountsMux);
+
+  uint32_t freeBytes = ESP.getFreeHeap();
+  uint32_t largest = ESP.getMaxAllocHeap();
+  uint32_t tracked = 0;
+  for (uint8_t t = 0; t < HEAP_TAG_COUNT; t++) tracked += snap[t].live + snap[t].footprint;
+
+  server.setContentLength(CONTENT_LENGTH_UNKNOWN);
+  server.send(200, "application/json", "");
+
+  ChunkWriter out;
+  out.printf("{\"uptime_s\":%u,\"free\":%u,\"min_free\":%u,\"largest\":%u,\"frag_pct\":%u,\"tracked\":%u,\"tags\":[",
+             uptimeSec(), freeBytes, ESP.getMinFreeHeap(), largest,
+             freeBytes ? 100 - (uint32_t)((uint64_t)largest * 100 / freeBytes) : 0, tracked);
+  for (uint8_t t = 0; t < HEAP_TAG_COUNT; t++) {
+    const TagAccount& a = snap[t];
+    out.printf("%s{\"name\":\"%s\",\"live\":%u,\"footprint\":%u,\"peak\":%u,\"max_block\":%u,",
+               t ? "," : "", tagNames[t], a.live, a.footprint, a.peak, a.maxBlock);
+    out.printf("\"allocs\":%u,\"frees\":%u,\"failed\":%u,\"alloc_bytes\":%llu,",
+               a.allocs, a.frees, a.failed, (unsigned long long)a.allocBytes);
+    out.printf("\"allocs_per_min\":%u,\"bytes_per_min\":%u}", allocsPerMin[t], bytesPerMin[t]);
+  }
+  out.printf("]}");
+  out.end();
+}
+
+void handleApiHeapHistory() {
+  uint32_t res = server.hasArg("res") ? strtoul(server.arg("res").c_str(), nullptr, 10) : HEAP_HIST_SHORT_SEC;
+  int level = -1;
+  for (uint8_t l = 0; l < HEAP_HIST_LEVELS; l++) {
+    if (rings[l].periodSec == res) level = l;
+  }
+  if (level < 0) {
+    char err[64];
+    snprintf(err, sizeof(err), "{\"err\":\"res must be %u or %u\"}", HEAP_HIST_SHORT_SEC, HEAP_HIST_LONG_SEC);
+    server.send(400, "application/json", err);
+    return;
+  }
+  uint32_t since = server.hasArg("since") ? strtoul(server.arg("since").c_str(), nullptr, 10) : 0;
+  const HeapRing& ring = rings[level];
+
+  server.setContentLength(CONTENT_LENGTH_UNKNOWN);
+  server.send(200, "application/json", "");
+
+  ChunkWriter out;
+  out.printf("{\"res\":%u,\"now\":%u,\"tags\":[", res, uptimeSec());
+  for (uint8_t t = 0; t < HEAP_TAG_COUNT; t++) out.printf("%s\"%s\"", t ? "," : "", tagNames[t]);
+  out.printf("],\"points\":[");
+
+  uint32_t closed = ring.closed.load(std::memory_order_acquire);
+  uint32_t first = (closed > ring.capacity) ? closed - ring.capacity : 0;
+  bool any = false;
+  for (uint32_t k = first; k < closed; k++) {
+    HeapPoint p;
+    if (!readPoint(ring, k, p) || p.startSec < since) continue;
+
+    out.printf("%s[%u,%u,%u,[", any ? "," : "", p.startSec,
+               (uint32_t)p.freeMin * HEAP_HIST_UNIT, (uint32_t)p.largestMin * HEAP_HIST_UNIT);
+    for (uint8_t t = 0; t < HEAP_TAG_COUNT; t++) {
+      out.printf("%s%u", t ? "," : "", (uint32_t)p.livePeak[t] * HEAP_HIST_UNIT);
+    }
+    out.printf("],[");
+    for (uint8_t t = 0; t < HEAP_TAG_COUNT; t++) out.printf("%s%u", t ? "," : "", p.allocs[t]);
+    out.printf("]]");
+    any = true;
+  }
+  out.printf("]}");
+  out.end();
+}
+
+#endif
@@ -0,0 +1,103 @@
+/* ==============================================================================
+   HEAP_TRACKER.H - Per-Subsystem Heap Accounting Interface
+
+   Attributes heap use to a subsystem tag (web, ota, ble):
+   - heapTrackAlloc/Realloc/Free: malloc wrappers that prefix each block
+     with its tag and size, so a free on any task is charged back correctly
+   - WebJsonDocument / OtaJsonDocument: ArduinoJson documents whose pool
+     goes through those wrappers
+   - heapTrackSetFootprint: heap measured around a library's init, for
+     stacks that allocate internally (NimBLE)
+   Per tag: live bytes, peak, largest single block, allocation and failure
+   counts, allocation rate.
+
+   statsTask also records free heap and the largest free block, rolled up
+   at two resolutions (HEAP_HIST_SHORT_SEC, HEAP_HIST_LONG_SEC) next to
+   each tag's peak live bytes and allocation count for the same interval,
+   so slow fragmentation can be lined up against the tag that drove it.
+
+   GET /api/heap                          current totals per tag
+   GET /api/heap/history?res=<s>[&since=] one ring:
+   {"res":60,"now":5400,"tags":["web","ota","ble"],
+    "points":[[start_s,free_min,largest_min,[peak...],[allocs...]],...]}
+
+   With ENABLE_HEAP_TRACK 0 the wrappers fall back to plain malloc/free and
+   the document types to DynamicJsonDocument.
+   ============================================================================== */
+
+/* Header guard to prevent multiple inclusion of heap_tracker.h */
+#ifndef HEAP_TRACKER_H
+#define HEAP_TRACKER_H
+
+#include "config.h"
+#include <Arduino.h>
+#include <ArduinoJson.h>
+
+/* Add a tag here and its name to tagNames[] in heap_tracker.cpp */
+enum HeapTag : uint8_t {
+  HEAP_TAG_WEB = 0,
+  HEAP_TAG_OTA,
+  HEAP_TAG_BLE,
+  HEAP_TAG_COUNT
+};
+
+#if ENABLE_HEAP_TRACK
+
+void* heapTrackAlloc(HeapTag tag, size_t size);
+
+/* Keeps the block's original tag; ptr must be a tracked block. Returns nullptr and leaves ptr intact on failure */
+void* heapTrackRealloc(void* ptr, size_t size);
+
+/* ptr must come from heapTrackAlloc/Realloc/Strdup (or be nullptr) */
+void heapTrackFree(void* ptr);
+
+char* heapTrackStrdup(HeapTag tag, const char* str);
+
+/* Replaces the tag's measured footprint; 0 once the library is torn down */
+void heapTrackSetFootprint(HeapTag tag, uint32_t bytes);
+
+/* Folds heap state into the history every HEAP_SAMPLE_INTERVAL_MS; statsTask only */
+void heapTrackSample();
+
+struct HeapTagTotals {
+  uint32_t live;  /* Tracked blocks plus measured footprint */
+  uint32_t allocs;
+  uint32_t failed;
+};
+
+/* Fills out[HEAP_TAG_COUNT] */
+void getHeapTagTotals(HeapTagTotals* out);
+
+const char* heapTagName(HeapTag tag);
+
+void registerHeapRoutes();
+
+void handleApiHeap();
+
+void handleApiHeapHistory();
+
+/* ArduinoJson v6 allocator charging a document's pool to TAG */
+template <HeapTag TAG>
+struct TaggedJsonAllocator {
+  void* allocate(size_t size) { return heapTrackAlloc(TAG, size); }
+  void deallocate(void* ptr) { heapTrackFree(ptr); }
+  void* reallocate(void* ptr, size_t size) { return heapTrackRealloc(ptr, size); }
+};
+
+typedef BasicJsonDocument<TaggedJsonAllocator<HEAP_TAG_WEB>> WebJsonDocument;
+typedef BasicJsonDocument<TaggedJsonAllocator<HEAP_TAG_OTA>> OtaJsonDocument;
+
+#else
+
+static inline void* heapTrackAlloc(HeapTag tag, size_t size) { (void)tag; return malloc(size); }
+static inline void* heapTrackRealloc(void* ptr, size_t size) { return realloc(ptr, size); }
+static inline void heapTrackFree(void* ptr) { free(ptr); }
+static inline char* heapTrackStrdup(HeapTag tag, const char* str) { (void)tag; return strdup(str); }
+static inline void heapTrackSetFootprint(HeapTag tag, uint32_t bytes) { (void)tag; (void)bytes; }
+
+typedef DynamicJsonDocument WebJsonDocument;
+typedef DynamicJsonDocument OtaJsonDocument;
+
+#endif
+
+#endif
@@ -0,0 +1,105 @@
+/* ==============================================================================
+   BENCH_PIPELINE.CPP - Host Exec Pipeline Benchmark
+
+   Runs the real command path on the host: execSubmit() -> control/bulk lanes
+   -> BIZ_WORKERS bizTask threads -> processBizMessage() -> cmdDispatch().
+   Producers submit "ping" as fast as the pool allows and yield on
+   backpressure, the same loop as the on-device bench (bench.cpp), then the
+   exec_stats histograms are printed.
+
+   Usage: host_bench [commands] [producers]   (defaults 2000000, 1)
+   Exits non-zero if not every submitted command completed.
+   ============================================================================== */
+
+#include <Arduino.h>
+#include "../globals.h"
+#include "../tasks.h"
+#include "../msg_pool.h"
+#include "../exec_queue.h"
+#include "../exec_stats.h"
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#define HOST_BENCH_DEFAULT_COMMANDS 2000000
+#define HOST_BENCH_DRAIN_TIMEOUT_MS 30000
+
+static std::atomic<uint32_t> submitted(0);
+static std::atomic<uint32_t> backpressure(0);
+
+/* producer: Submits its share of "ping" commands, yielding whenever the pool or a lane is full */
+static void producer(uint32_t count) {
+  uint32_t done = 0;
+  uint32_t retries = 0;
+  while (done < count) {
+    if (execSubmit("ping", 4, micros()) == EXEC_SUBMIT_OK) {
+      done++;
+    } else {
+      retries++;
+      taskYIELD();
+    }
+  }
+  submitted.fetch_add(done, std::memory_order_relaxed);
+  backpressure.fetch_add(retries, std::memory_order_relaxed);
+}
+
+static void printLatency(ExecStage stage) {
+  ExecLatencySummary s;
+  getExecLatency(stage, s);
+  Serial.printf("  %-6s n=%-9u p50=%-6u p95=%-6u p99=%-6u max=%u us\n",
+                execStageName(stage), s.count, s.p50Us, s.p95Us, s.p99Us, s.maxUs);
+}
+
+int main(int argc, char** argv) {
+  uint32_t count = argc > 1 ? strtoul(argv[1], nullptr, 10) : HOST_BENCH_DEFAULT_COMMANDS;
+  uint32_t producers = argc > 2 ? strtoul(argv[2], nullptr, 10) : 1;
+  if (count == 0 || producers == 0) {
+    fprintf(stderr, "usage: %s [commands] [producers]\n", argv[0]);
+    return 2;
+  }
+
+  initMessagePool();
+  execQueueInit();
+  uint8_t workers = startBizWorkers();
+  gBizState = BIZ_RUNNING;
+  Serial.printf("[host_bench] %u commands, %u producer(s), %u worker(s)\n", count, producers, workers);
+
+  execStatsReset();
+  uint32_t startUs = micros();
+
+  std::vector<std::thread> threads;
+  for (uint32_t p = 0; p < producers; p++) {
+    threads.emplace_back(producer, count / producers + (p < count % producers ? 1 : 0));
+  }
+  for (std::thread& t : threads) t.join();
+
+  uint32_t drainStart = millis();
+  while (bizProcessed < submitted.load() && millis() - drainStart < HOST_BENCH_DRAIN_TIMEOUT_MS) {
+    delayMicroseconds(100);
+  }
+  uint32_t elapsedUs = micros() - startUs;
+  uint32_t completed = bizProcessed;
+
+  Serial.printf("[host_bench] %u/%u cmds in %u ms: %llu cmd/s, %u backpressure retries\n",
+                completed, submitted.load(), elapsedUs / 1000,
+                elapsedUs ? (unsigned long long)completed * 1000000ULL / elapsedUs : 0ULL, backpressure.load());
+  printLatency(EXEC_STAGE_QUEUE);
+  printLatency(EXEC_STAGE_RUN);
+  printLatency(EXEC_STAGE_TOTAL);
+
+  MsgPoolStats pool;
+  getMsgPoolStats(pool);
+  ExecPipelineCounters counters;
+  getExecPipelineCounters(counters);
+  Serial.printf("  pool   high-water %u/%u, exhausted %u; depth high-water %u, rejected pool %u / queue %u\n",
+                pool.highWater, pool.capacity, pool.exhausted, counters.depthHighWater,
+                counters.rejectedPoolExhausted, counters.rejectedQueueFull);
+  for (uint8_t w = 0; w < workers; w++) {
+    Serial.printf("  biz%u   %u processed\n", w, bizWorkerProcessed[w]);
+  }
+
+  /* The biz workers never return; leave without running static destructors under them */
+  fflush(stdout);
+  _Exit(completed == submitted.load() ? 0 : 1);
+}
@@ -0,0 +1,100 @@
+/* ==============================================================================
+   ARDUINO.H - Host Shim: Arduino Core
+
+   The parts of the ESP32 Arduino core the pipeline modules use: String,
+   Serial (to stdout), millis()/micros() from a monotonic clock, and an ESP
+   object with fixed heap figures. Like the real core it pulls in FreeRTOS.
+   ============================================================================== */
+
+#ifndef HOST_ARDUINO_H
+#define HOST_ARDUINO_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <strings.h>
+#include <math.h>
+#include <time.h>
+#include <string>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "esp_err.h"
+#include "esp_system.h"
+#include "IPAddress.h"
+
+class __FlashStringHelper;
+#define F(s) (reinterpret_cast<const __FlashStringHelper*>(s))
+#define PROGMEM
+#define PSTR(s) (s)
+
+#define OUTPUT 0x03
+#define HIGH 0x1
+#define LOW 0x0
+
+class String {
+public:
+  String(const char* s = "") : s_(s ? s : "") {}
+  String(const __FlashStringHelper* s) : s_(reinterpret_cast<const char*>(s)) {}
+  String(int v) : s_(std::to_string(v)) {}
+  String(unsigned v) : s_(std::to_string(v)) {}
+  String(long v) : s_(std::to_string(v)) {}
+  String(unsigned long v) : s_(std::to_string(v)) {}
+
+  const char* c_str() const { return s_.c_str(); }
+  unsigned length() const { return (unsigned)s_.size(); }
+  void reserve(unsigned n) { s_.reserve(n); }
+  String& operator+=(const String& o) { s_ += o.s_; return *this; }
+  String& operator+=(const char* o) { s_ += o; return *this; }
+  String& operator+=(char c) { s_ += c; return *this; }
+  bool operator==(const char* o) const { return s_ == o; }
+  bool operator==(const String& o) const { return s_ == o.s_; }
+  bool operator!=(const char* o) const { return s_ != o; }
+
+private:
+  std::string s_;
+};
+
+inline String operator+(const String& a, const String& b) { String r = a; r += b; return r; }
+inline String operator+(const String& a, const char* b) { String r = a; r += b; return r; }
+inline String operator+(const char* a, const String& b) { String r(a); r += b; return r; }
+
+class HardwareSerial {
+public:
+  void begin(unsigned long baud) { (void)baud; }
+  size_t print(const char* s) { return fputs(s, stdout) >= 0 ? strlen(s) : 0; }
+  size_t print(const String& s) { return print(s.c_str()); }
+  size_t print(const __FlashStringHelper* s) { return print(reinterpret_cast<const char*>(s)); }
+  size_t println(const char* s = "") { return print(s) + print("\n"); }
+  size_t println(const String& s) { return println(s.c_str()); }
+  size_t println(const __FlashStringHelper* s) { return println(reinterpret_cast<const char*>(s)); }
+  size_t printf(const char* fmt, ...) __attribute__((format(printf, 2, 3)));
+};
+
+extern HardwareSerial Serial;
+
+uint32_t millis();
+uint32_t micros();
+void delay(uint32_t ms);
+void delayMicroseconds(uint32_t us);
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t value);
+
+class EspClass {
+public:
+  uint32_t getFreeHeap() { return 200000; }
+  uint32_t getMinFreeHeap() { return 180000; }
+  uint32_t getMaxAllocHeap() { return 110000; }
+  uint32_t getCpuFreqMHz() { return 240; }
+  uint32_t getCycleCount();
+  [[noreturn]] void restart();
+};
+
+extern EspClass ESP;
+
+#endif
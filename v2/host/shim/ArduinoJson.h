@@ -0,0 +1,12 @@
+/* ==============================================================================
+   ARDUINOJSON.H - Host Shim: ArduinoJson Types
+
+   Declarations only; nothing in the host build serialises JSON.
+   ============================================================================== */
+
+#ifndef HOST_ARDUINOJSON_H
+#define HOST_ARDUINOJSON_H
+
+class DynamicJsonDocument;
+
+#endif
@@ -0,0 +1,13 @@
+/* ==============================================================================
+   NIMBLEDEVICE.H - Host Shim: NimBLE Types
+
+   Declarations only; BLE is not part of the host build.
+   ============================================================================== */
+
+#ifndef HOST_NIMBLEDEVICE_H
+#define HOST_NIMBLEDEVICE_H
+
+class NimBLEServer;
+class NimBLECharacteristic;
+
+#endif
@@ -0,0 +1,5 @@
+/* ==============================================================================
+   NIMBLESERVER.H - Host Shim: NimBLE Types
+   ============================================================================== */
+
+#include "NimBLEDevice.h"
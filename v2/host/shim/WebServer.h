@@ -0,0 +1,18 @@
+/* ==============================================================================
+   WEBSERVER.H - Host Shim: Arduino WebServer
+
+   Only the object itself; no route is served on the host.
+   ============================================================================== */
+
+#ifndef HOST_WEBSERVER_H
+#define HOST_WEBSERVER_H
+
+#include <Arduino.h>
+
+class WebServer {
+public:
+  explicit WebServer(int port) { (void)port; }
+  void handleClient() {}
+};
+
+#endif
@@ -0,0 +1,28 @@
+/* ==============================================================================
+   WIFI.H - Host Shim: Arduino WiFi
+
+   The host is never associated: status() is always WL_DISCONNECTED.
+   ============================================================================== */
+
+#ifndef HOST_WIFI_H
+#define HOST_WIFI_H
+
+#include <Arduino.h>
+
+enum wl_status_t {
+  WL_IDLE_STATUS = 0,
+  WL_CONNECTED = 3,
+  WL_DISCONNECTED = 6
+};
+
+class WiFiClass {
+public:
+  wl_status_t status() { return WL_DISCONNECTED; }
+  IPAddress localIP() { return IPAddress(); }
+  int8_t RSSI() { return 0; }
+  String SSID() { return String(); }
+};
+
+extern WiFiClass WiFi;
+
+#endif
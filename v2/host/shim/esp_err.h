@@ -0,0 +1,13 @@
+/* ==============================================================================
+   ESP_ERR.H - Host Shim: ESP-IDF Error Codes
+   ============================================================================== */
+
+#ifndef HOST_ESP_ERR_H
+#define HOST_ESP_ERR_H
+
+typedef int esp_err_t;
+
+#define ESP_OK 0
+#define ESP_FAIL -1
+
+#endif
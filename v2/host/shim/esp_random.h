@@ -0,0 +1,12 @@
+/* ==============================================================================
+   ESP_RANDOM.H - Host Shim: Hardware RNG
+   ============================================================================== */
+
+#ifndef HOST_ESP_RANDOM_H
+#define HOST_ESP_RANDOM_H
+
+#include <stdint.h>
+
+uint32_t esp_random();
+
+#endif
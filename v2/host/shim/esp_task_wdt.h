@@ -0,0 +1,16 @@
+/* ==============================================================================
+   ESP_TASK_WDT.H - Host Shim: Task Watchdog
+
+   No watchdog on the host; registration and feeding do nothing.
+   ============================================================================== */
+
+#ifndef HOST_ESP_TASK_WDT_H
+#define HOST_ESP_TASK_WDT_H
+
+#include <Arduino.h>
+
+inline esp_err_t esp_task_wdt_add(TaskHandle_t task) { (void)task; return ESP_OK; }
+inline esp_err_t esp_task_wdt_delete(TaskHandle_t task) { (void)task; return ESP_OK; }
+inline esp_err_t esp_task_wdt_reset() { return ESP_OK; }
+
+#endif
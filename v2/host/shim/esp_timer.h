@@ -0,0 +1,13 @@
+/* ==============================================================================
+   ESP_TIMER.H - Host Shim: Microsecond Timer
+   ============================================================================== */
+
+#ifndef HOST_ESP_TIMER_H
+#define HOST_ESP_TIMER_H
+
+#include <stdint.h>
+
+/* Microseconds since the process started */
+int64_t esp_timer_get_time();
+
+#endif
@@ -0,0 +1,40 @@
+/* ==============================================================================
+   FREERTOS.H - Host Shim: FreeRTOS Base Types
+
+   Just enough of the ESP-IDF FreeRTOS API for the pipeline modules to build
+   and run as Linux threads (see host_shim.cpp). One tick is 1 ms.
+   ============================================================================== */
+
+#ifndef HOST_FREERTOS_H
+#define HOST_FREERTOS_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+typedef uint32_t TickType_t;
+
+#define pdFALSE 0
+#define pdTRUE 1
+#define pdFAIL pdFALSE
+#define pdPASS pdTRUE
+#define portMAX_DELAY ((TickType_t)0xFFFFFFFFUL)
+#define portTICK_PERIOD_MS 1
+#define pdMS_TO_TICKS(ms) ((TickType_t)(ms))
+
+#define configMAX_TASK_NAME_LEN 16
+#define tskNO_AFFINITY ((BaseType_t)0x7FFFFFFF)
+
+/* Critical sections are a spinlock per mux, as on a dual-core ESP32 */
+struct portMUX_TYPE {
+  volatile bool locked;
+};
+#define portMUX_INITIALIZER_UNLOCKED { false }
+
+void portENTER_CRITICAL(portMUX_TYPE* mux);
+void portEXIT_CRITICAL(portMUX_TYPE* mux);
+#define portENTER_CRITICAL_ISR(mux) portENTER_CRITICAL(mux)
+#define portEXIT_CRITICAL_ISR(mux) portEXIT_CRITICAL(mux)
+
+#endif
@@ -0,0 +1,24 @@
+/* ==============================================================================
+   QUEUE.H - Host Shim: FreeRTOS Queues
+
+   Fixed-depth copy-in/copy-out queues behind a mutex and condition
+   variables, with the same full/empty semantics and tick timeouts.
+   ============================================================================== */
+
+#ifndef HOST_QUEUE_H
+#define HOST_QUEUE_H
+
+#include "FreeRTOS.h"
+
+struct QueueDefinition;
+typedef QueueDefinition* QueueHandle_t;
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t itemSize);
+void vQueueDelete(QueueHandle_t queue);
+BaseType_t xQueueSend(QueueHandle_t queue, const void* item, TickType_t ticks);
+BaseType_t xQueueReceive(QueueHandle_t queue, void* item, TickType_t ticks);
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t queue);
+
+#define xQueueSendToBack xQueueSend
+
+#endif
@@ -0,0 +1,372 @@
+/* ==============================================================================
+   HOST_SHIM.CPP - Host Shim Implementation
+
+   Runs the FreeRTOS primitives on std::thread and friends:
+   - Tasks: detached threads; the handle owns the notification counter
+   - Queues: ring of fixed-size items under a mutex, two condition variables
+   - Mutexes: std::timed_mutex
+   - Critical sections: a spinlock per portMUX_TYPE
+   Time comes from std::chrono::steady_clock, starting at process start.
+   Priorities and core pinning are ignored; the host scheduler decides.
+   ============================================================================== */
+
+#include <Arduino.h>
+#include <Preferences.h>
+#include <WiFi.h>
+#include <esp_system.h>
+#include <esp_random.h>
+#include <esp_timer.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include <pthread.h>
+
+typedef std::chrono::steady_clock HostClock;
+
+static const HostClock::time_point processStart = HostClock::now();
+
+HardwareSerial Serial;
+EspClass ESP;
+WiFiClass WiFi;
+
+/* ============================================================================
+   TIME
+   ============================================================================ */
+
+int64_t esp_timer_get_time() {
+  return std::chrono::duration_cast<std::chrono::microseconds>(HostClock::now() - processStart).count();
+}
+
+uint32_t micros() {
+  return (uint32_t)esp_timer_get_time();
+}
+
+uint32_t millis() {
+  return (uint32_t)(esp_timer_get_time() / 1000);
+}
+
+void delay(uint32_t ms) {
+  std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
+
+void delayMicroseconds(uint32_t us) {
+  std::this_thread::sleep_for(std::chrono::microseconds(us));
+}
+
+uint32_t EspClass::getCycleCount() {
+  return (uint32_t)(esp_timer_get_time() * 240);
+}
+
+void EspClass::restart() {
+  fflush(stdout);
+  _Exit(0);
+}
+
+void pinMode(uint8_t pin, uint8_t mode) {
+  (void)pin;
+  (void)mode;
+}
+
+void digitalWrite(uint8_t pin, uint8_t value) {
+  (void)pin;
+  (void)value;
+}
+
+size_t HardwareSerial::printf(const char* fmt, ...) {
+  va_list args;
+  va_start(args, fmt);
+  int n = vprintf(fmt, args);
+  va_end(args);
+  return n > 0 ? (size_t)n : 0;
+}
+
+esp_reset_reason_t esp_reset_reason() {
+  return ESP_RST_POWERON;
+}
+
+uint32_t esp_random() {
+  static std::mutex mutex;
+  static std::mt19937 rng(std::random_device{}());
+  std::lock_guard<std::mutex> lock(mutex);
+  return (uint32_t)rng();
+}
+
+/* ============================================================================
+   TASKS AND NOTIFICATIONS
+   ============================================================================ */
+
+struct tskTaskControlBlock {
+  std::mutex mutex;
+  std::condition_variable cv;
+  uint32_t notifyValue = 0;
+  char name[configMAX_TASK_NAME_LEN] = {};
+};
+
+struct HostTaskStart {
+  TaskFunction_t fn;
+  void* param;
+  TaskHandle_t task;
+};
+
+/* Never freed: a handle may be notified after its task has returned */
+static thread_local TaskHandle_t currentTask = nullptr;
+
+static void* runTask(void* arg) {
+  HostTaskStart start = *(HostTaskStart*)arg;
+  delete (HostTaskStart*)arg;
+  currentTask = start.task;
+  start.fn(start.param);
+  return nullptr;
+}
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t fn, const char* name, uint32_t stack, void* param,
+                                   UBaseType_t priority, TaskHandle_t* created, BaseType_t core) {
+  (void)stack;
+  (void)priority;
+  (void)core;
+  TaskHandle_t task = new tskTaskControlBlock();
+  strncpy(task->name, name ? name : "", sizeof(task->name) - 1);
+  if (created) *created = task;  /* Visible before the task runs, as callers expect */
+
+  pthread_t thread;
+  if (pthread_create(&thread, nullptr, runTask, new HostTaskStart{ fn, param, task }) != 0) {
+    if (created) *created = nullptr;
+    return pdFAIL;
+  }
+  pthread_detach(thread);
+  return pdPASS;
+}
+
+BaseType_t xTaskCreate(TaskFunction_t fn, const char* name, uint32_t stack, void* param,
+                       UBaseType_t priority, TaskHandle_t* created) {
+  return xTaskCreatePinnedToCore(fn, name, stack, param, priority, created, tskNO_AFFINITY);
+}
+
+void vTaskDelete(TaskHandle_t task) {
+  if (task == nullptr || task == currentTask) pthread_exit(nullptr);
+  /* Deleting another task is not supported on the host; nothing in the host build does it */
+}
+
+void vTaskDelay(TickType_t ticks) {
+  std::this_thread::sleep_for(std::chrono::milliseconds(ticks));
+}
+
+void vTaskDelayUntil(TickType_t* lastWake, TickType_t period) {
+  *lastWake += period;
+  int32_t wait = (int32_t)(*lastWake - xTaskGetTickCount());
+  if (wait > 0) vTaskDelay((TickType_t)wait);
+}
+
+TickType_t xTaskGetTickCount() {
+  return millis();
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle() {
+  if (!currentTask) currentTask = new tskTaskControlBlock();
+  return currentTask;
+}
+
+BaseType_t xTaskGetAffinity(TaskHandle_t task) {
+  (void)task;
+  return tskNO_AFFINITY;
+}
+
+BaseType_t xPortGetCoreID() {
+  return 0;
+}
+
+void taskYIELD() {
+  std::this_thread::yield();
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t task) {
+  {
+    std::lock_guard<std::mutex> lock(task->mutex);
+    task->notifyValue++;
+  }
+  task->cv.notify_one();
+  return pdPASS;
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clearOnExit, TickType_t ticks) {
+  TaskHandle_t self = xTaskGetCurrentTaskHandle();
+  std::unique_lock<std::mutex> lock(self->mutex);
+  auto notified = [self] { return self->notifyValue > 0; };
+  if (ticks == portMAX_DELAY) {
+    self->cv.wait(lock, notified);
+  } else if (!self->cv.wait_for(lock, std::chrono::milliseconds(ticks), notified)) {
+    return 0;
+  }
+  uint32_t value = self->notifyValue;
+  self->notifyValue = clearOnExit ? 0 : value - 1;
+  return value;
+}
+
+UBaseType_t uxTaskGetSystemState(TaskStatus_t* out, UBaseType_t max, uint32_t* totalRunTime) {
+  (void)out;
+  (void)max;
+  if (totalRunTime) *totalRunTime = 0;
+  return 0;
+}
+
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t task) {
+  (void)task;
+  return 0;
+}
+
+/* ============================================================================
+   QUEUES, MUTEXES, CRITICAL SECTIONS
+   ============================================================================ */
+
+struct QueueDefinition {
+  std::mutex mutex;
+  std::condition_variable notEmpty;
+  std::condition_variable notFull;
+  std::vector<uint8_t> items;
+  UBaseType_t length;
+  UBaseType_t itemSize;
+  UBaseType_t head = 0;
+  UBaseType_t count = 0;
+};
+
+/* waitFor: Waits on cv until ready() or the tick timeout; false on timeout */
+template <typename Ready>
+static bool waitFor(std::condition_variable& cv, std::unique_lock<std::mutex>& lock, TickType_t ticks, Ready ready) {
+  if (ready()) return true;
+  if (ticks == 0) return false;
+  if (ticks == portMAX_DELAY) {
+    cv.wait(lock, ready);
+    return true;
+  }
+  return cv.wait_for(lock, std::chrono::milliseconds(ticks), ready);
+}
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t itemSize) {
+  QueueHandle_t queue = new QueueDefinition();
+  queue->items.resize((size_t)length * itemSize);
+  queue->length = length;
+  queue->itemSize = itemSize;
+  return queue;
+}
+
+void vQueueDelete(QueueHandle_t queue) {
+  delete queue;
+}
+
+BaseType_t xQueueSend(QueueHandle_t queue, const void* item, TickType_t ticks) {
+  std::unique_lock<std::mutex> lock(queue->mutex);
+  if (!waitFor(queue->notFull, lock, ticks, [queue] { return queue->count < queue->length; })) return pdFALSE;
+  UBaseType_t tail = (queue->head + queue->count) % queue->length;
+  memcpy(&queue->items[(size_t)tail * queue->itemSize], item, queue->itemSize);
+  queue->count++;
+  lock.unlock();
+  queue->notEmpty.notify_one();
+  return pdTRUE;
+}
+
+BaseType_t xQueueReceive(QueueHandle_t queue, void* item, TickType_t ticks) {
+  std::unique_lock<std::mutex> lock(queue->mutex);
+  if (!waitFor(queue->notEmpty, lock, ticks, [queue] { return queue->count > 0; })) return pdFALSE;
+  memcpy(item, &queue->items[(size_t)queue->head * queue->itemSize], queue->itemSize);
+  queue->head = (queue->head + 1) % queue->length;
+  queue->count--;
+  lock.unlock();
+  queue->notFull.notify_one();
+  return pdTRUE;
+}
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t queue) {
+  std::lock_guard<std::mutex> lock(queue->mutex);
+  return queue->count;
+}
+
+struct HostSemaphore {
+  std::timed_mutex mutex;
+};
+
+SemaphoreHandle_t xSemaphoreCreateMutex() {
+  return new HostSemaphore();
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t sem, TickType_t ticks) {
+  if (ticks == portMAX_DELAY) {
+    sem->mutex.lock();
+    return pdTRUE;
+  }
+  return sem->mutex.try_lock_for(std::chrono::milliseconds(ticks)) ? pdTRUE : pdFALSE;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t sem) {
+  sem->mutex.unlock();
+  return pdTRUE;
+}
+
+void portENTER_CRITICAL(portMUX_TYPE* mux) {
+  while (__atomic_exchange_n(&mux->locked, true, __ATOMIC_ACQUIRE)) std::this_thread::yield();
+}
+
+void portEXIT_CRITICAL(portMUX_TYPE* mux) {
+  __atomic_store_n(&mux->locked, false, __ATOMIC_RELEASE);
+}
+
+/* ============================================================================
+   PREFERENCES
+   ============================================================================ */
+
+static std::mutex nvsMutex;
+static std::map<std::string, std::vector<uint8_t>> nvs;
+
+bool Preferences::begin(const char* name, bool readOnly) {
+  (void)name;
+  (void)readOnly;
+  return true;
+}
+
+bool Preferences::remove(const char* key) {
+  std::lock_guard<std::mutex> lock(nvsMutex);
+  return nvs.erase(key) > 0;
+}
+
+size_t Preferences::putBytes(const char* key, const void* value, size_t len) {
+  std::lock_guard<std::mutex> lock(nvsMutex);
+  nvs[key].assign((const uint8_t*)value, (const uint8_t*)value + len);
+  return len;
+}
+
+size_t Preferences::getBytes(const char* key, void* buf, size_t maxLen) {
+  std::lock_guard<std::mutex> lock(nvsMutex);
+  auto it = nvs.find(key);
+  if (it == nvs.end() || it->second.size() > maxLen) return 0;
+  memcpy(buf, it->second.data(), it->second.size());
+  return it->second.size();
+}
+
+size_t Preferences::getBytesLength(const char* key) {
+  std::lock_guard<std::mutex> lock(nvsMutex);
+  auto it = nvs.find(key);
+  return (it == nvs.end()) ? 0 : it->second.size();
+}
+
+size_t Preferences::putUChar(const char* key, uint8_t value) {
+  return putBytes(key, &value, 1);
+}
+
+uint8_t Preferences::getUChar(const char* key, uint8_t defaultValue) {
+  uint8_t value = defaultValue;
+  return (getBytesLength(key) == 1 && getBytes(key, &value, 1) == 1) ? value : defaultValue;
+}
+
+size_t Preferences::putBool(const char* key, bool value) {
+  return putUChar(key, value ? 1 : 0);
+}
+
+bool Preferences::getBool(const char* key, bool defaultValue) {
+  return getUChar(key, defaultValue ? 1 : 0) != 0;
+}
@@ -0,0 +1,48 @@
+/* ==============================================================================
+   STUBS.CPP - Host Build: Firmware Modules Not Built On The Host
+
+   The pipeline sources reference radio, time and sensor modules that have no
+   meaning off the chip. These stand-ins report "not connected, no time, no
+   sensor" so the command path runs exactly as it does on a board with no
+   network configured.
+   ============================================================================== */
+
+#include <Arduino.h>
+#include "../globals.h"
+#include "../wifi_handler.h"
+#include "../ble_handler.h"
+#include "../time_handler.h"
+#include "../cpu_monitor.h"
+#include "../hardware.h"
+#include "../network_utils.h"
+#include "../stack_monitor.h"
+
+/* wifi_handler */
+void checkWiFiConnection() {}
+void saveWiFi(const String& ssid, const String& pass) { (void)ssid; (void)pass; }
+void saveNetworkConfig() {}
+
+/* ble_handler */
+void handleBLEReconnect() {}
+
+/* time_handler: no NTP; the time-valid flag is the real global, so a test can set it */
+void syncNTP() {}
+bool shouldSyncNTP() { return false; }
+bool getTimeInitialized() { return timeInitialized.load(std::memory_order_acquire); }
+uint32_t getEpochTime() { return 0; }
+
+/* cpu_monitor: the host has no idle-task run time */
+void updateCpuLoad() {}
+
+/* hardware */
+float getInternalTemperatureC() { return NAN; }
+
+/* network_utils: commands that set addresses are not exercised on the host */
+bool isValidIP(const String& s) { (void)s; return false; }
+bool isValidSubnet(const String& s) { (void)s; return false; }
+IPAddress parseIP(const String& s) { (void)s; return IPAddress(); }
+
+/* stack_monitor: uxTaskGetSystemState() is empty on the host, so there is nothing to track */
+uint32_t taskStackSize(const char* name) { (void)name; return 0; }
+StackHealth stackHealthFor(uint32_t freeBytes, uint32_t sizeBytes) { (void)freeBytes; (void)sizeBytes; return STACK_GOOD; }
+void stackMonitorUpdate(const TaskMonitorData* tasks, uint8_t count) { (void)tasks; (void)count; }
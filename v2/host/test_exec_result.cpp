@@ -0,0 +1,121 @@
+/* ==============================================================================
+   TEST_EXEC_RESULT.CPP - Host Test: Completion Slots Outlive Queued Commands
+
+   Reproduces a command that stays queued while many newer ones finish:
+   - A keyed "slow" command blocks its home worker inside the application
+     hook until the test releases it
+   - A second command with the same key waits in that worker's home queue
+   - The other worker runs far more than EXEC_RESULT_SLOTS unkeyed commands
+   The waiting command's slot must still report "queued" (not "expired"),
+   and once released it must complete with its own result. Both keyed IDs
+   are also checked to have kept their slots against every later ID.
+
+   Usage: test_exec_result [unkeyed commands]   (default 4 * EXEC_RESULT_SLOTS)
+   ============================================================================== */
+
+#include <Arduino.h>
+#include "../globals.h"
+#include "../tasks.h"
+#include "../exec_queue.h"
+#include "../exec_result.h"
+
+#include <atomic>
+
+#define RESULT_WAIT_MS 2000
+
+static std::atomic<bool> slowRunning(false);
+static std::atomic<bool> slowRelease(false);
+static uint32_t failures = 0;
+
+#define CHECK(cond, ...) do { \
+  if (!(cond)) { \
+    failures++; \
+    printf("FAIL %s:%d: %s: ", __FILE__, __LINE__, #cond); \
+    printf(__VA_ARGS__); \
+    printf("\n"); \
+  } \
+} while (0)
+
+/* "slow" holds its worker until released; everything else stays unknown */
+CmdResult bizHandleAppCommand(const char* cmd) {
+  if (strcmp(cmd, "slow") != 0) return CMD_ERR_UNKNOWN;
+  slowRunning.store(true, std::memory_order_release);
+  while (!slowRelease.load(std::memory_order_acquire)) delay(1);
+  return CMD_OK;
+}
+
+static uint32_t submit(const char* cmd, const char* key) {
+  uint32_t id = 0;
+  ExecSubmitResult r = execSubmit(cmd, strlen(cmd), micros(), &id, key);
+  CHECK(r == EXEC_SUBMIT_OK && id != 0, "submit '%s' returned %d, id %u", cmd, (int)r, id);
+  return id;
+}
+
+static ExecState stateOf(uint32_t id) {
+  ExecResultInfo info;
+  return execResultGet(id, info) ? info.state : EXEC_STATE_UNKNOWN;
+}
+
+int main(int argc, char** argv) {
+  uint32_t unkeyed = argc > 1 ? strtoul(argv[1], nullptr, 10) : 4 * EXEC_RESULT_SLOTS;
+
+  initMessagePool();
+  execQueueInit();
+  uint8_t workers = startBizWorkers();
+  gBizState = BIZ_RUNNING;
+  if (workers < 2) {
+    printf("[test_exec_result] needs two biz workers, have %u\n", workers);
+    return 1;
+  }
+
+  /* Any key owned by worker 0 */
+  char key[8];
+  for (uint32_t k = 0;; k++) {
+    snprintf(key, sizeof(key), "k%u", k);
+    if (execWorkerForKey(key) == 0) break;
+  }
+
+  uint32_t slowId = submit("slow", key);
+  uint32_t start = millis();
+  while (!slowRunning.load(std::memory_order_acquire) && millis() - start < RESULT_WAIT_MS) delay(1);
+  CHECK(stateOf(slowId) == EXEC_STATE_RUNNING, "slow command is %s", execStateName(stateOf(slowId)));
+
+  uint32_t heldId = submit("ping", key);
+  CHECK(stateOf(heldId) == EXEC_STATE_QUEUED, "held command is %s", execStateName(stateOf(heldId)));
+
+  /* One at a time, so every command settles before the next ID is issued */
+  uint32_t lastId = heldId;
+  for (uint32_t i = 0; i < unkeyed; i++) {
+    uint32_t id = submit("ping", nullptr);
+    ExecResultInfo info;
+    execResultWait(id, RESULT_WAIT_MS, info);
+    CHECK(info.state == EXEC_STATE_DONE && info.result == CMD_OK, "unkeyed %u: %s, result %u",
+          id, execStateName(info.state), info.result);
+    CHECK((id & (EXEC_RESULT_SLOTS - 1)) != (heldId & (EXEC_RESULT_SLOTS - 1)) &&
+          (id & (EXEC_RESULT_SLOTS - 1)) != (slowId & (EXEC_RESULT_SLOTS - 1)),
+          "id %u reuses the slot of a command still in flight", id);
+    lastId = id;
+  }
+
+  CHECK(stateOf(slowId) == EXEC_STATE_RUNNING, "after %u completions slow command is %s",
+        unkeyed, execStateName(stateOf(slowId)));
+  CHECK(stateOf(heldId) == EXEC_STATE_QUEUED, "after %u completions held command is %s",
+        unkeyed, execStateName(stateOf(heldId)));
+
+  slowRelease.store(true, std::memory_order_release);
+  ExecResultInfo slow;
+  ExecResultInfo held;
+  execResultWait(slowId, RESULT_WAIT_MS, slow);
+  execResultWait(heldId, RESULT_WAIT_MS, held);
+  CHECK(slow.state == EXEC_STATE_DONE && slow.result == CMD_OK, "slow command ended %s, result %u",
+        execStateName(slow.state), slow.result);
+  CHECK(held.state == EXEC_STATE_DONE && held.result == CMD_OK, "held command ended %s, result %u",
+        execStateName(held.state), held.result);
+
+  printf("[test_exec_result] held id %u across %u completions (ids up to %u): %s\n",
+         heldId, unkeyed, lastId, failures ? "FAILED" : "OK");
+
+  /* The biz workers never return; leave without running static destructors under them */
+  fflush(stdout);
+  _Exit(failures ? 1 : 0);
+}
@@ -0,0 +1,157 @@
+/* ==============================================================================
+   TEST_LOG_RING.CPP - Host Torture Test: Lock-Free Debug Log Rings
+
+   Producer threads append events through addLogEvent() into every category
+   while reader threads follow the rings with nextLogEntry() cursors and
+   copyLogs() snapshots. Each event carries its producer, a per-producer
+   sequence number and a checksum string derived from both.
+   - Torn entry: the checksum does not match the integer arguments
+   - Out of order: a reader sees a producer's sequence go backwards, or a
+     cursor ticket that does not grow
+   At the end every append must be accounted for: logged + dropped equals
+   the number of attempts, and each ring holds its last MAX_DEBUG_LOGS.
+
+   Usage: test_log_ring [producers] [events per producer]   (defaults 4, 200000)
+   ============================================================================== */
+
+#include <Arduino.h>
+#include "../globals.h"
+#include "../debug_handler.h"
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#define TORTURE_PRODUCERS_MAX 16
+#define TORTURE_READERS 2
+
+static std::atomic<uint32_t> failures(0);
+static std::atomic<bool> producing(true);
+static std::atomic<uint64_t> attempts(0);
+static std::atomic<uint64_t> entriesChecked(0);
+
+#define CHECK(cond, ...) do { \
+  if (!(cond)) { \
+    failures.fetch_add(1, std::memory_order_relaxed); \
+    printf("FAIL %s:%d: %s: ", __FILE__, __LINE__, #cond); \
+    printf(__VA_ARGS__); \
+    printf("\n"); \
+  } \
+} while (0)
+
+static uint32_t checksum(uint32_t producer, uint32_t seq) {
+  uint32_t h = producer * 0x9E3779B1u ^ seq * 0x85EBCA77u;
+  h ^= h >> 15;
+  return h * 0xC2B2AE3Du;
+}
+
+/* checkEntry: Entry is whole and this producer's sequence has not gone backwards for this reader */
+static void checkEntry(const LogEntry& e, uint32_t* lastSeen, const char* how) {
+  entriesChecked.fetch_add(1, std::memory_order_relaxed);
+  uint32_t producer = e.args[0];
+  uint32_t seq = e.args[1];
+  char expect[sizeof(e.str)];
+  snprintf(expect, sizeof(expect), "%08x", (unsigned)checksum(producer, seq));
+  if (e.argc != 2 || producer >= TORTURE_PRODUCERS_MAX || strcmp(e.str, expect) != 0) {
+    CHECK(false, "%s: torn entry (argc %u, producer %u, seq %u, str '%.*s')",
+          how, e.argc, producer, seq, (int)sizeof(e.str), e.str);
+    return;
+  }
+  CHECK(seq > lastSeen[producer], "%s: producer %u went from seq %u back to %u", how, producer, lastSeen[producer], seq);
+  lastSeen[producer] = seq;
+}
+
+static void producerThread(uint32_t producer, uint32_t events) {
+  char str[16];
+  for (uint32_t seq = 1; seq <= events; seq++) {
+    snprintf(str, sizeof(str), "%08x", (unsigned)checksum(producer, seq));
+    LogEventArgs a = {};
+    a.v[0] = producer;
+    a.v[1] = seq;
+    a.count = 2;
+    a.str = str;
+    /* Any event with a string and two integers; runs of 64 per category so each ring sees every producer */
+    addLogEvent((LogCategory)((seq / 64 + producer) % LOG_CAT_COUNT), EVT_STACK_LOW, a);
+    attempts.fetch_add(1, std::memory_order_relaxed);
+    if ((seq & 127) == 0) taskYIELD();  /* Let the readers in even on a single host core */
+  }
+}
+
+/* cursorReader: Follows every ring with nextLogEntry() the way /api/debug/logs streams them */
+static void cursorReader() {
+  uint32_t cursor[LOG_CAT_COUNT] = {};
+  uint32_t lastSeen[LOG_CAT_COUNT][TORTURE_PRODUCERS_MAX] = {};
+  bool more = true;
+  while (producing.load(std::memory_order_acquire) || more) {
+    more = false;
+    for (uint8_t cat = 0; cat < LOG_CAT_COUNT; cat++) {
+      LogEntry e;
+      uint32_t seq;
+      while (nextLogEntry((LogCategory)cat, cursor[cat], e, seq)) {
+        CHECK(seq > cursor[cat], "cursor went from ticket %u to %u", cursor[cat], seq);
+        cursor[cat] = seq;
+        checkEntry(e, lastSeen[cat], "cursor");
+        more = true;
+      }
+    }
+    taskYIELD();
+  }
+}
+
+/* snapshotReader: copyLogs() must return whole entries, oldest first */
+static void snapshotReader() {
+  static thread_local LogEntry snapshot[MAX_DEBUG_LOGS];
+  while (producing.load(std::memory_order_acquire)) {
+    for (uint8_t cat = 0; cat < LOG_CAT_COUNT; cat++) {
+      uint32_t lastSeen[TORTURE_PRODUCERS_MAX] = {};
+      uint8_t count = copyLogs((LogCategory)cat, snapshot);
+      CHECK(count <= MAX_DEBUG_LOGS, "copyLogs returned %u", count);
+      for (uint8_t i = 0; i < count; i++) checkEntry(snapshot[i], lastSeen, "snapshot");
+    }
+    taskYIELD();
+  }
+}
+
+int main(int argc, char** argv) {
+  uint32_t producers = argc > 1 ? strtoul(argv[1], nullptr, 10) : 4;
+  uint32_t events = argc > 2 ? strtoul(argv[2], nullptr, 10) : 200000;
+  if (producers == 0 || producers > TORTURE_PRODUCERS_MAX) {
+    fprintf(stderr, "usage: %s [producers 1..%d] [events per producer]\n", argv[0], TORTURE_PRODUCERS_MAX);
+    return 2;
+  }
+
+  std::vector<std::thread> readers;
+  readers.emplace_back(cursorReader);
+  for (int r = 1; r < TORTURE_READERS; r++) readers.emplace_back(snapshotReader);
+
+  std::vector<std::thread> threads;
+  for (uint32_t p = 0; p < producers; p++) threads.emplace_back(producerThread, p, events);
+  for (std::thread& t : threads) t.join();
+  producing.store(false, std::memory_order_release);
+  for (std::thread& t : readers) t.join();
+
+  LogCounters counters;
+  getLogCounters(counters);
+  uint64_t logged = (uint64_t)counters.reboot + counters.wifi + counters.error;
+  printf("[test_log_ring] %u producers x %u events: %llu logged, %u dropped, %llu entries checked\n",
+         producers, events, (unsigned long long)logged, counters.dropped,
+         (unsigned long long)entriesChecked.load());
+
+  CHECK(logged + counters.dropped == attempts.load(), "logged %llu + dropped %u != %llu attempts",
+        (unsigned long long)logged, counters.dropped, (unsigned long long)attempts.load());
+
+  /* Quiescent: every ring holds exactly its newest MAX_DEBUG_LOGS entries, all whole and in order */
+  const uint32_t perCat[LOG_CAT_COUNT] = { counters.reboot, counters.wifi, counters.error };
+  for (uint8_t cat = 0; cat < LOG_CAT_COUNT; cat++) {
+    static LogEntry snapshot[MAX_DEBUG_LOGS];
+    uint32_t lastSeen[TORTURE_PRODUCERS_MAX] = {};
+    uint8_t count = copyLogs((LogCategory)cat, snapshot);
+    uint32_t expect = perCat[cat] < MAX_DEBUG_LOGS ? perCat[cat] : MAX_DEBUG_LOGS;
+    CHECK(count == expect, "category %u holds %u entries, expected %u", cat, count, expect);
+    for (uint8_t i = 0; i < count; i++) checkEntry(snapshot[i], lastSeen, "final");
+  }
+
+  uint32_t failed = failures.load();
+  printf("[test_log_ring] %s\n", failed ? "FAILED" : "OK");
+  return failed ? 1 : 0;
+}
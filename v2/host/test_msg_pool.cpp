@@ -0,0 +1,253 @@
+/* ==============================================================================
+   TEST_MSG_POOL.CPP - Host Stress Test: Lock-Free Message Pool
+
+   Several threads hammer allocMessage()/allocMessageBatch()/freeMessage()
+   with payload lengths across every slab class and both lanes, holding a
+   random number of messages at a time so the pool is regularly exhausted.
+   - Every header is claimed in a side table on allocation; a second claim
+     means the pool handed the same header out twice
+   - Every payload is filled with a per-allocation stamp and checked on free;
+     two live messages sharing a block overwrite each other's stamp
+   At the end the pool must be full again (every header and block can be
+   allocated exactly once) and the counters must agree with what the
+   threads observed.
+
+   Usage: test_msg_pool [threads] [ops per thread]   (defaults 4, 500000)
+   ============================================================================== */
+
+#include <Arduino.h>
+#include "../globals.h"
+#include "../msg_pool.h"
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#define STRESS_HELD_MAX 12   /* Per thread; 4 threads x 12 > MSG_POOL_SIZE forces exhaustion */
+#define STRESS_BATCH_MAX 4
+
+static std::atomic<bool> headerClaimed[MSG_POOL_SIZE];
+static std::atomic<uint32_t> failures(0);
+static std::atomic<uint32_t> heldNow(0);
+static std::atomic<uint32_t> heldPeak(0);
+
+struct StressCounters {
+  uint64_t allocated;
+  uint64_t rejected;
+};
+
+#define CHECK(cond, ...) do { \
+  if (!(cond)) { \
+    failures.fetch_add(1, std::memory_order_relaxed); \
+    printf("FAIL %s:%d: %s: ", __FILE__, __LINE__, #cond); \
+    printf(__VA_ARGS__); \
+    printf("\n"); \
+  } \
+} while (0)
+
+struct Held {
+  ExecMessage* msg;
+  uint16_t len;
+  uint8_t stamp;
+};
+
+static uint32_t nextRandom(uint32_t& state) {
+  state ^= state << 13;
+  state ^= state >> 17;
+  state ^= state << 5;
+  return state;
+}
+
+/* randomLength: Payload lengths spread over every slab class, including both edges of each */
+static uint16_t randomLength(uint32_t& rng) {
+  static const uint16_t edges[] = {
+    0, MSG_SLAB_SMALL_SIZE - 1, MSG_SLAB_SMALL_SIZE,
+    MSG_SLAB_MEDIUM_SIZE - 1, MSG_SLAB_MEDIUM_SIZE, MAX_MSG_SIZE - 1
+  };
+  uint32_t r = nextRandom(rng);
+  if (r & 1) return edges[(r >> 1) % (sizeof(edges) / sizeof(edges[0]))];
+  return (uint16_t)((r >> 1) % MAX_MSG_SIZE);
+}
+
+static void claim(ExecMessage* msg, uint16_t len, uint8_t stamp, std::vector<Held>& held) {
+  ptrdiff_t index = msg - msgPool;
+  CHECK(index >= 0 && index < MSG_POOL_SIZE, "header %p outside msgPool", (void*)msg);
+  CHECK(!headerClaimed[index].exchange(true, std::memory_order_acq_rel), "header %d handed out twice", (int)index);
+  size_t capacity = msgPayloadCapacity(msg);
+  CHECK(capacity > len, "capacity %u for a %u byte payload", (unsigned)capacity, len);
+  memset(msg->payload, stamp, capacity);
+  held.push_back({ msg, len, stamp });
+
+  uint32_t now = heldNow.fetch_add(1, std::memory_order_relaxed) + 1;
+  uint32_t peak = heldPeak.load(std::memory_order_relaxed);
+  while (now > peak && !heldPeak.compare_exchange_weak(peak, now, std::memory_order_relaxed)) {
+  }
+}
+
+static void release(std::vector<Held>& held, size_t i) {
+  Held h = held[i];
+  held[i] = held.back();
+  held.pop_back();
+
+  size_t capacity = msgPayloadCapacity(h.msg);
+  for (size_t b = 0; b < capacity; b++) {
+    if ((uint8_t)h.msg->payload[b] != h.stamp) {
+      CHECK(false, "payload of header %d overwritten at byte %u", (int)(h.msg - msgPool), (unsigned)b);
+      break;
+    }
+  }
+  /* Unclaim first: once freed, another thread may be handed the header immediately */
+  heldNow.fetch_sub(1, std::memory_order_relaxed);
+  headerClaimed[h.msg - msgPool].store(false, std::memory_order_release);
+  freeMessage(h.msg);
+}
+
+static void stressThread(uint32_t seed, uint32_t ops, StressCounters* out) {
+  uint32_t rng = seed * 2654435761u + 1;
+  uint8_t stamp = (uint8_t)(seed * 61);
+  std::vector<Held> held;
+  StressCounters c = {};
+
+  for (uint32_t op = 0; op < ops; op++) {
+    uint32_t r = nextRandom(rng);
+    bool doAlloc = held.empty() || (held.size() < STRESS_HELD_MAX && (r & 3) != 0);
+    if (!doAlloc) {
+      release(held, (r >> 2) % held.size());
+      continue;
+    }
+
+    if ((r >> 2) % 4 == 0) {
+      uint8_t count = (uint8_t)(1 + (r >> 4) % STRESS_BATCH_MAX);
+      uint16_t lens[STRESS_BATCH_MAX];
+      ExecMessage* msgs[STRESS_BATCH_MAX];
+      for (uint8_t i = 0; i < count; i++) lens[i] = randomLength(rng);
+      if (allocMessageBatch(msgs, lens, count)) {
+        for (uint8_t i = 0; i < count; i++) {
+          CHECK(msgs[i]->lane == EXEC_LANE_BULK, "batch message on lane %u", msgs[i]->lane);
+          CHECK(msgs[i] - msgPool >= MSG_POOL_CONTROL_SLOTS, "batch took reserved header %d", (int)(msgs[i] - msgPool));
+          claim(msgs[i], lens[i], ++stamp, held);
+        }
+        c.allocated += count;
+      } else {
+        c.rejected++;
+      }
+    } else {
+      ExecLane lane = ((r >> 4) % 8 == 0) ? EXEC_LANE_CONTROL : EXEC_LANE_BULK;
+      uint16_t len = randomLength(rng);
+      ExecMessage* msg = allocMessage(lane, len);
+      if (msg) {
+        CHECK(lane == EXEC_LANE_CONTROL || msg - msgPool >= MSG_POOL_CONTROL_SLOTS,
+              "bulk message took reserved header %d", (int)(msg - msgPool));
+        claim(msg, len, ++stamp, held);
+        c.allocated++;
+      } else {
+        c.rejected++;
+      }
+    }
+  }
+
+  while (!held.empty()) release(held, held.size() - 1);
+  *out = c;
+}
+
+/* checkFull: Every header and block is free again; drains each resource once, then restores it */
+static void checkFull() {
+  MsgPoolStats pool;
+  getMsgPoolStats(pool);
+  CHECK(pool.inUse == 0, "%u headers still in use", pool.inUse);
+  for (uint8_t c = 0; c < MSG_SLAB_CLASS_COUNT; c++) {
+    MsgSlabStats slab;
+    getMsgSlabStats(c, slab);
+    CHECK(slab.inUse == 0, "class %u: %u blocks still in use", c, slab.inUse);
+  }
+
+  /* Headers: bulk gets exactly the unreserved slots, control the rest */
+  std::vector<ExecMessage*> taken;
+  ExecMessage* msg;
+  while ((msg = allocMessage(EXEC_LANE_BULK, 0)) != nullptr) taken.push_back(msg);
+  CHECK(taken.size() == MSG_POOL_SIZE - MSG_POOL_CONTROL_SLOTS, "%u bulk headers free", (unsigned)taken.size());
+  while ((msg = allocMessage(EXEC_LANE_CONTROL, 0)) != nullptr) taken.push_back(msg);
+  CHECK(taken.size() == MSG_POOL_SIZE, "%u headers free in total", (unsigned)taken.size());
+  for (ExecMessage* m : taken) freeMessage(m);
+  taken.clear();
+
+  /* Blocks: each class drained from the largest down, so a smaller request cannot spill into it */
+  static const uint16_t classLen[MSG_SLAB_CLASS_COUNT] = {
+    MSG_SLAB_SMALL_SIZE - 1, MSG_SLAB_MEDIUM_SIZE - 1, MSG_SLAB_LARGE_SIZE - 1
+  };
+  static const uint16_t classBlocks[MSG_SLAB_CLASS_COUNT] = {
+    MSG_SLAB_SMALL_COUNT, MSG_SLAB_MEDIUM_COUNT, MSG_SLAB_LARGE_COUNT
+  };
+  std::vector<ExecMessage*> parked;
+  for (int c = MSG_SLAB_CLASS_COUNT - 1; c >= 0; c--) {
+    uint32_t got = 0;
+    while (parked.size() < MSG_POOL_SIZE && (msg = allocMessage(EXEC_LANE_BULK, classLen[c])) != nullptr) {
+      CHECK(msg->slabClass == c, "class %d drain got a class %u block", c, msg->slabClass);
+      parked.push_back(msg);
+      got++;
+    }
+    /* The small class has more blocks than there are headers left after the larger ones */
+    uint32_t expect = classBlocks[c];
+    uint32_t headersLeft = MSG_POOL_SIZE - MSG_POOL_CONTROL_SLOTS - (uint32_t)(parked.size() - got);
+    if (expect > headersLeft) expect = headersLeft;
+    CHECK(got == expect, "class %d: %u blocks free, expected %u", c, got, expect);
+  }
+  for (ExecMessage* m : parked) freeMessage(m);
+}
+
+int main(int argc, char** argv) {
+  uint32_t threads = argc > 1 ? strtoul(argv[1], nullptr, 10) : 4;
+  uint32_t ops = argc > 2 ? strtoul(argv[2], nullptr, 10) : 500000;
+
+  msgPoolInit();
+  for (std::atomic<bool>& c : headerClaimed) c.store(false);
+
+  std::vector<StressCounters> counters(threads);
+  std::vector<std::thread> workers;
+  for (uint32_t t = 0; t < threads; t++) {
+    workers.emplace_back(stressThread, t + 1, ops, &counters[t]);
+  }
+  for (std::thread& w : workers) w.join();
+
+  uint64_t allocated = 0;
+  uint64_t rejected = 0;
+  for (const StressCounters& c : counters) {
+    allocated += c.allocated;
+    rejected += c.rejected;
+  }
+
+  MsgPoolStats pool;
+  getMsgPoolStats(pool);
+  printf("[test_msg_pool] %u threads x %u ops: %llu allocated, %llu rejected, high-water %u/%u (observed %u)\n",
+         threads, ops, (unsigned long long)allocated, (unsigned long long)rejected,
+         pool.highWater, pool.capacity, heldPeak.load());
+
+  CHECK(pool.allocs == (uint32_t)allocated, "pool counted %u allocs, threads got %llu",
+        pool.allocs, (unsigned long long)allocated);
+  CHECK(pool.exhausted == (uint32_t)rejected, "pool counted %u exhaustions, threads saw %llu",
+        pool.exhausted, (unsigned long long)rejected);
+  CHECK(pool.highWater <= MSG_POOL_SIZE, "high-water %u above capacity", pool.highWater);
+  CHECK(pool.highWater >= heldPeak.load(), "high-water %u below observed %u", pool.highWater, heldPeak.load());
+  CHECK(threads * STRESS_HELD_MAX <= MSG_POOL_SIZE || rejected > 0, "pool never ran dry");
+
+  uint64_t slabAllocs = 0;
+  for (uint8_t c = 0; c < MSG_SLAB_CLASS_COUNT; c++) {
+    MsgSlabStats slab;
+    getMsgSlabStats(c, slab);
+    printf("  class %u (%3u B x %2u): %u allocs, %u spills, high-water %u\n",
+           c, slab.blockSize, slab.blocks, slab.allocs, slab.spills, slab.highWater);
+    CHECK(slab.highWater <= slab.blocks, "class %u high-water %u above %u blocks", c, slab.highWater, slab.blocks);
+    CHECK(slab.allocs == 0 || slab.highWater > 0, "class %u allocated without a high-water mark", c);
+    CHECK(slab.spills <= slab.allocs, "class %u: %u spills > %u allocs", c, slab.spills, slab.allocs);
+    slabAllocs += slab.allocs;
+  }
+  /* Block allocs include blocks a failed batch took and rolled back, so they may exceed header allocs */
+  CHECK(slabAllocs >= allocated, "%llu block allocs for %llu messages",
+        (unsigned long long)slabAllocs, (unsigned long long)allocated);
+
+  checkFull();
+
+  uint32_t failed = failures.load();
+  printf("[test_msg_pool] %s\n", failed ? "FAILED" : "OK");
+  return failed ? 1 : 0;
+}
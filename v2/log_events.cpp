@@ -0,0 +1,98 @@
+/* ==============================================================================
+   LOG_EVENTS.CPP - Debug Log Event Formatting
+
+   Renders a LogEntry from its event's format, one conversion at a time:
+   integer arguments are taken in order from args[], %s takes str, with a
+   trailing "…" if it was cut. Runs only when logs are read, never on the
+   logging path.
+   ============================================================================== */
+
+#include "log_events.h"
+
+#if DEBUG_MODE
+
+size_t formatLogEvent(const LogEntry& e, char* out, size_t len) {
+  if (len == 0) return 0;
+  const char* fmt = logEventFormat(e.id);
+  if (!fmt) {
+    snprintf(out, len, "Unknown event %u", e.id);
+    return strlen(out);
+  }
+
+  size_t pos = 0;
+  uint8_t arg = 0;
+  for (const char* p = fmt; *p && pos < len - 1; p++) {
+    if (*p != '%') {
+      out[pos++] = *p;
+      continue;
+    }
+    if (p[1] == '%' || p[1] == '\0') {
+      out[pos++] = '%';
+      if (p[1]) p++;
+      continue;
+    }
+
+    /* Copy "%<flags><width><conv>" into its own format for snprintf */
+    char spec[8];
+    size_t n = 0;
+    spec[n++] = *p++;
+    while (n < sizeof(spec) - 2 &&
+           (*p == '-' || *p == '0' || *p == '+' || *p == ' ' || *p == '#' || (*p >= '1' && *p <= '9'))) {
+      spec[n++] = *p++;
+    }
+    if (*p == '\0') break;
+    spec[n++] = *p;
+    spec[n] = '\0';
+
+    int w;
+    if (*p == 's') {
+      char str[LOG_EVENT_STR];
+      memcpy(str, e.str, sizeof(str));
+      str[sizeof(str) - 1] = '\0';  /* Entries come from flash; do not trust the terminator */
+      w = snprintf(out + pos, len - pos, spec, str);
+      if (w > 0 && (e.flags & LOG_ENTRY_STR_CUT)) {
+        pos += (size_t)w;
+        if (pos > len - 1) pos = len - 1;
+        w = snprintf(out + pos, len - pos, "%s", LOG_STR_CUT_MARK);
+      }
+    } else {
+      uint32_t v = (arg < e.argc && arg < LOG_EVENT_ARGS) ? e.args[arg] : 0;
+      arg++;
+      if (*p == 'd' || *p == 'i') w = snprintf(out + pos, len - pos, spec, (int)(int32_t)v);
+      else w = snprintf(out + pos, len - pos, spec, (unsigned)v);
+    }
+    if (w > 0) pos += (size_t)w;
+    if (pos > len - 1) pos = len - 1;
+  }
+  out[pos] = '\0';
+  return pos;
+}
+
+LogEntry upgradeLogEntry(const LegacyLogEntry& old) {
+  LogEntry e = {};
+  e.uptime = old.uptime;
+  e.epoch = old.epoch;
+  e.id = EVT_LEGACY_TEXT;
+  /* The old text came from flash and may lack its terminator */
+  size_t n = strnlen(old.msg, sizeof(old.msg));
+  if (n > sizeof(e.str) - 1) {
+    n = sizeof(e.str) - 1;
+    e.flags = LOG_ENTRY_STR_CUT;
+  }
+  memcpy(e.str, old.msg, n);
+  return e;
+}
+
+LogEntry upgradeLogEntry(const LogEntryV2& old) {
+  LogEntry e = {};
+  e.uptime = old.uptime;
+  e.epoch = old.epoch;
+  e.id = old.id;
+  e.argc = old.argc;
+  memcpy(e.args, old.args, sizeof(e.args));
+  memcpy(e.str, old.str, sizeof(old.str));
+  e.str[sizeof(old.str) - 1] = '\0';
+  return e;
+}
+
+#endif
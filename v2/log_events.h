@@ -0,0 +1,133 @@
+/* ==============================================================================
+   LOG_EVENTS.H - Debug Log Event Table
+
+   Debug logs are recorded as an event ID plus typed arguments (a LogEntry,
+   40 bytes), not as text. The format strings live only in the table below:
+   - Call sites pass the ID and raw values; nothing is formatted or
+     allocated when logging:
+       LOG_ERROR(EVT_OTA_REDIRECT, httpCode);
+   - formatLogEvent() renders an entry when /api/debug/logs is read.
+   - tools/log_decode.py parses this file to render raw API output or a
+     dump of the log store partition on the host.
+
+   Formats take %d, %u and %x (optionally with flags and width) for up to
+   LOG_EVENT_ARGS integer arguments, and one %s for a string argument of up
+   to LOG_EVENT_STR - 1 characters, enough for a task name; longer ones are
+   cut and render with a trailing "…" (LOG_STR_CUT_MARK). The argument count
+   and kinds are checked against the format at compile time.
+   ============================================================================== */
+
+/* Header guard to prevent multiple inclusion of log_events.h */
+#ifndef LOG_EVENTS_H
+#define LOG_EVENTS_H
+
+#include "config.h"
+
+#if DEBUG_MODE
+
+#include <Arduino.h>
+#include "types.h"
+
+/* X(name, id, format). IDs are stored on flash and read by the host decoder:
+   never renumber or reuse one, only add. Grouped by subsystem in hundreds;
+   900s hold text logs of older firmware, converted once at boot. */
+#define LOG_EVENT_TABLE(X) \
+  X(EVT_UNEXPECTED_REBOOT,        100, "Unexpected reboot: %s") \
+  X(EVT_WIFI_MUTEX_FAILED,        101, "wifiMutex creation failed") \
+  X(EVT_TIME_MUTEX_FAILED,        102, "timeMutex creation failed") \
+  X(EVT_OTA_MUTEX_FAILED,         103, "otaMutex creation failed") \
+  X(EVT_DELETION_MUTEX_FAILED,    104, "taskDeletionMutex creation failed") \
+  X(EVT_NO_OTA_PARTITION_BOOT,    105, "No OTA partition found") \
+  X(EVT_TASK_CREATE_FAILED,       106, "Failed to create %s") \
+  X(EVT_STACK_LOW,                107, "Stack %s low: %u of %u B free") \
+  X(EVT_STACK_CRITICAL,           108, "Stack %s critical: %u of %u B free") \
+  X(EVT_STACK_LOW_FREE,           109, "Stack %s low: %u B free") \
+  X(EVT_STACK_CRITICAL_FREE,      110, "Stack %s critical: %u B free") \
+  X(EVT_MSG_POOL_EXHAUSTED,       111, "Message pool exhausted") \
+  X(EVT_MSG_POOL_BAD_FREE,        112, "freeMessage: invalid or double free") \
+  X(EVT_TEMP_READ_FAILED,         113, "Failed to read temperature") \
+  X(EVT_TASK_STATE_FAILED,        114, "Failed to get task state") \
+  X(EVT_WIFI_DISCONNECTED,        200, "WiFi disconnected") \
+  X(EVT_WIFI_RECONNECTED,         201, "WiFi reconnected") \
+  X(EVT_WIFI_MAX_RETRIES,         202, "WiFi: Max reconnect attempts") \
+  X(EVT_WIFI_CONNECT_TIMEOUT,     203, "WiFi: Connection timeout") \
+  X(EVT_WIFI_SAVE_FAILED,         204, "Failed to save %s") \
+  X(EVT_NET_CONFIG_UPDATED,       205, "Network config updated") \
+  X(EVT_NTP_TIMEOUT,              206, "NTP sync timeout") \
+  X(EVT_OTA_PARTITION_ITER,       300, "Partition iteration failed") \
+  X(EVT_OTA_NO_PARTITION,         301, "No OTA partition available") \
+  X(EVT_OTA_BIZ_FORCE_DELETED,    302, "biz%u force deleted (OTA)") \
+  X(EVT_OTA_WEB_FORCE_DELETED,    303, "webTask force deleted (OTA)") \
+  X(EVT_OTA_DELETION_MUTEX,       304, "Failed to acquire taskDeletionMutex (%s)") \
+  X(EVT_OTA_RECREATE_BIZ_FAILED,  305, "Failed to recreate biz workers") \
+  X(EVT_OTA_RECREATE_WEB_FAILED,  306, "Failed to recreate webTask") \
+  X(EVT_OTA_NO_BODY,              307, "OTA: No request body") \
+  X(EVT_OTA_BAD_JSON,             308, "OTA: Bad JSON") \
+  X(EVT_OTA_NO_URL,               309, "OTA: No URL provided") \
+  X(EVT_OTA_WIFI_NOT_CONNECTED,   310, "OTA: WiFi not connected") \
+  X(EVT_OTA_BUSY,                 311, "OTA: Already in progress") \
+  X(EVT_OTA_NO_MEMORY,            312, "OTA: Insufficient memory") \
+  X(EVT_OTA_TASK_FAILED,          313, "OTA: Task creation failed") \
+  X(EVT_OTA_REDIRECT,             314, "OTA: Redirect %d") \
+  X(EVT_OTA_HTTP_ERROR,           315, "OTA: HTTP error %d") \
+  X(EVT_OTA_BAD_LENGTH,           316, "OTA: Invalid content length") \
+  X(EVT_OTA_TOO_LARGE,            317, "OTA: File too large: %d > %u bytes") \
+  X(EVT_OTA_BEGIN_FAILED,         318, "OTA: Update.begin() error: %u") \
+  X(EVT_OTA_WIFI_LOST,            319, "OTA: WiFi disconnected") \
+  X(EVT_OTA_WRITE_FAILED,         320, "OTA: Write failed at %u, error: %u") \
+  X(EVT_OTA_END_FAILED,           321, "OTA: Update.end() error: %u") \
+  X(EVT_OTA_INCOMPLETE,           322, "OTA: Update incomplete") \
+  X(EVT_BLE_SERVER_FAILED,        400, "BLE server creation failed") \
+  X(EVT_BLE_SERVICE_FAILED,       401, "BLE service creation failed") \
+  X(EVT_BLE_TX_CHAR_FAILED,       402, "BLE TX characteristic failed") \
+  X(EVT_BLE_RX_CHAR_FAILED,       403, "BLE RX characteristic failed") \
+  X(EVT_BLE_UNKNOWN_CMD,          404, "BLE: Unknown cmd: %s") \
+  X(EVT_BLE_BAD_FORMAT,           405, "BLE: Invalid command format") \
+  X(EVT_CMD_BAD_IP,               406, "CMD: Invalid IP address") \
+  X(EVT_LEGACY_TEXT,              900, "%s")
+
+enum LogEventId : uint16_t {
+#define LOG_EVENT_ENUM(name, id, fmt) name = id,
+  LOG_EVENT_TABLE(LOG_EVENT_ENUM)
+#undef LOG_EVENT_ENUM
+};
+
+/* Format of an event; nullptr for an ID this firmware does not know */
+constexpr const char* logEventFormat(uint16_t id) {
+  switch (id) {
+#define LOG_EVENT_CASE(name, id, fmt) case id: return fmt;
+    LOG_EVENT_TABLE(LOG_EVENT_CASE)
+#undef LOG_EVENT_CASE
+    default: return nullptr;
+  }
+}
+
+/* Conversions in a format: str counts %s, ints the rest; "%%" is neither */
+constexpr uint8_t logFormatArgs(const char* fmt, bool str) {
+  uint8_t n = 0;
+  for (const char* p = fmt; *p; p++) {
+    if (*p != '%') continue;
+    p++;
+    if (*p == '\0') break;
+    if (*p == '%') continue;
+    while (*p == '-' || *p == '0' || *p == '+' || *p == ' ' || *p == '#' || (*p >= '1' && *p <= '9')) p++;
+    if (*p == '\0') break;
+    if ((*p == 's') == str) n++;
+  }
+  return n;
+}
+
+/* Renders an entry into out (always terminated); returns the length written */
+size_t formatLogEvent(const LogEntry& e, char* out, size_t len);
+
+/* Appended by formatLogEvent() and tools/log_decode.py to a string argument that was cut */
+#define LOG_STR_CUT_MARK "\xE2\x80\xA6"  /* "…" in UTF-8 */
+
+/* Entries of older firmware in the current layout. A text entry becomes an EVT_LEGACY_TEXT
+   event with the same times and the start of its text */
+LogEntry upgradeLogEntry(const LegacyLogEntry& old);
+LogEntry upgradeLogEntry(const LogEntryV2& old);
+
+#endif
+
+#endif
@@ -0,0 +1,358 @@
+/* ==============================================================================
+   LOG_STORE.CPP - Append-Only Flash Log Implementation
+
+   Layout of each LOG_SEGMENT_SIZE segment:
+     [header 16 B: magic, segSeq, reserved, crc][record 52 B] x 78
+   An erased slot reads as all 0xFF; a slot that is neither erased nor
+   CRC-valid was torn by a reset and is skipped, never rewritten.
+
+   Segments holding data are consecutive (circularly) and end at the head;
+   one segment is always kept erased as the spare. When the head fills, the
+   spare becomes the head. If that leaves no spare, the oldest segment's
+   live records are copied into the fresh head, and the oldest is erased
+   only once every copy is on flash. Copies keep their sequence number, so
+   a reset between copy and erase only leaves duplicates, which recovery
+   drops. A collection cut short by a reset or a failed write leaves a head
+   holding nothing but copies; the next append erases it and starts over.
+
+   A store holding only segments of older firmware is converted once at
+   boot: "LOG2" (events with a 12-byte string) if there are any, else "LOG1"
+   (text entries, which become EVT_LEGACY_TEXT events). The newest
+   MAX_DEBUG_LOGS records per category keep their sequence numbers; the
+   region is erased and they are appended again. A reset in between loses
+   them.
+
+   Only flashWriteTask writes after boot, always under flashWriteMutex.
+   ============================================================================== */
+
+#include "log_store.h"
+
+#if DEBUG_MODE && ENABLE_LOG_STORE
+
+#include <esp_partition.h>
+#include <esp_rom_crc.h>
+#include "log_events.h"
+
+#define LOG_SEGMENT_SIZE 4096  /* One flash sector, the erase unit */
+#define LOG_SEGMENT_MAGIC 0x33474F4CUL  /* "LOG3" */
+#define LOG_V2_MAGIC 0x32474F4CUL       /* "LOG2": LogEntryV2 records, only read by migrateOld() */
+#define LOG_TEXT_MAGIC 0x31474F4CUL     /* "LOG1": LegacyLogEntry records, only read by migrateOld() */
+
+struct LogSegmentHeader {
+  uint32_t magic;
+  uint32_t segSeq;
+  uint32_t reserved;
+  uint32_t crc;
+};
+
+struct LogRecord {
+  uint32_t seq;
+  uint8_t cat;
+  uint8_t reserved[3];
+  LogEntry entry;
+  uint32_t crc;
+};
+
+/* A record of older firmware, the same but for its entry */
+template <typename Entry>
+struct OldLogRecord {
+  uint32_t seq;
+  uint8_t cat;
+  uint8_t reserved[3];
+  Entry entry;
+  uint32_t crc;
+};
+
+#define LOG_RECORDS_PER_SEGMENT ((LOG_SEGMENT_SIZE - sizeof(LogSegmentHeader)) / sizeof(LogRecord))
+
+static_assert(sizeof(LogSegmentHeader) == 16, "Segment header layout is on flash");
+static_assert(sizeof(LogRecord) == 52, "Record layout is on flash (and in tools/log_decode.py)");
+static_assert(sizeof(OldLogRecord<LogEntryV2>) == 44, "Layout written by older firmware");
+static_assert(sizeof(OldLogRecord<LegacyLogEntry>) == 80, "Layout written by older firmware");
+static_assert(LOG_STORE_SEGMENTS >= 4 && LOG_STORE_SEGMENTS <= 255, "LOG_STORE_SEGMENTS must be 4..255");
+static_assert((LOG_STORE_SEGMENTS - 2) * LOG_RECORDS_PER_SEGMENT >= LOG_CAT_COUNT * MAX_DEBUG_LOGS,
+              "Too few segments to keep every category's live records");
+
+enum RecordState : uint8_t {
+  RECORD_VALID,
+  RECORD_ERASED,
+  RECORD_CORRUPT
+};
+
+static const esp_partition_t* part = nullptr;
+static uint8_t headSeg = 0;
+static uint8_t usedSegs = 0;   /* Segments holding data, head included */
+static uint16_t headSlot = 0;  /* Next free record slot in the head */
+static uint32_t headSegSeq = 0;
+static uint32_t lastSeq = 0;
+
+/* Newest MAX_DEBUG_LOGS persisted sequence numbers per category, oldest at recentHead once full */
+static uint32_t recent[LOG_CAT_COUNT][MAX_DEBUG_LOGS];
+static uint8_t recentHead[LOG_CAT_COUNT];
+static uint8_t recentCount[LOG_CAT_COUNT];
+
+static inline size_t segOffset(uint8_t seg) {
+  return (size_t)seg * LOG_SEGMENT_SIZE;
+}
+
+static inline size_t recordOffset(uint8_t seg, uint16_t slot) {
+  return segOffset(seg) + sizeof(LogSegmentHeader) + (size_t)slot * sizeof(LogRecord);
+}
+
+static uint32_t headerCrc(const LogSegmentHeader& h) {
+  return esp_rom_crc32_le(0, (const uint8_t*)&h, offsetof(LogSegmentHeader, crc));
+}
+
+static uint32_t recordCrc(const LogRecord& r) {
+  return esp_rom_crc32_le(0, (const uint8_t*)&r, offsetof(LogRecord, crc));
+}
+
+static bool readHeader(uint8_t seg, LogSegmentHeader& h, uint32_t magic = LOG_SEGMENT_MAGIC) {
+  if (esp_partition_read(part, segOffset(seg), &h, sizeof(h)) != ESP_OK) return false;
+  return h.magic == magic && h.crc == headerCrc(h);
+}
+
+static RecordState readRecord(uint8_t seg, uint16_t slot, LogRecord& r) {
+  if (esp_partition_read(part, recordOffset(seg, slot), &r, sizeof(r)) != ESP_OK) return RECORD_CORRUPT;
+  if (r.crc == recordCrc(r) && r.cat < LOG_CAT_COUNT) return RECORD_VALID;
+  const uint8_t* bytes = (const uint8_t*)&r;
+  for (size_t i = 0; i < sizeof(r); i++) {
+    if (bytes[i] != 0xFF) return RECORD_CORRUPT;
+  }
+  return RECORD_ERASED;
+}
+
+static bool writeRecord(const LogRecord& r) {
+  esp_err_t err = esp_partition_write(part, recordOffset(headSeg, headSlot), &r, sizeof(r));
+  headSlot++;  /* A failed write may have left bits programmed; never reuse the slot */
+  return err == ESP_OK;
+}
+
+static bool isLive(uint8_t cat, uint32_t seq) {
+  if (recentCount[cat] < MAX_DEBUG_LOGS) return true;
+  return seq >= recent[cat][recentHead[cat]];
+}
+
+static void pushRecent(uint8_t cat, uint32_t seq) {
+  recent[cat][recentHead[cat]] = seq;
+  recentHead[cat] = (recentHead[cat] + 1) % MAX_DEBUG_LOGS;
+  if (recentCount[cat] < MAX_DEBUG_LOGS) recentCount[cat]++;
+}
+
+static bool startSegment(uint8_t seg, uint32_t segSeq) {
+  if (esp_partition_erase_range(part, segOffset(seg), LOG_SEGMENT_SIZE) != ESP_OK) return false;
+  LogSegmentHeader h = { LOG_SEGMENT_MAGIC, segSeq, 0xFFFFFFFFUL, 0 };
+  h.crc = headerCrc(h);
+  if (esp_partition_write(part, segOffset(seg), &h, sizeof(h)) != ESP_OK) return false;
+  headSeg = seg;
+  headSegSeq = segSeq;
+  headSlot = 0;
+  return true;
+}
+
+/* collectOldest: Copies the oldest segment's live records into the empty head, which always has
+   room for a whole segment, then erases the oldest as the spare. Any failed copy keeps the oldest */
+static bool collectOldest() {
+  uint8_t oldest = (headSeg + 1) % LOG_STORE_SEGMENTS;
+  LogRecord r;
+  for (uint16_t slot = 0; slot < LOG_RECORDS_PER_SEGMENT; slot++) {
+    if (readRecord(oldest, slot, r) != RECORD_VALID || !isLive(r.cat, r.seq)) continue;
+    if (!writeRecord(r)) return false;
+  }
+  if (esp_partition_erase_range(part, segOffset(oldest), LOG_SEGMENT_SIZE) != ESP_OK) return false;
+  usedSegs--;
+  return true;
+}
+
+/* redoCollection: No spare means a collection did not finish. Its head holds only copies of records
+   still in the oldest segment (nothing is appended until it finishes), so the head is erased and
+   the copy restarted rather than continued into whatever room a torn or partial head has left */
+static bool redoCollection() {
+  return startSegment(headSeg, headSegSeq) && collectOldest();
+}
+
+static bool rotate() {
+  if (!startSegment((headSeg + 1) % LOG_STORE_SEGMENTS, headSegSeq + 1)) return false;
+  usedSegs++;
+  return (usedSegs < LOG_STORE_SEGMENTS) ? true : collectOldest();
+}
+
+/* insertNewest: Keeps out/seqs sorted by seq, newest MAX_DEBUG_LOGS only, without duplicates */
+static void insertNewest(LogEntry* out, uint32_t* seqs, uint8_t& count, const LogRecord& r) {
+  uint8_t pos = count;
+  while (pos > 0 && seqs[pos - 1] > r.seq) pos--;
+  if (pos > 0 && seqs[pos - 1] == r.seq) return;  /* Copy left by an interrupted collection */
+
+  if (count == MAX_DEBUG_LOGS) {
+    if (pos == 0) return;
+    pos--;
+    memmove(&out[0], &out[1], pos * sizeof(LogEntry));
+    memmove(&seqs[0], &seqs[1], pos * sizeof(uint32_t));
+  } else {
+    memmove(&out[pos + 1], &out[pos], (count - pos) * sizeof(LogEntry));
+    memmove(&seqs[pos + 1], &seqs[pos], (count - pos) * sizeof(uint32_t));
+    count++;
+  }
+  out[pos] = r.entry;
+  seqs[pos] = r.seq;
+}
+
+/* Per-category newest records while old segments are read back */
+struct OldCategory {
+  LogEntry entries[MAX_DEBUG_LOGS];
+  uint32_t seqs[MAX_DEBUG_LOGS];
+  uint8_t count;
+};
+
+/* readOldSegment: Converts a segment's valid records, keeping the newest of each category */
+template <typename Entry>
+static void readOldSegment(uint8_t seg, OldCategory* cats) {
+  OldLogRecord<Entry> old;
+  LogRecord r;
+  const uint16_t slots = (LOG_SEGMENT_SIZE - sizeof(LogSegmentHeader)) / sizeof(old);
+  for (uint16_t slot = 0; slot < slots; slot++) {
+    size_t offset = segOffset(seg) + sizeof(LogSegmentHeader) + (size_t)slot * sizeof(old);
+    if (esp_partition_read(part, offset, &old, sizeof(old)) != ESP_OK) continue;
+    if (old.crc != esp_rom_crc32_le(0, (const uint8_t*)&old, offsetof(OldLogRecord<Entry>, crc))) continue;
+    if (old.cat >= LOG_CAT_COUNT) continue;
+    r.seq = old.seq;
+    r.cat = old.cat;
+    r.entry = upgradeLogEntry(old.entry);
+    insertNewest(cats[old.cat].entries, cats[old.cat].seqs, cats[old.cat].count, r);
+  }
+}
+
+/* migrateOld: Converts the segments of older firmware into the current layout; false if there were none.
+   Called by logStoreBegin() only when no current segment exists */
+static bool migrateOld() {
+  LogSegmentHeader h;
+  uint8_t v2Segs = 0;
+  uint8_t textSegs = 0;
+  for (uint8_t seg = 0; seg < LOG_STORE_SEGMENTS; seg++) {
+    if (readHeader(seg, h, LOG_V2_MAGIC)) v2Segs++;
+    else if (readHeader(seg, h, LOG_TEXT_MAGIC)) textSegs++;
+  }
+  if (v2Segs == 0 && textSegs == 0) return false;
+
+  /* Heap: boot only and once per device, not worth 4KB of permanent RAM */
+  OldCategory* cats = (OldCategory*)calloc(LOG_CAT_COUNT, sizeof(OldCategory));
+  if (!cats) return false;
+
+  /* LOG2 firmware left any LOG1 segments behind unread; its own records are the newer ones */
+  uint32_t magic = v2Segs ? LOG_V2_MAGIC : LOG_TEXT_MAGIC;
+  for (uint8_t seg = 0; seg < LOG_STORE_SEGMENTS; seg++) {
+    if (!readHeader(seg, h, magic)) continue;
+    if (v2Segs) readOldSegment<LogEntryV2>(seg, cats);
+    else readOldSegment<LegacyLogEntry>(seg, cats);
+  }
+
+  logStoreErase();
+  uint16_t moved = 0;
+  for (uint8_t cat = 0; cat < LOG_CAT_COUNT; cat++) {
+    for (uint8_t i = 0; i < cats[cat].count; i++) {
+      if (logStoreAppend((LogCategory)cat, cats[cat].seqs[i], cats[cat].entries[i])) moved++;
+    }
+  }
+  free(cats);
+  Serial.printf("Log store: converted %u old entries from %u segments\n", moved, v2Segs ? v2Segs : textSegs);
+  return true;
+}
+
+bool logStoreBegin() {
+  part = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, LOG_STORE_PARTITION);
+  if (!part || part->size < (uint32_t)LOG_STORE_SEGMENTS * LOG_SEGMENT_SIZE) {
+    Serial.printf("Log store: no '%s' partition of %u KB, using NVS\n",
+                  LOG_STORE_PARTITION, LOG_STORE_SEGMENTS * LOG_SEGMENT_SIZE / 1024);
+    part = nullptr;
+    return false;
+  }
+
+  usedSegs = 0;
+  lastSeq = 0;
+  LogSegmentHeader h;
+  for (uint8_t seg = 0; seg < LOG_STORE_SEGMENTS; seg++) {
+    if (!readHeader(seg, h)) continue;
+    if (usedSegs == 0 || h.segSeq > headSegSeq) {
+      headSeg = seg;
+      headSegSeq = h.segSeq;
+    }
+    usedSegs++;
+
+    LogRecord r;
+    for (uint16_t slot = 0; slot < LOG_RECORDS_PER_SEGMENT; slot++) {
+      if (readRecord(seg, slot, r) == RECORD_VALID && r.seq > lastSeq) lastSeq = r.seq;
+    }
+  }
+
+  if (usedSegs == 0) {
+    if (migrateOld()) return part != nullptr;
+    usedSegs = 1;
+    if (!startSegment(0, 1)) part = nullptr;
+    return part != nullptr;
+  }
+
+  /* Append after the last programmed slot, torn or not */
+  headSlot = 0;
+  LogRecord r;
+  for (uint16_t slot = 0; slot < LOG_RECORDS_PER_SEGMENT; slot++) {
+    if (readRecord(headSeg, slot, r) != RECORD_ERASED) headSlot = slot + 1;
+  }
+
+  Serial.printf("Log store: %u/%u segments, head %u slot %u, last seq %u\n",
+                usedSegs, LOG_STORE_SEGMENTS, headSeg, headSlot, lastSeq);
+  return true;
+}
+
+uint8_t logStoreRecover(LogCategory cat, LogEntry* out, uint32_t* seqs) {
+  uint8_t count = 0;
+  if (!part) return 0;
+
+  LogSegmentHeader h;
+  LogRecord r;
+  for (uint8_t seg = 0; seg < LOG_STORE_SEGMENTS; seg++) {
+    if (!readHeader(seg, h)) continue;
+    for (uint16_t slot = 0; slot < LOG_RECORDS_PER_SEGMENT; slot++) {
+      if (readRecord(seg, slot, r) == RECORD_VALID && r.cat == cat) insertNewest(out, seqs, count, r);
+    }
+  }
+
+  recentHead[cat] = 0;
+  recentCount[cat] = 0;
+  for (uint8_t i = 0; i < count; i++) pushRecent(cat, seqs[i]);
+  return count;
+}
+
+uint32_t logStoreLastSeq() {
+  return lastSeq;
+}
+
+bool logStoreAppend(LogCategory cat, uint32_t seq, const LogEntry& entry) {
+  if (!part) return false;
+  /* A reset or failed write mid-collection leaves no spare; nothing is appended until it is redone */
+  if (usedSegs >= LOG_STORE_SEGMENTS && !redoCollection()) return false;
+  if (headSlot >= LOG_RECORDS_PER_SEGMENT && !rotate()) return false;
+
+  LogRecord r;
+  r.seq = seq;
+  r.cat = cat;
+  memset(r.reserved, 0xFF, sizeof(r.reserved));
+  r.entry = entry;
+  r.crc = recordCrc(r);
+  if (!writeRecord(r)) return false;
+
+  pushRecent(cat, seq);
+  if (seq > lastSeq) lastSeq = seq;
+  return true;
+}
+
+void logStoreErase() {
+  if (!part) return;
+  esp_partition_erase_range(part, 0, (size_t)LOG_STORE_SEGMENTS * LOG_SEGMENT_SIZE);
+  memset(recentHead, 0, sizeof(recentHead));
+  memset(recentCount, 0, sizeof(recentCount));
+  lastSeq = 0;
+  usedSegs = 1;
+  if (!startSegment(0, 1)) part = nullptr;
+}
+
+#endif
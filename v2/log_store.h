@@ -0,0 +1,51 @@
+/* ==============================================================================
+   LOG_STORE.H - Append-Only Flash Log Interface
+
+   Persists debug log entries as fixed-size records appended to a raw data
+   partition (LOG_STORE_PARTITION), instead of rewriting a whole category
+   array in NVS for every new line:
+   - The region is LOG_STORE_SEGMENTS flash sectors (segments), used as a
+     circular log. Each segment starts with a header carrying its own
+     sequence number; each record carries the entry's sequence number and a
+     CRC32, so a torn write is detected and skipped.
+   - One new log event costs one 52-byte write. A sector is erased only when
+     the log wraps onto it.
+   - Before the oldest segment is erased, records that are still among the
+     last MAX_DEBUG_LOGS of their category are copied to the head, so a
+     rarely used category (reboots) is not pushed out by a noisy one.
+   - Startup scans every segment and rebuilds each category from the
+     records with the highest sequence numbers.
+
+   Without a usable partition logStoreBegin() returns false and
+   debug_handler keeps using NVS.
+   ============================================================================== */
+
+/* Header guard to prevent multiple inclusion of log_store.h */
+#ifndef LOG_STORE_H
+#define LOG_STORE_H
+
+#include "config.h"
+
+#if DEBUG_MODE && ENABLE_LOG_STORE
+
+#include <Arduino.h>
+#include "types.h"
+
+/* Finds the partition and recovers the head position; false if there is no usable partition */
+bool logStoreBegin();
+
+/* Fills out/seqs (MAX_DEBUG_LOGS each) with the category's newest records, oldest first */
+uint8_t logStoreRecover(LogCategory cat, LogEntry* out, uint32_t* seqs);
+
+/* Highest record sequence number on flash; 0 if the store is empty */
+uint32_t logStoreLastSeq();
+
+/* Appends one record; seq must increase within the category. flashWriteTask only */
+bool logStoreAppend(LogCategory cat, uint32_t seq, const LogEntry& entry);
+
+/* Erases every segment */
+void logStoreErase();
+
+#endif
+
+#endif
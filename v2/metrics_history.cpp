@@ -0,0 +1,328 @@
+/* ==============================================================================
+   METRICS_HISTORY.CPP - CPU Load Time-Series Implementation
+
+   Each resolution has its own accumulator fed by every raw sample, so the
+   10s and 60s min/avg/max are exact rather than averages of averages. When
+   an accumulator has seen a bucket's worth of samples it is closed into
+   that resolution's ring.
+
+   statsTask is the only writer. A ring slot is written first and only then
+   counted in `closed`; a reader copies bucket k and keeps it only if
+   `closed` is still below k + capacity afterwards, i.e. the writer has not
+   started reusing that slot. Readers never block the sampler.
+
+   Per-task series come from every task's CPU% in DEBUG_MODE, otherwise
+   from the cpu_monitor top-N snapshot (ENABLE_TASK_TOP); there a sample in
+   which a task was outside the TASK_TOP_N busiest counts as 0%.
+
+   Task names are interned into METRICS_TASK_NAMES slots so a bucket stores
+   a one-byte index. A slot is recycled least-recently-seen first; buckets
+   that ended before the slot's reassignment then report the index as -1.
+   ============================================================================== */
+
+#include "metrics_history.h"
+
+#if ENABLE_METRICS_HISTORY
+
+#include "globals.h"
+#include "web_handler.h"
+#include <esp_timer.h>
+#include <atomic>
+
+#if DEBUG_MODE
+#include "debug_handler.h"
+#elif ENABLE_TASK_TOP
+#include "cpu_monitor.h"
+#endif
+
+static_assert(1000 % STATS_SAMPLE_INTERVAL_MS == 0, "History buckets need a whole number of samples per second");
+static_assert(METRICS_TASK_NAMES < 0xFF, "Task name indexes must fit below METRICS_NO_TASK");
+
+#define METRICS_NO_TASK 0xFF
+#define METRICS_LEVELS 3
+#define METRICS_PER_TASK (DEBUG_MODE || ENABLE_TASK_TOP)
+
+#if DEBUG_MODE
+typedef TaskCpuSample MetricsTaskSample;
+#define METRICS_TASK_SAMPLES MAX_TASKS_MONITORED
+static uint8_t readTaskSamples(MetricsTaskSample* out) { return getTaskCpuSamples(out, METRICS_TASK_SAMPLES); }
+#elif ENABLE_TASK_TOP
+typedef TaskTopEntry MetricsTaskSample;
+#define METRICS_TASK_SAMPLES TASK_TOP_N
+static uint8_t readTaskSamples(MetricsTaskSample* out) { return getTaskTop(out, METRICS_TASK_SAMPLES); }
+#endif
+
+struct MetricsAgg {
+  uint8_t min;
+  uint8_t avg;
+  uint8_t max;
+};
+
+struct MetricsTaskAgg {
+  uint8_t name;
+  MetricsAgg cpu;
+};
+
+struct MetricsBucket {
+  uint32_t startSec;
+  MetricsAgg cores[NUM_CORES];
+  MetricsTaskAgg tasks[METRICS_TOP_TASKS];
+};
+
+struct SeriesAccum {
+  uint32_t sum;
+  uint16_t count;
+  uint8_t min;
+  uint8_t max;
+};
+
+struct LevelAccum {
+  uint32_t startSec;
+  uint16_t samples;
+  SeriesAccum cores[NUM_CORES];
+#if METRICS_PER_TASK
+  SeriesAccum tasks[METRICS_TASK_NAMES];
+#endif
+};
+
+struct MetricsRing {
+  MetricsBucket* buckets;
+  uint16_t capacity;
+  uint16_t periodSec;
+  std::atomic<uint32_t> closed;
+  LevelAccum acc;
+};
+
+static MetricsBucket buckets1s[METRICS_HIST_1S_BUCKETS];
+static MetricsBucket buckets10s[METRICS_HIST_10S_BUCKETS];
+static MetricsBucket buckets60s[METRICS_HIST_60S_BUCKETS];
+
+static MetricsRing rings[METRICS_LEVELS] = {
+  { buckets1s, METRICS_HIST_1S_BUCKETS, 1, {0}, {} },
+  { buckets10s, METRICS_HIST_10S_BUCKETS, 10, {0}, {} },
+  { buckets60s, METRICS_HIST_60S_BUCKETS, 60, {0}, {} }
+};
+
+#if METRICS_PER_TASK
+struct TaskName {
+  char name[configMAX_TASK_NAME_LEN];
+  uint32_t firstSec;
+  uint32_t lastSec;
+  bool used;
+};
+
+/* Written only by statsTask; readers copy it under namesSeq (odd while a slot changes) */
+static TaskName taskNames[METRICS_TASK_NAMES];
+static std::atomic<uint32_t> namesSeq(0);
+#endif
+
+static inline uint32_t uptimeSec() {
+  return (uint32_t)(esp_timer_get_time() / 1000000LL);
+}
+
+static void addSample(SeriesAccum& a, uint8_t value) {
+  if (a.count == 0 || value < a.min) a.min = value;
+  if (a.count == 0 || value > a.max) a.max = value;
+  a.sum += value;
+  a.count++;
+}
+
+/* closeSeries: Samples where the series was absent count as 0 */
+static MetricsAgg closeSeries(const SeriesAccum& a, uint16_t samples) {
+  MetricsAgg out;
+  out.min = (a.count < samples) ? 0 : a.min;
+  out.max = a.count ? a.max : 0;
+  out.avg = samples ? (uint8_t)((a.sum + samples / 2) / samples) : 0;
+  return out;
+}
+
+#if METRICS_PER_TASK
+/* internName: Index of the name slot for this task, recycling the least recently seen */
+static uint8_t internName(const char* name, uint32_t now) {
+  uint8_t freeSlot = METRICS_NO_TASK;
+  uint8_t oldest = METRICS_NO_TASK;
+  for (uint8_t i = 0; i < METRICS_TASK_NAMES; i++) {
+    TaskName& t = taskNames[i];
+    if (!t.used) {
+      if (freeSlot == METRICS_NO_TASK) freeSlot = i;
+      continue;
+    }
+    if (strncmp(t.name, name, sizeof(t.name)) == 0) {
+      t.lastSec = now;
+      return i;
+    }
+    if (t.lastSec < now && (oldest == METRICS_NO_TASK || t.lastSec < taskNames[oldest].lastSec)) oldest = i;
+  }
+
+  uint8_t slot = (freeSlot != METRICS_NO_TASK) ? freeSlot : oldest;
+  if (slot == METRICS_NO_TASK) return METRICS_NO_TASK;
+
+  uint32_t seq = namesSeq.load(std::memory_order_relaxed);
+  namesSeq.store(seq + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  TaskName& t = taskNames[slot];
+  strncpy(t.name, name, sizeof(t.name) - 1);
+  t.name[sizeof(t.name) - 1] = '\0';
+  t.firstSec = now;
+  t.lastSec = now;
+  t.used = true;
+  namesSeq.store(seq + 2, std::memory_order_release);
+
+  /* Drop whatever the previous owner left in the open buckets */
+  for (uint8_t l = 0; l < METRICS_LEVELS; l++) rings[l].acc.tasks[slot] = SeriesAccum();
+  return slot;
+}
+#endif
+
+static void closeBucket(MetricsRing& ring, uint32_t now) {
+  LevelAccum& acc = ring.acc;
+  uint32_t index = ring.closed.load(std::memory_order_relaxed);
+  MetricsBucket& b = ring.buckets[index % ring.capacity];
+
+  b.startSec = acc.startSec;
+  for (uint8_t c = 0; c < NUM_CORES; c++) b.cores[c] = closeSeries(acc.cores[c], acc.samples);
+
+  for (uint8_t n = 0; n < METRICS_TOP_TASKS; n++) b.tasks[n].name = METRICS_NO_TASK;
+#if METRICS_PER_TASK
+  /* Insertion into a short sorted list: top METRICS_TOP_TASKS by total CPU in the bucket */
+  for (uint8_t id = 0; id < METRICS_TASK_NAMES; id++) {
+    const SeriesAccum& a = acc.tasks[id];
+    if (a.count == 0 || a.sum == 0) continue;
+    MetricsTaskAgg entry = { id, closeSeries(a, acc.samples) };
+    for (uint8_t n = 0; n < METRICS_TOP_TASKS; n++) {
+      const MetricsTaskAgg& cur = b.tasks[n];
+      if (cur.name == METRICS_NO_TASK || acc.tasks[entry.name].sum > acc.tasks[cur.name].sum) {
+        MetricsTaskAgg displaced = b.tasks[n];
+        b.tasks[n] = entry;
+        entry = displaced;
+        if (entry.name == METRICS_NO_TASK) break;
+      }
+    }
+  }
+#endif
+
+  ring.closed.store(index + 1, std::memory_order_release);
+
+  acc = LevelAccum();
+  acc.startSec = now;
+}
+
+void metricsHistorySample() {
+  /* The first pass only primes the runtime counters; its load is meaningless */
+  static bool primed = false;
+  if (!primed) {
+    primed = true;
+    return;
+  }
+  uint32_t now = uptimeSec();
+
+  uint8_t load[NUM_CORES];
+  for (uint8_t c = 0; c < NUM_CORES; c++) load[c] = coreLoadPct[c];
+
+#if METRICS_PER_TASK
+  /* Static: in DEBUG_MODE over 1KB, more than the stats task stack should carry; statsTask is the only caller */
+  static MetricsTaskSample samples[METRICS_TASK_SAMPLES];
+  /* Resolve names once per sample, not once per resolution */
+  uint8_t ids[METRICS_TASK_SAMPLES];
+  uint8_t count = readTaskSamples(samples);
+  for (uint8_t i = 0; i < count; i++) {
+    bool idle = strncmp(samples[i].name, "IDLE", 4) == 0;
+    ids[i] = (idle || samples[i].cpuPercent == 0) ? METRICS_NO_TASK : internName(samples[i].name, now);
+  }
+#endif
+
+  for (uint8_t l = 0; l < METRICS_LEVELS; l++) {
+    MetricsRing& ring = rings[l];
+    LevelAccum& acc = ring.acc;
+    if (acc.samples == 0) acc.startSec = now;
+
+    for (uint8_t c = 0; c < NUM_CORES; c++) addSample(acc.cores[c], load[c]);
+#if METRICS_PER_TASK
+    for (uint8_t i = 0; i < count; i++) {
+      if (ids[i] != METRICS_NO_TASK) addSample(acc.tasks[ids[i]], samples[i].cpuPercent);
+    }
+#endif
+
+    acc.samples++;
+    if (acc.samples >= (uint32_t)ring.periodSec * (1000 / STATS_SAMPLE_INTERVAL_MS)) closeBucket(ring, now);
+  }
+}
+
+/* readBucket: Copies bucket k if it is still in the ring; false once the writer has reused its slot */
+static bool readBucket(const MetricsRing& ring, uint32_t k, MetricsBucket& out) {
+  memcpy(&out, &ring.buckets[k % ring.capacity], sizeof(out));
+  std::atomic_thread_fence(std::memory_order_acquire);
+  return ring.closed.load(std::memory_order_relaxed) - k < ring.capacity;
+}
+
+void registerMetricsRoutes() {
+  server.on("/api/metrics/history", HTTP_GET, handleApiMetricsHistory);
+}
+
+void handleApiMetricsHistory() {
+  if (isOtaActive()) {
+    sendBusyJson("OTA in progress");
+    return;
+  }
+
+  uint32_t res = server.hasArg("res") ? strtoul(server.arg("res").c_str(), nullptr, 10) : 10;
+  int level = -1;
+  for (uint8_t l = 0; l < METRICS_LEVELS; l++) {
+    if (rings[l].periodSec == res) level = l;
+  }
+  if (level < 0) {
+    server.send(400, "application/json", "{\"err\":\"res must be 1, 10 or 60\"}");
+    return;
+  }
+  uint32_t since = server.hasArg("since") ? strtoul(server.arg("since").c_str(), nullptr, 10) : 0;
+  const MetricsRing& ring = rings[level];
+
+  server.setContentLength(CONTENT_LENGTH_UNKNOWN);
+  server.send(200, "application/json", "");
+
+  ChunkWriter out;
+  out.printf("{\"res\":%u,\"now\":%u,\"cores\":%u,\"names\":[", res, uptimeSec(), NUM_CORES);
+
+#if METRICS_PER_TASK
+  static TaskName names[METRICS_TASK_NAMES];
+  uint32_t seq;
+  do {
+    seq = namesSeq.load(std::memory_order_acquire);
+    memcpy(names, taskNames, sizeof(names));
+    std::atomic_thread_fence(std::memory_order_acquire);
+  } while ((seq & 1) || namesSeq.load(std::memory_order_relaxed) != seq);
+
+  for (uint8_t i = 0; i < METRICS_TASK_NAMES; i++) {
+    out.printf("%s\"%s\"", i ? "," : "", names[i].used ? names[i].name : "");
+  }
+#endif
+  out.printf("],\"buckets\":[");
+
+  uint32_t closed = ring.closed.load(std::memory_order_acquire);
+  uint32_t first = (closed > ring.capacity) ? closed - ring.capacity : 0;
+  bool any = false;
+  for (uint32_t k = first; k < closed; k++) {
+    MetricsBucket b;
+    if (!readBucket(ring, k, b) || b.startSec < since) continue;
+
+    out.printf("%s[%u,[", any ? "," : "", b.startSec);
+    for (uint8_t c = 0; c < NUM_CORES; c++) {
+      out.printf("%s%u,%u,%u", c ? "," : "", b.cores[c].min, b.cores[c].avg, b.cores[c].max);
+    }
+    out.printf("],[");
+    for (uint8_t n = 0; n < METRICS_TOP_TASKS && b.tasks[n].name != METRICS_NO_TASK; n++) {
+      int name = b.tasks[n].name;
+#if METRICS_PER_TASK
+      if (names[name].firstSec >= b.startSec + ring.periodSec) name = -1;
+#endif
+      const MetricsAgg& cpu = b.tasks[n].cpu;
+      out.printf("%s%d,%u,%u,%u", n ? "," : "", name, cpu.min, cpu.avg, cpu.max);
+    }
+    out.printf("]]");
+    any = true;
+  }
+  out.printf("]}");
+  out.end();
+}
+
+#endif
@@ -0,0 +1,41 @@
+/* ==============================================================================
+   METRICS_HISTORY.H - CPU Load Time-Series Interface
+
+   Keeps a fixed-memory history of what statsTask samples every
+   STATS_SAMPLE_INTERVAL_MS, rolled up at three resolutions:
+   - 1s buckets  (METRICS_HIST_1S_BUCKETS, default 1 minute)
+   - 10s buckets (METRICS_HIST_10S_BUCKETS, default 10 minutes)
+   - 60s buckets (METRICS_HIST_60S_BUCKETS, default 2 hours)
+   Every bucket holds min/avg/max load per core and, with DEBUG_MODE or
+   ENABLE_TASK_TOP, min/avg/max CPU% of the METRICS_TOP_TASKS busiest tasks
+   in that bucket (idle excluded). Without DEBUG_MODE the tasks come from the
+   cpu_monitor top-N, so only tasks that reach its TASK_TOP_N are seen.
+
+   GET /api/metrics/history?res=1|10|60[&since=<uptime s>] streams one ring:
+   {"res":10,"now":5400,"cores":2,"names":["web","biz0",...],
+    "buckets":[[start_s,[c0min,c0avg,c0max,c1min,...],[name,min,avg,max,...]],...]}
+   name indexes "names"; -1 means the task's name slot was reused since.
+
+   Compiled only with ENABLE_METRICS_HISTORY.
+   ============================================================================== */
+
+/* Header guard to prevent multiple inclusion of metrics_history.h */
+#ifndef METRICS_HISTORY_H
+#define METRICS_HISTORY_H
+
+#include "config.h"
+
+#if ENABLE_METRICS_HISTORY
+
+#include <Arduino.h>
+
+/* Folds the latest core load and task CPU% into every resolution; statsTask only */
+void metricsHistorySample();
+
+void registerMetricsRoutes();
+
+void handleApiMetricsHistory();
+
+#endif
+
+#endif
@@ -0,0 +1,327 @@
+/* ==============================================================================
+   MSG_POOL.CPP - Lock-Free Message Pool Implementation
+
+   A message is a small header from msgPool[] plus a payload block from one
+   static slab arena. The arena is cut into size classes (small/medium/large)
+   so a short command only occupies a short block; a request is served from
+   the smallest class that fits and spills into the next larger class when
+   that one is empty.
+
+   Free headers and free blocks are kept on Treiber stacks of indices, one
+   for the header slots reserved to the control lane, one for bulk headers
+   and one per slab class. Each stack head is a single 32-bit word holding
+   [tag:16 | index:16]; every push and pop bumps the tag so a compare-and-
+   swap can never succeed against a head that was popped and re-pushed in
+   between (ABA protection).
+
+   allocMessageBatch() reserves several headers with one CAS on the bulk
+   stack and rolls everything back if any payload block is unavailable.
+
+   allocMessage() and freeMessage() are O(1), wait only on a CAS retry when
+   another task touched the pool at the same instant, and never block.
+   ============================================================================== */
+
+#include "msg_pool.h"
+#include "globals.h"
+#include "debug_handler.h"
+#include <atomic>
+
+#define POOL_NIL 0xFFFFu
+#define POOL_TAG_STEP 0x10000u
+
+#define SLAB_BLOCK_TOTAL (MSG_SLAB_SMALL_COUNT + MSG_SLAB_MEDIUM_COUNT + MSG_SLAB_LARGE_COUNT)
+#define SLAB_ARENA_BYTES (MSG_SLAB_SMALL_SIZE * MSG_SLAB_SMALL_COUNT + \
+                          MSG_SLAB_MEDIUM_SIZE * MSG_SLAB_MEDIUM_COUNT + \
+                          MSG_SLAB_LARGE_SIZE * MSG_SLAB_LARGE_COUNT)
+
+static_assert(MSG_POOL_SIZE < POOL_NIL, "MSG_POOL_SIZE must fit in a 16-bit index");
+
+static_assert(MSG_POOL_CONTROL_SLOTS < MSG_POOL_SIZE, "Control lane must leave slots for bulk traffic");
+
+static_assert(MSG_SLAB_SMALL_SIZE < MSG_SLAB_MEDIUM_SIZE && MSG_SLAB_MEDIUM_SIZE < MSG_SLAB_LARGE_SIZE,
+              "Slab classes must be in ascending size order");
+
+static_assert(MSG_SLAB_LARGE_SIZE == MAX_MSG_SIZE, "Largest slab class must hold MAX_MSG_SIZE");
+
+/* Every header can always find some block, so reserved control headers stay usable under bulk floods */
+static_assert(SLAB_BLOCK_TOTAL >= MSG_POOL_SIZE, "Need at least one payload block per header");
+
+static_assert(SLAB_BLOCK_TOTAL < POOL_NIL, "Slab block count must fit in a 16-bit index");
+
+struct IndexStack {
+  std::atomic<uint32_t> head;
+  std::atomic<uint16_t>* next;
+};
+
+struct SlabClass {
+  uint16_t blockSize;
+  uint16_t blockCount;
+  uint16_t firstBlock;
+  uint32_t arenaOffset;
+  IndexStack freeList;
+  std::atomic<uint32_t> inUse;
+  std::atomic<uint32_t> highWater;
+  std::atomic<uint32_t> allocs;
+  std::atomic<uint32_t> spills;
+};
+
+alignas(4) static char slabArena[SLAB_ARENA_BYTES];
+
+static std::atomic<uint16_t> headerNext[MSG_POOL_SIZE];
+static std::atomic<uint16_t> blockNext[SLAB_BLOCK_TOTAL];
+
+/* Header slots [0, MSG_POOL_CONTROL_SLOTS) are reserved for the control lane */
+static IndexStack controlStack = { {POOL_NIL}, headerNext };
+static IndexStack bulkStack = { {POOL_NIL}, headerNext };
+
+static SlabClass slabClasses[MSG_SLAB_CLASS_COUNT] = {
+  { MSG_SLAB_SMALL_SIZE, MSG_SLAB_SMALL_COUNT, 0, 0,
+    { {POOL_NIL}, blockNext }, {0}, {0}, {0}, {0} },
+  { MSG_SLAB_MEDIUM_SIZE, MSG_SLAB_MEDIUM_COUNT, MSG_SLAB_SMALL_COUNT,
+    MSG_SLAB_SMALL_SIZE * MSG_SLAB_SMALL_COUNT,
+    { {POOL_NIL}, blockNext }, {0}, {0}, {0}, {0} },
+  { MSG_SLAB_LARGE_SIZE, MSG_SLAB_LARGE_COUNT, MSG_SLAB_SMALL_COUNT + MSG_SLAB_MEDIUM_COUNT,
+    MSG_SLAB_SMALL_SIZE * MSG_SLAB_SMALL_COUNT + MSG_SLAB_MEDIUM_SIZE * MSG_SLAB_MEDIUM_COUNT,
+    { {POOL_NIL}, blockNext }, {0}, {0}, {0}, {0} }
+};
+
+static std::atomic<uint32_t> poolInUse(0);
+static std::atomic<uint32_t> poolHighWater(0);
+static std::atomic<uint32_t> poolAllocs(0);
+static std::atomic<uint32_t> poolExhausted(0);
+static std::atomic<bool> poolExhaustLogged(false);
+
+static inline uint32_t packHead(uint32_t oldHead, uint16_t index) {
+  return ((oldHead + POOL_TAG_STEP) & 0xFFFF0000u) | index;
+}
+
+static inline IndexStack& homeStack(uint16_t index) {
+  return (index < MSG_POOL_CONTROL_SLOTS) ? controlStack : bulkStack;
+}
+
+static void pushIndex(IndexStack& stack, uint16_t index) {
+  uint32_t head = stack.head.load(std::memory_order_relaxed);
+  uint32_t desired;
+  do {
+    stack.next[index].store((uint16_t)(head & 0xFFFFu), std::memory_order_relaxed);
+    desired = packHead(head, index);
+  } while (!stack.head.compare_exchange_weak(head, desired,
+                                             std::memory_order_release,
+                                             std::memory_order_relaxed));
+}
+
+static uint16_t popIndex(IndexStack& stack) {
+  uint32_t head = stack.head.load(std::memory_order_acquire);
+  for (;;) {
+    uint16_t index = (uint16_t)(head & 0xFFFFu);
+    if (index == POOL_NIL) return POOL_NIL;
+    uint32_t desired = packHead(head, stack.next[index].load(std::memory_order_relaxed));
+    if (stack.head.compare_exchange_weak(head, desired,
+                                         std::memory_order_acquire,
+                                         std::memory_order_acquire)) {
+      return index;
+    }
+  }
+}
+
+/* popIndices: Detaches `count` entries with a single CAS, all or nothing. Walking the chain is
+   safe because any concurrent push or pop bumps the head tag and makes the CAS retry. */
+static bool popIndices(IndexStack& stack, uint16_t* out, uint16_t count) {
+  uint32_t head = stack.head.load(std::memory_order_acquire);
+  for (;;) {
+    uint16_t index = (uint16_t)(head & 0xFFFFu);
+    uint16_t taken = 0;
+    while (taken < count && index != POOL_NIL) {
+      out[taken++] = index;
+      index = stack.next[index].load(std::memory_order_relaxed);
+    }
+    if (taken < count) return false;
+    if (stack.head.compare_exchange_weak(head, packHead(head, index),
+                                         std::memory_order_acquire,
+                                         std::memory_order_acquire)) {
+      return true;
+    }
+  }
+}
+
+static void noteHighWater(std::atomic<uint32_t>& highWater, uint32_t inUse) {
+  uint32_t hw = highWater.load(std::memory_order_relaxed);
+  while (inUse > hw &&
+         !highWater.compare_exchange_weak(hw, inUse, std::memory_order_relaxed)) {
+  }
+}
+
+static void noteExhausted() {
+  poolExhausted.fetch_add(1, std::memory_order_relaxed);
+  /* Log once per exhaustion episode; a burst must not flood the error log */
+  if (!poolExhaustLogged.exchange(true, std::memory_order_relaxed)) {
+    LOG_ERROR(EVT_MSG_POOL_EXHAUSTED);
+  }
+}
+
+/* allocBlock: Smallest class that fits first, then spill upwards; returns the class or 0xFF */
+static uint8_t allocBlock(size_t bytes, char** out) {
+  for (uint8_t c = 0; c < MSG_SLAB_CLASS_COUNT; c++) {
+    SlabClass& cls = slabClasses[c];
+    if (bytes > cls.blockSize) continue;
+
+    uint16_t block = popIndex(cls.freeList);
+    if (block == POOL_NIL) continue;
+
+    if (c > 0 && bytes <= slabClasses[c - 1].blockSize) {
+      cls.spills.fetch_add(1, std::memory_order_relaxed);
+    }
+    cls.allocs.fetch_add(1, std::memory_order_relaxed);
+    noteHighWater(cls.highWater, cls.inUse.fetch_add(1, std::memory_order_relaxed) + 1);
+    *out = slabArena + cls.arenaOffset + (uint32_t)(block - cls.firstBlock) * cls.blockSize;
+    return c;
+  }
+  return 0xFF;
+}
+
+static void freeBlock(uint8_t c, char* payload) {
+  SlabClass& cls = slabClasses[c];
+  uint16_t block = cls.firstBlock + (uint16_t)((payload - slabArena - cls.arenaOffset) / cls.blockSize);
+  cls.inUse.fetch_sub(1, std::memory_order_relaxed);
+  pushIndex(cls.freeList, block);
+}
+
+static ExecMessage* initHeader(uint16_t index, char* payload, uint8_t slabClass, ExecLane lane) {
+  ExecMessage* msg = &msgPool[index];
+  msg->payload = payload;
+  msg->payload[0] = '\0';
+  msg->slabClass = slabClass;
+  msg->inUse = true;
+  msg->length = 0;
+  msg->lane = lane;
+  return msg;
+}
+
+void msgPoolInit() {
+  controlStack.head.store(POOL_NIL, std::memory_order_relaxed);
+  bulkStack.head.store(POOL_NIL, std::memory_order_relaxed);
+  for (int i = MSG_POOL_SIZE - 1; i >= 0; i--) {
+    msgPool[i].inUse = false;
+    msgPool[i].length = 0;
+    msgPool[i].payload = nullptr;
+    pushIndex(homeStack((uint16_t)i), (uint16_t)i);
+  }
+
+  for (int c = 0; c < MSG_SLAB_CLASS_COUNT; c++) {
+    SlabClass& cls = slabClasses[c];
+    cls.freeList.head.store(POOL_NIL, std::memory_order_relaxed);
+    for (int b = cls.blockCount - 1; b >= 0; b--) {
+      pushIndex(cls.freeList, (uint16_t)(cls.firstBlock + b));
+    }
+    cls.inUse.store(0, std::memory_order_relaxed);
+    cls.highWater.store(0, std::memory_order_relaxed);
+    cls.allocs.store(0, std::memory_order_relaxed);
+    cls.spills.store(0, std::memory_order_relaxed);
+  }
+
+  poolInUse.store(0, std::memory_order_relaxed);
+  poolHighWater.store(0, std::memory_order_relaxed);
+  poolAllocs.store(0, std::memory_order_relaxed);
+  poolExhausted.store(0, std::memory_order_relaxed);
+  poolExhaustLogged.store(false, std::memory_order_relaxed);
+}
+
+ExecMessage* allocMessage(ExecLane lane, size_t payloadLen) {
+  if (payloadLen >= MAX_MSG_SIZE) return nullptr;
+
+  /* Control traffic uses its reserved slots first and may borrow from bulk; bulk never borrows */
+  uint16_t index = POOL_NIL;
+  if (lane == EXEC_LANE_CONTROL) index = popIndex(controlStack);
+  if (index == POOL_NIL) index = popIndex(bulkStack);
+  if (index == POOL_NIL) {
+    noteExhausted();
+    return nullptr;
+  }
+
+  char* payload = nullptr;
+  uint8_t slabClass = allocBlock(payloadLen + 1, &payload);
+  if (slabClass == 0xFF) {
+    pushIndex(homeStack(index), index);
+    noteExhausted();
+    return nullptr;
+  }
+
+  poolAllocs.fetch_add(1, std::memory_order_relaxed);
+  noteHighWater(poolHighWater, poolInUse.fetch_add(1, std::memory_order_relaxed) + 1);
+  return initHeader(index, payload, slabClass, lane);
+}
+
+bool allocMessageBatch(ExecMessage** out, const uint16_t* payloadLens, uint8_t count) {
+  if (count == 0 || count > MSG_POOL_SIZE - MSG_POOL_CONTROL_SLOTS) return false;
+  for (uint8_t i = 0; i < count; i++) {
+    if (payloadLens[i] >= MAX_MSG_SIZE) return false;
+  }
+
+  /* Batches are bulk traffic; they never dip into the control reservation */
+  uint16_t indices[MSG_POOL_SIZE];
+  if (!popIndices(bulkStack, indices, count)) {
+    noteExhausted();
+    return false;
+  }
+
+  char* payloads[MSG_POOL_SIZE];
+  uint8_t classes[MSG_POOL_SIZE];
+  for (uint8_t i = 0; i < count; i++) {
+    classes[i] = allocBlock(payloadLens[i] + 1, &payloads[i]);
+    if (classes[i] == 0xFF) {
+      /* Roll back everything taken so far; the caller sees the batch as never reserved */
+      for (uint8_t j = 0; j < i; j++) freeBlock(classes[j], payloads[j]);
+      for (uint8_t j = 0; j < count; j++) pushIndex(bulkStack, indices[j]);
+      noteExhausted();
+      return false;
+    }
+  }
+
+  poolAllocs.fetch_add(count, std::memory_order_relaxed);
+  noteHighWater(poolHighWater, poolInUse.fetch_add(count, std::memory_order_relaxed) + count);
+  for (uint8_t i = 0; i < count; i++) {
+    out[i] = initHeader(indices[i], payloads[i], classes[i], EXEC_LANE_BULK);
+  }
+  return true;
+}
+
+void freeMessage(ExecMessage* msg) {
+  if (!msg) return;
+
+  ptrdiff_t index = msg - msgPool;
+  if (index < 0 || index >= MSG_POOL_SIZE || !msg->inUse) {
+    LOG_ERROR(EVT_MSG_POOL_BAD_FREE);
+    return;
+  }
+
+  freeBlock(msg->slabClass, msg->payload);
+  msg->payload = nullptr;
+  msg->inUse = false;
+  msg->length = 0;
+  poolInUse.fetch_sub(1, std::memory_order_relaxed);
+  pushIndex(homeStack((uint16_t)index), (uint16_t)index);
+  poolExhaustLogged.store(false, std::memory_order_relaxed);
+}
+
+size_t msgPayloadCapacity(const ExecMessage* msg) {
+  return (msg && msg->inUse) ? slabClasses[msg->slabClass].blockSize : 0;
+}
+
+void getMsgPoolStats(MsgPoolStats& out) {
+  out.capacity = MSG_POOL_SIZE;
+  out.controlReserved = MSG_POOL_CONTROL_SLOTS;
+  out.inUse = (uint16_t)poolInUse.load(std::memory_order_relaxed);
+  out.highWater = (uint16_t)poolHighWater.load(std::memory_order_relaxed);
+  out.allocs = poolAllocs.load(std::memory_order_relaxed);
+  out.exhausted = poolExhausted.load(std::memory_order_relaxed);
+}
+
+void getMsgSlabStats(uint8_t slabClass, MsgSlabStats& out) {
+  const SlabClass& cls = slabClasses[slabClass < MSG_SLAB_CLASS_COUNT ? slabClass : 0];
+  out.blockSize = cls.blockSize;
+  out.blocks = cls.blockCount;
+  out.inUse = (uint16_t)cls.inUse.load(std::memory_order_relaxed);
+  out.highWater = (uint16_t)cls.highWater.load(std::memory_order_relaxed);
+  out.allocs = cls.allocs.load(std::memory_order_relaxed);
+  out.spills = cls.spills.load(std::memory_order_relaxed);
+}
@@ -0,0 +1,40 @@
+/* ==============================================================================
+   MSG_POOL.H - Lock-Free Message Pool Interface
+
+   Provides the pre-allocated ExecMessage pool used for inter-task commands:
+   - O(1) allocation and release without mutexes or blocking
+   - Payloads carved from size-class slabs so short commands stay small
+   - Safe to call concurrently from any task on either core
+   - Slots reserved for the control lane so bulk floods cannot starve it
+   - Exhaustion and high-water counters for diagnostics
+
+   The pool never touches the heap; headers live in msgPool[] and payloads
+   in a static slab arena.
+   ============================================================================== */
+
+/* Header guard to prevent multiple inclusion of msg_pool.h */
+#ifndef MSG_POOL_H
+#define MSG_POOL_H
+
+#include <Arduino.h>
+#include "types.h"
+
+#define MSG_SLAB_CLASS_COUNT 3
+
+void msgPoolInit();
+
+/* payloadLen excludes the terminator and must be below MAX_MSG_SIZE */
+ExecMessage* allocMessage(ExecLane lane, size_t payloadLen);
+
+/* All-or-nothing reservation of count bulk messages; nothing is held on failure */
+bool allocMessageBatch(ExecMessage** out, const uint16_t* payloadLens, uint8_t count);
+
+void freeMessage(ExecMessage* msg);
+
+size_t msgPayloadCapacity(const ExecMessage* msg);
+
+void getMsgPoolStats(MsgPoolStats& out);
+
+void getMsgSlabStats(uint8_t slabClass, MsgSlabStats& out);
+
+#endif
@@ -0,0 +1,258 @@
+/* ==============================================================================
+   OPENMETRICS.CPP - Prometheus/OpenMetrics Scrape Endpoint Implementation
+
+   Metric families are emitted in a fixed order, each as its # TYPE/# HELP
+   header followed by its samples. Counters carry the _total suffix on the
+   sample, not on the family name, as OpenMetrics requires. Task names are
+   escaped as they are written into a label value.
+
+   While an OTA update runs only the cheap families are reported (no task
+   snapshot copy, no pool walk), mirroring the reduced /api/status.
+   ============================================================================== */
+
+#include "openmetrics.h"
+
+#if ENABLE_OPENMETRICS
+
+#include "globals.h"
+#include "web_handler.h"
+#include "hardware.h"
+#include "msg_pool.h"
+#include "exec_queue.h"
+#include <esp_timer.h>
+
+#if DEBUG_MODE
+#include "debug_handler.h"
+#endif
+
+#if ENABLE_TASK_TOP
+#include "cpu_monitor.h"
+#endif
+
+#if ENABLE_HEAP_TRACK
+#include "heap_tracker.h"
+#endif
+
+#define OPENMETRICS_CONTENT_TYPE "application/openmetrics-text; version=1.0.0; charset=utf-8"
+
+static void family(ChunkWriter& out, const char* name, const char* type, const char* help) {
+  out.printf("# TYPE %s %s\n", name, type);
+  out.printf("# HELP %s %s\n", name, help);
+}
+
+/* gauge: One family with a single unlabelled sample */
+static void gauge(ChunkWriter& out, const char* name, const char* help, uint32_t value) {
+  family(out, name, "gauge", help);
+  out.printf("%s %u\n", name, value);
+}
+
+static void counter(ChunkWriter& out, const char* name, const char* help, uint32_t value) {
+  family(out, name, "counter", help);
+  out.printf("%s_total %u\n", name, value);
+}
+
+/* taskSeries: Starts a sample as name{task="..." with the task name escaped on the way out,
+   since label values may not contain raw quotes, backslashes or newlines */
+static void taskSeries(ChunkWriter& out, const char* name, const char* task) {
+  out.printf("%s{task=\"", name);
+  for (; *task; task++) {
+    if (*task == '"' || *task == '\\') {
+      char esc[2] = { '\\', *task };
+      out.write(esc, 2);
+    } else if (*task == '\n') {
+      out.write("\\n", 2);
+    } else {
+      out.write(task, 1);
+    }
+  }
+  out.write("\"", 1);
+}
+
+static void writeSystem(ChunkWriter& out) {
+  family(out, "esp_uptime_seconds", "gauge", "Time since boot");
+  out.printf("esp_uptime_seconds %.3f\n", esp_timer_get_time() / 1000000.0);
+
+  gauge(out, "esp_heap_free_bytes", "Free internal heap", ESP.getFreeHeap());
+  gauge(out, "esp_heap_min_free_bytes", "Lowest free internal heap since boot", ESP.getMinFreeHeap());
+  gauge(out, "esp_heap_max_alloc_bytes", "Largest allocatable heap block", ESP.getMaxAllocHeap());
+  gauge(out, "esp_heap_size_bytes", "Total internal heap", ESP.getHeapSize());
+  if (ESP.getPsramSize() > 0) {
+    gauge(out, "esp_psram_free_bytes", "Free PSRAM", ESP.getFreePsram());
+  }
+
+  family(out, "esp_core_load_percent", "gauge", "Core load over the last stats sample");
+  for (uint8_t c = 0; c < NUM_CORES; c++) {
+    out.printf("esp_core_load_percent{core=\"%u\"} %u\n", c, coreLoadPct[c]);
+  }
+}
+
+#if ENABLE_HEAP_TRACK
+static void writeHeapTags(ChunkWriter& out) {
+  HeapTagTotals totals[HEAP_TAG_COUNT];
+  getHeapTagTotals(totals);
+
+  family(out, "esp_heap_tag_live_bytes", "gauge", "Heap held per subsystem tag");
+  for (uint8_t t = 0; t < HEAP_TAG_COUNT; t++) {
+    out.printf("esp_heap_tag_live_bytes{tag=\"%s\"} %u\n", heapTagName((HeapTag)t), totals[t].live);
+  }
+  family(out, "esp_heap_tag_allocations", "counter", "Tracked allocations per subsystem tag");
+  for (uint8_t t = 0; t < HEAP_TAG_COUNT; t++) {
+    out.printf("esp_heap_tag_allocations_total{tag=\"%s\"} %u\n", heapTagName((HeapTag)t), totals[t].allocs);
+  }
+  family(out, "esp_heap_tag_alloc_failures", "counter", "Failed tracked allocations per subsystem tag");
+  for (uint8_t t = 0; t < HEAP_TAG_COUNT; t++) {
+    out.printf("esp_heap_tag_alloc_failures_total{tag=\"%s\"} %u\n", heapTagName((HeapTag)t), totals[t].failed);
+  }
+}
+#endif
+
+static void writeNetwork(ChunkWriter& out) {
+  bool connected = (WiFi.status() == WL_CONNECTED);
+  gauge(out, "esp_wifi_connected", "1 while associated to an access point", connected ? 1 : 0);
+  if (connected) {
+    family(out, "esp_wifi_rssi_dbm", "gauge", "Received signal strength");
+    out.printf("esp_wifi_rssi_dbm %d\n", (int)WiFi.RSSI());
+  }
+  gauge(out, "esp_wifi_reconnect_attempts", "Reconnect attempts since the last successful connect",
+        wifiReconnectAttempts);
+}
+
+static void writeOta(ChunkWriter& out) {
+#if ENABLE_OTA
+  static const char* const stateNames[] = { "idle", "checking", "downloading", "flashing", "success", "failed" };
+  OTAState state = otaStatus.state;
+  family(out, "esp_ota_state", "stateset", "Firmware update state");
+  for (uint8_t s = 0; s < sizeof(stateNames) / sizeof(stateNames[0]); s++) {
+    out.printf("esp_ota_state{esp_ota_state=\"%s\"} %u\n", stateNames[s], state == s ? 1 : 0);
+  }
+  gauge(out, "esp_ota_progress_percent", "Progress of the running update", otaStatus.progress);
+#else
+  (void)out;
+#endif
+}
+
+static void writeExec(ChunkWriter& out) {
+  gauge(out, "esp_biz_running", "1 while business logic is started", gBizState == BIZ_RUNNING ? 1 : 0);
+  counter(out, "esp_biz_processed", "Commands processed by all biz workers", bizProcessed);
+  gauge(out, "esp_biz_commands_per_second", "Biz throughput over the last second", bizCmdRate);
+
+  ExecLaneStats lanes[EXEC_LANE_COUNT];
+  for (int l = 0; l < EXEC_LANE_COUNT; l++) getExecLaneStats((ExecLane)l, lanes[l]);
+
+  family(out, "esp_exec_queue_depth", "gauge", "Commands waiting in the lane");
+  for (int l = 0; l < EXEC_LANE_COUNT; l++) {
+    out.printf("esp_exec_queue_depth{lane=\"%s\"} %u\n", execLaneName((ExecLane)l), lanes[l].depth);
+  }
+  family(out, "esp_exec_enqueued", "counter", "Commands accepted into the lane");
+  for (int l = 0; l < EXEC_LANE_COUNT; l++) {
+    out.printf("esp_exec_enqueued_total{lane=\"%s\"} %u\n", execLaneName((ExecLane)l), lanes[l].enqueued);
+  }
+  family(out, "esp_exec_dropped", "counter", "Commands rejected because the lane was full");
+  for (int l = 0; l < EXEC_LANE_COUNT; l++) {
+    out.printf("esp_exec_dropped_total{lane=\"%s\"} %u\n", execLaneName((ExecLane)l), lanes[l].dropped);
+  }
+  family(out, "esp_exec_wait_max_microseconds", "gauge", "Longest queue wait seen in the lane");
+  for (int l = 0; l < EXEC_LANE_COUNT; l++) {
+    out.printf("esp_exec_wait_max_microseconds{lane=\"%s\"} %u\n", execLaneName((ExecLane)l), lanes[l].waitMaxUs);
+  }
+
+  MsgPoolStats pool;
+  getMsgPoolStats(pool);
+  gauge(out, "esp_msg_pool_in_use", "Message headers currently allocated", pool.inUse);
+  gauge(out, "esp_msg_pool_high_water", "Most message headers ever allocated at once", pool.highWater);
+  counter(out, "esp_msg_pool_exhausted", "Allocations refused because the pool was empty", pool.exhausted);
+}
+
+#if DEBUG_MODE
+static void writeTasks(ChunkWriter& out) {
+  TaskStatsSnapshot& snap = webTaskSnapshot();
+  if (!getTaskStatsSnapshot(snap)) return;
+
+  family(out, "esp_task_cpu_percent", "gauge", "Task CPU share over the last stats sample");
+  for (uint8_t i = 0; i < snap.taskCount; i++) {
+    const TaskMonitorData& t = snap.tasks[i];
+    if (t.state == eDeleted) continue;
+    taskSeries(out, "esp_task_cpu_percent", t.name);
+    if (t.coreAffinity == tskNO_AFFINITY) {
+      out.printf(",core=\"any\"} %u\n", t.cpuPercent);
+    } else {
+      out.printf(",core=\"%d\"} %u\n", (int)t.coreAffinity, t.cpuPercent);
+    }
+  }
+  family(out, "esp_task_stack_free_min_bytes", "gauge", "Stack high-water mark (least free stack seen)");
+  for (uint8_t i = 0; i < snap.taskCount; i++) {
+    if (snap.tasks[i].state == eDeleted) continue;
+    taskSeries(out, "esp_task_stack_free_min_bytes", snap.tasks[i].name);
+    out.printf("} %u\n", snap.tasks[i].stackHighWater);
+  }
+  family(out, "esp_task_runtime_seconds", "counter", "Task run time since it was first seen");
+  for (uint8_t i = 0; i < snap.taskCount; i++) {
+    if (snap.tasks[i].state == eDeleted) continue;
+    taskSeries(out, "esp_task_runtime_seconds_total", snap.tasks[i].name);
+    out.printf("} %.3f\n", snap.tasks[i].runtimeAccumUs / 1000000.0);
+  }
+  gauge(out, "esp_stats_sample_age_milliseconds", "Age of the task sample above", millis() - snap.sampleMs);
+}
+
+static void writeLogs(ChunkWriter& out) {
+  LogCounters logs;
+  getLogCounters(logs);
+  family(out, "esp_log_entries", "counter", "Debug log entries written since boot");
+  out.printf("esp_log_entries_total{log=\"error\"} %u\n", logs.error);
+  out.printf("esp_log_entries_total{log=\"wifi\"} %u\n", logs.wifi);
+  out.printf("esp_log_entries_total{log=\"reboot\"} %u\n", logs.reboot);
+  counter(out, "esp_log_dropped", "Debug log entries dropped because the ring lapped a writer", logs.dropped);
+}
+#endif
+
+#if ENABLE_TASK_TOP
+/* writeTaskTop: Production builds only know the busiest tasks, so only those get a series */
+static void writeTaskTop(ChunkWriter& out) {
+  TaskTopEntry top[TASK_TOP_N];
+  uint8_t count = getTaskTop(top, TASK_TOP_N);
+
+  family(out, "esp_task_cpu_percent", "gauge", "Task CPU share over the last stats sample (busiest tasks only)");
+  for (uint8_t i = 0; i < count; i++) {
+    taskSeries(out, "esp_task_cpu_percent", top[i].name);
+    if (top[i].core == tskNO_AFFINITY) {
+      out.printf(",core=\"any\"} %u\n", top[i].cpuPercent);
+    } else {
+      out.printf(",core=\"%d\"} %u\n", (int)top[i].core, top[i].cpuPercent);
+    }
+  }
+}
+#endif
+
+void registerOpenMetricsRoutes() {
+  server.on("/metrics", HTTP_GET, handleOpenMetrics);
+}
+
+void handleOpenMetrics() {
+  bool otaActive = isOtaActive();
+
+  server.setContentLength(CONTENT_LENGTH_UNKNOWN);
+  server.send(200, OPENMETRICS_CONTENT_TYPE, "");
+
+  ChunkWriter out;
+  writeSystem(out);
+#if ENABLE_HEAP_TRACK
+  writeHeapTags(out);
+#endif
+  writeNetwork(out);
+  writeOta(out);
+  if (!otaActive) {
+    writeExec(out);
+#if DEBUG_MODE
+    writeTasks(out);
+#elif ENABLE_TASK_TOP
+    writeTaskTop(out);
+#endif
+  }
+#if DEBUG_MODE
+  writeLogs(out);
+#endif
+  out.printf("# EOF\n");
+  out.end();
+}
+
+#endif
@@ -0,0 +1,36 @@
+/* ==============================================================================
+   OPENMETRICS.H - Prometheus/OpenMetrics Scrape Endpoint Interface
+
+   GET /metrics returns the device state in OpenMetrics text format
+   (application/openmetrics-text; Prometheus scrapes it as-is):
+   - Uptime, heap (free, minimum free, largest block), PSRAM, heap per
+     subsystem tag (ENABLE_HEAP_TRACK)
+   - Core load and, in DEBUG_MODE, per-task CPU%, stack headroom, run time
+     (without DEBUG_MODE, CPU% of the ENABLE_TASK_TOP busiest tasks)
+   - Exec lane depth/enqueued/dropped, message pool usage, biz throughput
+   - WiFi link state and RSSI, OTA state
+   - Log entries since boot per type (DEBUG_MODE)
+
+   The body is written straight from the live counters through a ChunkWriter,
+   so a scrape allocates no JSON document and no String.
+
+   Compiled only with ENABLE_OPENMETRICS.
+   ============================================================================== */
+
+/* Header guard to prevent multiple inclusion of openmetrics.h */
+#ifndef OPENMETRICS_H
+#define OPENMETRICS_H
+
+#include "config.h"
+
+#if ENABLE_OPENMETRICS
+
+#include <Arduino.h>
+
+void registerOpenMetricsRoutes();
+
+void handleOpenMetrics();
+
+#endif
+
+#endif
@@ -20,7 +20,10 @@
 #include "globals.h"
 #include "web_handler.h"
 #include "debug_handler.h"
+#include "stack_monitor.h"
 #include "tasks.h"
+#include "trace.h"
+#include "heap_tracker.h"
 #include <Update.h>
 #include <esp_ota_ops.h>
 #include <WiFiClientSecure.h>
@@ -40,7 +43,7 @@ void dumpPartitionInfo(String& logOutput) {
   esp_partition_iterator_t it = esp_partition_find(ESP_PARTITION_TYPE_ANY, ESP_PARTITION_SUBTYPE_ANY, NULL);
   if (!it) {
     logOutput += "Failed to find partitions!\n";
-    LOG_ERROR(F("Partition iteration failed"), millis() / 1000);
+    LOG_ERROR(EVT_OTA_PARTITION_ITER);
     return;
   }
 
@@ -69,7 +72,7 @@ void dumpPartitionInfo(String& logOutput) {
     logOutput += buf;
   } else {
     logOutput += "Next OTA Partition: NOT FOUND!\n";
-    LOG_ERROR(F("No OTA partition available"), millis() / 1000);
+    LOG_ERROR(EVT_OTA_NO_PARTITION);
   }
 }
 
@@ -78,27 +81,42 @@ void deleteNonEssentialTasks() {
   /* Acquire taskDeletionMutex mutex (wait up to 500ms) to safely access shared resource */
     if (xSemaphoreTake(taskDeletionMutex, pdMS_TO_TICKS(500)) == pdTRUE) {
 
-    if (bizTaskHandle != NULL) {
-      Serial.println(F("\n=== Stopping bizTask for OTA ==="));
+    bool anyWorker = false;
+    for (uint8_t i = 0; i < BIZ_WORKERS; i++) {
+      if (bizTaskHandles[i] != NULL) anyWorker = true;
+    }
+
+    if (anyWorker) {
+      Serial.println(F("\n=== Stopping biz workers for OTA ==="));
       gBizState = BIZ_STOPPED;
       vTaskDelay(pdMS_TO_TICKS(200));
       bizTaskShouldExit = true;
 
+      /* Wake parked workers so they see the exit flag without waiting out their timeout */
+      for (uint8_t i = 0; i < BIZ_WORKERS; i++) {
+        if (bizTaskHandles[i] != NULL) xTaskNotifyGive(bizTaskHandles[i]);
+      }
+
       uint8_t waitCount = 0;
-      while (bizTaskHandle != NULL && waitCount < 30) {
+      while (anyWorker && waitCount < 30) {
         vTaskDelay(pdMS_TO_TICKS(100));
         waitCount++;
+        anyWorker = false;
+        for (uint8_t i = 0; i < BIZ_WORKERS; i++) {
+          if (bizTaskHandles[i] != NULL) anyWorker = true;
+        }
       }
 
-      if (bizTaskHandle != NULL) {
-        Serial.println(F("Warning: bizTask didn't exit gracefully, force deleting..."));
-        LOG_ERROR(F("bizTask force deleted (OTA)"), millis() / 1000);
-        vTaskDelete(bizTaskHandle);
-        bizTaskHandle = NULL;
-      } else {
-        Serial.println(F("bizTask exited gracefully"));
+      for (uint8_t i = 0; i < BIZ_WORKERS; i++) {
+        if (bizTaskHandles[i] != NULL) {
+          Serial.printf("Warning: biz%u didn't exit gracefully, force deleting...\n", i);
+          LOG_ERROR(EVT_OTA_BIZ_FORCE_DELETED, i);
+          vTaskDelete(bizTaskHandles[i]);
+          bizTaskHandles[i] = NULL;
+        }
       }
-      Serial.println(F("=== bizTask Deletion Complete ===\n"));
+      if (!anyWorker) Serial.println(F("biz workers exited gracefully"));
+      Serial.println(F("=== biz worker Deletion Complete ===\n"));
     }
 
     vTaskDelay(pdMS_TO_TICKS(200));
@@ -106,7 +124,7 @@ void deleteNonEssentialTasks() {
     tasksDeleted = true;
     xSemaphoreGive(taskDeletionMutex);
   } else {
-    LOG_ERROR(F("Failed to acquire taskDeletionMutex"), millis() / 1000);
+    LOG_ERROR(EVT_OTA_DELETION_MUTEX, "biz");
   }
 }
 
@@ -126,7 +144,7 @@ void deleteWebTask() {
 
       if (webTaskHandle != NULL) {
         Serial.println(F("Warning: webTask didn't exit gracefully, force deleting..."));
-        LOG_ERROR(F("webTask force deleted (OTA)"), millis() / 1000);
+        LOG_ERROR(EVT_OTA_WEB_FORCE_DELETED);
         vTaskDelete(webTaskHandle);
         webTaskHandle = NULL;
       } else {
@@ -136,7 +154,7 @@ void deleteWebTask() {
     }
     xSemaphoreGive(taskDeletionMutex);
   } else {
-    LOG_ERROR(F("Failed to acquire taskDeletionMutex (web)"), millis() / 1000);
+    LOG_ERROR(EVT_OTA_DELETION_MUTEX, "web");
   }
 }
 
@@ -150,33 +168,27 @@ void recreateTasks() {
     webTaskShouldExit = false;
     bizTaskShouldExit = false;
 
-    if (bizTaskHandle == NULL) {
-      Serial.println(F("Creating bizTask..."));
-      #if NUM_CORES > 1
-      BaseType_t result = xTaskCreatePinnedToCore(bizTask, "biz", 4096, nullptr, 1, &bizTaskHandle, 1);
-      #else
-      BaseType_t result = xTaskCreate(bizTask, "biz", 4096, nullptr, 1, &bizTaskHandle);
-      #endif
-      if (result == pdPASS) {
-        Serial.println(F("bizTask created"));
-      } else {
-        Serial.println(F("FAILED to create bizTask!"));
-        LOG_ERROR(F("Failed to recreate bizTask"), millis() / 1000);
-      }
+    Serial.println(F("Creating biz workers..."));
+    uint8_t workers = startBizWorkers();
+    if (workers == BIZ_WORKERS) {
+      Serial.printf("%u biz workers running\n", workers);
+    } else {
+      Serial.printf("FAILED to create biz workers (%u of %u running)!\n", workers, BIZ_WORKERS);
+      LOG_ERROR(EVT_OTA_RECREATE_BIZ_FAILED);
     }
 
     if (webTaskHandle == NULL) {
       Serial.println(F("Creating webTask..."));
       #if NUM_CORES > 1
-      BaseType_t result = xTaskCreatePinnedToCore(webTask, "web", 8192, nullptr, 1, &webTaskHandle, 0);
+      BaseType_t result = xTaskCreatePinnedToCore(webTask, "web", WEB_TASK_STACK, nullptr, 1, &webTaskHandle, 0);
       #else
-      BaseType_t result = xTaskCreate(webTask, "web", 8192, nullptr, 1, &webTaskHandle);
+      BaseType_t result = xTaskCreate(webTask, "web", WEB_TASK_STACK, nullptr, 1, &webTaskHandle);
       #endif
       if (result == pdPASS) {
         Serial.println(F("webTask created"));
       } else {
         Serial.println(F("FAILED to create webTask!"));
-        LOG_ERROR(F("Failed to recreate webTask"), millis() / 1000);
+        LOG_ERROR(EVT_OTA_RECREATE_WEB_FAILED);
       }
     }
 
@@ -186,7 +198,7 @@ void recreateTasks() {
     vTaskDelay(pdMS_TO_TICKS(500));
     Serial.println(F("=== Task Recreation Complete ===\n"));
   } else {
-    LOG_ERROR(F("Failed to acquire taskDeletionMutex (recreate)"), millis() / 1000);
+    LOG_ERROR(EVT_OTA_DELETION_MUTEX, "recreate");
   }
 }
 
@@ -198,7 +210,7 @@ void recreateTasks() {
 
 /* handleOTAStatus: API endpoint that returns current OTA update status and partition info */
 void handleOTAStatus() {
-  DynamicJsonDocument doc(512);
+  OtaJsonDocument doc(512);
 
   const esp_partition_t* ota_partition = esp_ota_get_next_update_partition(NULL);
   otaStatus.available = (ota_partition != NULL);
@@ -266,7 +278,7 @@ void handleOTAUpdate() {
 
   if (!server.hasArg("plain")) {
     server.send(400, F("application/json"), F("{\"err\":\"no body\"}"));
-    LOG_ERROR(F("OTA: No request body"), millis() / 1000);
+    LOG_ERROR(EVT_OTA_NO_BODY);
     return;
   }
 
@@ -274,20 +286,20 @@ void handleOTAUpdate() {
   DeserializationError error = deserializeJson(doc, server.arg("plain"));
   if (error) {
     server.send(400, F("application/json"), F("{\"err\":\"bad json\"}"));
-    LOG_ERROR(F("OTA: Bad JSON"), millis() / 1000);
+    LOG_ERROR(EVT_OTA_BAD_JSON);
     return;
   }
 
   const char* url = doc["url"] | "";
   if (strlen(url) == 0) {
     server.send(400, F("application/json"), F("{\"err\":\"url required\"}"));
-    LOG_ERROR(F("OTA: No URL provided"), millis() / 1000);
+    LOG_ERROR(EVT_OTA_NO_URL);
     return;
   }
 
   if (WiFi.status() != WL_CONNECTED) {
     server.send(503, F("application/json"), F("{\"err\":\"WiFi not connected\"}"));
-    LOG_ERROR(F("OTA: WiFi not connected"), millis() / 1000);
+    LOG_ERROR(EVT_OTA_WIFI_NOT_CONNECTED);
     return;
   }
 
@@ -296,7 +308,7 @@ void handleOTAUpdate() {
     if (otaStatus.state != OTA_IDLE) {
       xSemaphoreGive(otaMutex);
       server.send(409, F("application/json"), F("{\"err\":\"update in progress\"}"));
-      LOG_ERROR(F("OTA: Already in progress"), millis() / 1000);
+      LOG_ERROR(EVT_OTA_BUSY);
       return;
     }
     otaStatus.state = OTA_CHECKING;
@@ -317,6 +329,7 @@ void handleOTAUpdate() {
   #if ESP32_HAS_BLE
   Serial.println(F("Deinitializing BLE..."));
   NimBLEDevice::deinit();
+  heapTrackSetFootprint(HEAP_TAG_BLE, 0);
   vTaskDelay(pdMS_TO_TICKS(200));
   Serial.printf("After BLE deinit: %u bytes\n", ESP.getFreeHeap());
   #endif
@@ -329,13 +342,13 @@ void handleOTAUpdate() {
 
   otaInProgress = true;
 
-  String* otaUrlPtr = new String(url);
+  char* otaUrl = heapTrackStrdup(HEAP_TAG_OTA, url);
 
   uint32_t freeHeap = ESP.getFreeHeap();
   Serial.printf("Final Free Heap: %u bytes\n", freeHeap);
   Serial.println(F("=== Cleanup Complete ===\n"));
 
-  if (freeHeap < 35000) {
+  if (!otaUrl || freeHeap < 35000) {
     Serial.println(F("ERROR: Insufficient memory for OTA!"));
     /* Acquire otaMutex mutex (wait up to 100ms) to safely access shared resource */
     if (xSemaphoreTake(otaMutex, pdMS_TO_TICKS(100)) == pdTRUE) {
@@ -343,8 +356,8 @@ void handleOTAUpdate() {
       otaStatus.error = F("Insufficient memory");
       xSemaphoreGive(otaMutex);
     }
-    LOG_ERROR(F("OTA: Insufficient memory"), millis() / 1000);
-    delete otaUrlPtr;
+    LOG_ERROR(EVT_OTA_NO_MEMORY);
+    heapTrackFree(otaUrl);
     
 
     otaInProgress = false;
@@ -355,8 +368,8 @@ void handleOTAUpdate() {
   BaseType_t taskCreated = xTaskCreate(
     otaTaskFunction,
     "ota_task",
-    20480,
-    (void*)otaUrlPtr,
+    OTA_TASK_STACK,
+    (void*)otaUrl,
     3,
     NULL
   );
@@ -370,9 +383,9 @@ void handleOTAUpdate() {
       otaStatus.error = F("Task creation failed");
       xSemaphoreGive(otaMutex);
     }
-    LOG_ERROR(F("OTA: Task creation failed"), millis() / 1000);
+    LOG_ERROR(EVT_OTA_TASK_FAILED);
 
-    delete otaUrlPtr;
+    heapTrackFree(otaUrl);
   }
 }
 
@@ -394,9 +407,9 @@ static void otaTaskFunction(void* param) {
   esp_task_wdt_add(NULL);
   esp_task_wdt_reset();
 
-  String* urlPtr = (String*)param;
-  String url = *urlPtr;
-  delete urlPtr;
+  char* urlCopy = (char*)param;
+  String url = urlCopy;
+  heapTrackFree(urlCopy);
 
 Serial.println(F("\n==========================================="));
 Serial.println(F("         OTA UPDATE STARTED"));
@@ -489,7 +502,7 @@ Serial.println(F("==========================================="));
 
     String newLocation = httpClient.getLocation();
     Serial.printf("Redirect %d to: %s\n", httpCode, newLocation.c_str());
-    LOG_ERROR(String("OTA: Redirect ") + httpCode, millis() / 1000);
+    LOG_ERROR(EVT_OTA_REDIRECT, httpCode);
 
     httpClient.end();
     if (isSecure) clientSecure.stop(); else client.stop();
@@ -551,7 +564,7 @@ Serial.println(F("==========================================="));
       otaStatus.error = errStr;
       xSemaphoreGive(otaMutex);
     }
-    LOG_ERROR(String("OTA: ") + errStr, millis() / 1000);
+    LOG_ERROR(EVT_OTA_HTTP_ERROR, httpCode);
 
     otaInProgress = false;
     httpClient.end();
@@ -573,7 +586,7 @@ Serial.println(F("==========================================="));
       otaStatus.error = msg;
       xSemaphoreGive(otaMutex);
     }
-    LOG_ERROR(String("OTA: ") + msg, millis() / 1000);
+    LOG_ERROR(EVT_OTA_BAD_LENGTH);
 
     otaInProgress = false;
     httpClient.end();
@@ -606,7 +619,7 @@ Serial.println(F("==========================================="));
       otaStatus.error = msg;
       xSemaphoreGive(otaMutex);
     }
-    LOG_ERROR(String("OTA: ") + msg, millis() / 1000);
+    LOG_ERROR(EVT_OTA_NO_PARTITION);
 
     otaInProgress = false;
     httpClient.end();
@@ -630,7 +643,7 @@ Serial.println(F("==========================================="));
       otaStatus.error = errStr;
       xSemaphoreGive(otaMutex);
     }
-    LOG_ERROR(String("OTA: ") + errStr, millis() / 1000);
+    LOG_ERROR(EVT_OTA_TOO_LARGE, contentLength, update_partition->size);
 
     otaInProgress = false;
     httpClient.end();
@@ -661,7 +674,7 @@ Serial.println(F("==========================================="));
       otaStatus.error = errStr;
       xSemaphoreGive(otaMutex);
     }
-    LOG_ERROR(String("OTA: ") + errStr, millis() / 1000);
+    LOG_ERROR(EVT_OTA_BEGIN_FAILED, Update.getError());
 
     otaInProgress = false;
     httpClient.end();
@@ -700,7 +713,7 @@ Serial.println(F("==========================================="));
         otaStatus.error = msg;
         xSemaphoreGive(otaMutex);
       }
-      LOG_ERROR(String("OTA: ") + msg, millis() / 1000);
+      LOG_ERROR(EVT_OTA_WIFI_LOST);
 
       Update.abort();
       otaInProgress = false;
@@ -718,7 +731,10 @@ Serial.println(F("==========================================="));
 
       if (len > 0) {
         /* Write downloaded chunk to flash - must write exactly len bytes */
-        if (Update.write(buff, len) != (size_t)len) {
+        TRACE_BEGIN(TRACE_OTA_WRITE);
+        size_t flashed = Update.write(buff, len);
+        TRACE_END(TRACE_OTA_WRITE);
+        if (flashed != (size_t)len) {
           char errStr[128];
           snprintf(errStr, sizeof(errStr),
                    "Write failed at %u/%d! Error: %u",
@@ -731,7 +747,7 @@ Serial.println(F("==========================================="));
             otaStatus.error = errStr;
             xSemaphoreGive(otaMutex);
           }
-          LOG_ERROR(String("OTA: ") + errStr, millis() / 1000);
+          LOG_ERROR(EVT_OTA_WRITE_FAILED, written, Update.getError());
 
           Update.abort();
           otaInProgress = false;
@@ -797,7 +813,7 @@ Serial.println(F("==========================================="));
       otaStatus.error = errStr;
       xSemaphoreGive(otaMutex);
     }
-    LOG_ERROR(String("OTA: ") + errStr, millis() / 1000);
+    LOG_ERROR(EVT_OTA_END_FAILED, Update.getError());
 
     otaInProgress = false;
     esp_wifi_set_ps(WIFI_PS_MIN_MODEM);
@@ -817,7 +833,7 @@ Serial.println(F("==========================================="));
       otaStatus.error = msg;
       xSemaphoreGive(otaMutex);
     }
-    LOG_ERROR(String("OTA: ") + msg, millis() / 1000);
+    LOG_ERROR(EVT_OTA_INCOMPLETE);
 
     otaInProgress = false;
     esp_wifi_set_ps(WIFI_PS_MIN_MODEM);
@@ -844,6 +860,7 @@ Serial.println(F("==========================================="));
   vTaskDelay(pdMS_TO_TICKS(2000));
 
   #if DEBUG_MODE
+  stackMonitorSaveOtaPeak();
   prefs.putBool("userRebootRequested", true);
   #endif
   ESP.restart();  /* Reboot to boot from newly flashed partition */
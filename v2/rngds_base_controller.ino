@@ -31,9 +31,11 @@
 #include "ble_handler.h"
 #include "web_handler.h"
 #include "tasks.h"
+#include "exec_queue.h"
 
 #if DEBUG_MODE
   #include "debug_handler.h"
+  #include "stack_monitor.h"
 #endif
 
 #if ENABLE_OTA
@@ -52,8 +54,10 @@ void configureTimerForRunTimeStats(void) {
   runtimeOffsetUs = esp_timer_get_time();
 }
 
+/* 1us resolution; the 32-bit value wraps every ~71 minutes, which the monitor
+   absorbs by taking modular deltas every sample into 64-bit totals */
 uint32_t ulGetRunTimeCounterValue(void) {
-  return (uint32_t)((esp_timer_get_time() - runtimeOffsetUs) / 100ULL);
+  return (uint32_t)(esp_timer_get_time() - runtimeOffsetUs);
 }
 
 /* setup: Arduino entry point - initializes all system components in correct order */
@@ -96,6 +100,7 @@ void setup() {
 
 #if DEBUG_MODE
   loadDebugLogs();
+  stackMonitorInit();
 
   esp_reset_reason_t reason = esp_reset_reason();
   Serial.printf("Boot: Reset reason = %d (%s)\n", (int)reason, formatResetReason(reason).c_str());
@@ -109,9 +114,9 @@ void setup() {
     if (reason != ESP_RST_POWERON && 
         reason != ESP_RST_DEEPSLEEP && 
         reason != ESP_RST_UNKNOWN) {
-      String msg = "Unexpected reboot: " + formatResetReason(reason);
-      addRebootLog(msg, 0);
-      Serial.printf("Boot: %s (logged)\n", msg.c_str());
+      String reasonName = formatResetReason(reason);
+      LOG_REBOOT(EVT_UNEXPECTED_REBOOT, reasonName);
+      Serial.printf("Boot: Unexpected reboot: %s (logged)\n", reasonName.c_str());
     } else {
       Serial.println(F("Boot: Normal boot (not logged)"));
     }
@@ -146,10 +151,10 @@ void setup() {
 #if DEBUG_MODE
 
   flashWriteQueue = xQueueCreate(FLASH_WRITE_QUEUE_SIZE, sizeof(FlashWriteRequest));
-  xTaskCreate(flashWriteTask, "flash", 3072, nullptr, 0, &flashWriteTaskHandle);
+  xTaskCreate(flashWriteTask, "flash", FLASH_TASK_STACK, nullptr, 0, &flashWriteTaskHandle);
 #endif
 
-  execQ = xQueueCreate(MSG_POOL_SIZE, sizeof(ExecMessage*));
+  execQueueInit();
 
   registerRoutes();
   Serial.println(F("Routes registered"));
@@ -157,34 +162,25 @@ void setup() {
   Serial.printf("Heap after Phase 2: Free=%u Min=%u\n", 
                 ESP.getFreeHeap(), ESP.getMinFreeHeap());
 
-#if DEBUG_MODE
-
-  for (int c = 0; c < NUM_CORES; c++) {
-    coreRuntime[c].totalRuntime100ms = 0;
-    coreRuntime[c].prevTotalRuntime100ms = 0;
-    coreRuntime[c].taskCount = 0;
-    coreRuntime[c].cpuPercentTotal = 0;
-  }
-#endif
-
   Serial.println(F("Phase 2 complete\n"));
 
   Serial.println(F("Phase 3: Creating RTOS tasks..."));
 
-#if NUM_CORES > 1
-  xTaskCreatePinnedToCore(bizTask, "biz", 4096, nullptr, 1, &bizTaskHandle, 1);
+  startBizWorkers();
 
-  xTaskCreatePinnedToCore(webTask, "web", 10240, nullptr, 1, &webTaskHandle, 0);
+#if NUM_CORES > 1
+  xTaskCreatePinnedToCore(webTask, "web", WEB_TASK_STACK, nullptr, 1, &webTaskHandle, 0);
 
-  xTaskCreatePinnedToCore(systemTask, "sys", 12288, nullptr, 2, &sysTaskHandle, 0);
+  xTaskCreatePinnedToCore(systemTask, "sys", SYS_TASK_STACK, nullptr, 2, &sysTaskHandle, 0);
 #else
-  xTaskCreate(bizTask, "biz", 4096, nullptr, 1, &bizTaskHandle);
+  xTaskCreate(webTask, "web", WEB_TASK_STACK, nullptr, 1, &webTaskHandle);
 
-  xTaskCreate(webTask, "web", 10240, nullptr, 1, &webTaskHandle);
-
-  xTaskCreate(systemTask, "sys", 10240, nullptr, 2, &sysTaskHandle);
+  xTaskCreate(systemTask, "sys", SYS_TASK_STACK, nullptr, 2, &sysTaskHandle);
 #endif
 
+  /* Any core; the sampler must keep running whichever core is busy */
+  xTaskCreate(statsTask, "stats", STATS_TASK_STACK, nullptr, 1, &statsTaskHandle);
+
   delay(500);
 
   Serial.println(F("Phase 3 complete: Tasks running\n"));
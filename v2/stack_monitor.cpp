@@ -0,0 +1,308 @@
+/* ==============================================================================
+   STACK_MONITOR.CPP - Per-Task Stack Watermark Monitor Implementation
+
+   statsTask owns the per-task sample, so it also feeds this table, once per
+   STACK_CHECK_INTERVAL. The web task reads it one entry at a time under
+   stackMutex and streams the response, so neither side holds the lock for
+   long and no JSON document is built.
+
+   A FreeRTOS high-water mark only ever falls during a task's life, so the
+   trend is a list of the moments it fell: a task whose last entry is hours
+   old has settled, one still adding entries has not seen its worst case.
+   ============================================================================== */
+
+#include "stack_monitor.h"
+
+#if DEBUG_MODE
+
+#include "globals.h"
+#include "web_handler.h"
+#include "debug_handler.h"
+
+#define NVS_KEY_OTA_STACK "ota_stack_free"
+
+/* Below this many free bytes a task is critical whatever its size */
+#define STACK_CRITICAL_FREE_BYTES 256
+
+struct StackSizeEntry {
+  const char* name;
+  uint32_t bytes;
+  bool prefix;  /* Matches every task whose name starts with `name` (biz0, biz1, IDLE0...) */
+};
+
+/* Exact names first: the first match wins */
+static const StackSizeEntry stackSizes[] = {
+  { "web", WEB_TASK_STACK, false },
+  { "sys", SYS_TASK_STACK, false },
+  { "stats", STATS_TASK_STACK, false },
+  { "flash", FLASH_TASK_STACK, false },
+#if ENABLE_OTA
+  { "ota_task", OTA_TASK_STACK, false },
+#endif
+#if ENABLE_BENCH
+  { "bench", BENCH_TASK_STACK, false },
+#endif
+#ifdef CONFIG_ESP_TIMER_TASK_STACK_SIZE
+  { "esp_timer", CONFIG_ESP_TIMER_TASK_STACK_SIZE, false },
+#endif
+#ifdef CONFIG_FREERTOS_TIMER_TASK_STACK_DEPTH
+  { "Tmr Svc", CONFIG_FREERTOS_TIMER_TASK_STACK_DEPTH, false },
+#endif
+#ifdef CONFIG_LWIP_TCPIP_TASK_STACK_SIZE
+  { "tiT", CONFIG_LWIP_TCPIP_TASK_STACK_SIZE, false },
+#endif
+#ifdef CONFIG_ESP_SYSTEM_EVENT_TASK_STACK_SIZE
+  { "sys_evt", CONFIG_ESP_SYSTEM_EVENT_TASK_STACK_SIZE, false },
+#endif
+#ifdef CONFIG_BT_NIMBLE_HOST_TASK_STACK_SIZE
+  { "nimble_host", CONFIG_BT_NIMBLE_HOST_TASK_STACK_SIZE, false },
+#endif
+#ifdef CONFIG_ARDUINO_LOOP_STACK_SIZE
+  { "loopTask", CONFIG_ARDUINO_LOOP_STACK_SIZE, false },
+#endif
+  { "biz", BIZ_TASK_STACK, true },
+#ifdef CONFIG_FREERTOS_IDLE_TASK_STACKSIZE
+  { "IDLE", CONFIG_FREERTOS_IDLE_TASK_STACKSIZE, true },
+#endif
+#ifdef CONFIG_ESP_IPC_TASK_STACK_SIZE
+  { "ipc", CONFIG_ESP_IPC_TASK_STACK_SIZE, true },
+#endif
+};
+
+struct StackPeak {
+  uint32_t uptimeSec;
+  uint32_t freeBytes;
+};
+
+struct StackTrack {
+  char name[configMAX_TASK_NAME_LEN];
+  uint32_t sizeBytes;  /* 0 if unknown */
+  uint32_t minFree;
+  uint32_t lastSeenSec;
+  StackPeak trend[STACK_TREND_POINTS];  /* Oldest first */
+  uint8_t trendCount;
+  StackHealth health;
+  bool alive;
+};
+
+static StackTrack tracks[STACK_TRACK_MAX];
+static uint8_t trackCount = 0;
+static SemaphoreHandle_t stackMutex = nullptr;
+
+uint32_t taskStackSize(const char* name) {
+  for (const StackSizeEntry& e : stackSizes) {
+    size_t len = strlen(e.name);
+    if (e.prefix ? strncmp(name, e.name, len) == 0 : strcmp(name, e.name) == 0) return e.bytes;
+  }
+  return 0;
+}
+
+StackHealth stackHealthFor(uint32_t freeBytes, uint32_t sizeBytes) {
+  if (freeBytes < STACK_CRITICAL_FREE_BYTES) return STACK_CRITICAL;
+  if (sizeBytes == 0) {
+    /* Unknown size: fall back to absolute margins */
+    if (freeBytes > 1500) return STACK_GOOD;
+    if (freeBytes > 800) return STACK_OK;
+    if (freeBytes > 300) return STACK_LOW;
+    return STACK_CRITICAL;
+  }
+  uint32_t freePct = (uint32_t)(((uint64_t)freeBytes * 100) / sizeBytes);
+  if (freePct < STACK_CRITICAL_FREE_PCT) return STACK_CRITICAL;
+  if (freePct < STACK_LOW_FREE_PCT) return STACK_LOW;
+  if (freePct < STACK_OK_FREE_PCT) return STACK_OK;
+  return STACK_GOOD;
+}
+
+/* recommendedStack: Observed peak plus headroom, rounded up to 256 bytes; 0 if the size is unknown */
+static uint32_t recommendedStack(const StackTrack& t) {
+  if (t.sizeBytes == 0 || t.minFree > t.sizeBytes) return 0;
+  uint32_t used = t.sizeBytes - t.minFree;
+  uint32_t headroom = used * STACK_HEADROOM_PCT / 100;
+  if (headroom < STACK_HEADROOM_MIN) headroom = STACK_HEADROOM_MIN;
+  return (used + headroom + 255) & ~255u;
+}
+
+/* findTrack: Entry for `name`, creating one (or recycling the longest-dead one) if asked */
+static StackTrack* findTrack(const char* name, bool create) {
+  for (uint8_t i = 0; i < trackCount; i++) {
+    if (strncmp(tracks[i].name, name, sizeof(tracks[i].name)) == 0) return &tracks[i];
+  }
+  if (!create) return nullptr;
+
+  StackTrack* t = nullptr;
+  if (trackCount < STACK_TRACK_MAX) {
+    t = &tracks[trackCount++];
+  } else {
+    for (uint8_t i = 0; i < trackCount; i++) {
+      if (tracks[i].alive) continue;
+      if (!t || tracks[i].lastSeenSec < t->lastSeenSec) t = &tracks[i];
+    }
+    if (!t) return nullptr;
+  }
+
+  memset(t, 0, sizeof(*t));
+  strncpy(t->name, name, sizeof(t->name) - 1);
+  t->sizeBytes = taskStackSize(t->name);
+  t->health = STACK_GOOD;
+  return t;
+}
+
+/* recordPeak: Returns true if the task's health just dropped to low or critical */
+static bool recordPeak(StackTrack& t, uint32_t freeBytes, uint32_t nowSec) {
+  if (t.trendCount == 0 || freeBytes < t.minFree) {
+    t.minFree = freeBytes;
+    if (t.trendCount == STACK_TREND_POINTS) {
+      memmove(&t.trend[0], &t.trend[1], (STACK_TREND_POINTS - 1) * sizeof(StackPeak));
+      t.trendCount--;
+    }
+    t.trend[t.trendCount].uptimeSec = nowSec;
+    t.trend[t.trendCount].freeBytes = freeBytes;
+    t.trendCount++;
+  }
+  t.lastSeenSec = nowSec;
+
+  StackHealth health = stackHealthFor(t.minFree, t.sizeBytes);
+  bool worse = health > t.health && health >= STACK_LOW;
+  t.health = health;
+  return worse;
+}
+
+static void logStackAlert(const StackTrack& t) {
+  bool critical = (t.health == STACK_CRITICAL);
+  if (t.sizeBytes) {
+    Serial.printf("WARNING: Stack %s %s: %u of %u B free\n",
+                  t.name, stackHealthName(t.health), t.minFree, t.sizeBytes);
+    if (critical) LOG_ERROR(EVT_STACK_CRITICAL, t.name, t.minFree, t.sizeBytes);
+    else LOG_ERROR(EVT_STACK_LOW, t.name, t.minFree, t.sizeBytes);
+  } else {
+    Serial.printf("WARNING: Stack %s %s: %u B free\n", t.name, stackHealthName(t.health), t.minFree);
+    if (critical) LOG_ERROR(EVT_STACK_CRITICAL_FREE, t.name, t.minFree);
+    else LOG_ERROR(EVT_STACK_LOW_FREE, t.name, t.minFree);
+  }
+}
+
+void stackMonitorInit() {
+  stackMutex = xSemaphoreCreateMutex();
+  if (!stackMutex) {
+    Serial.println(F("CRITICAL: Failed to create stackMutex!"));
+    return;
+  }
+
+#if ENABLE_OTA
+  uint32_t otaFree = 0;
+  /* Acquire flashWriteMutex mutex (wait up to 1000ms) to safely access shared resource */
+  if (xSemaphoreTake(flashWriteMutex, pdMS_TO_TICKS(1000)) == pdTRUE) {
+    otaFree = prefs.getUInt(NVS_KEY_OTA_STACK, 0);
+    xSemaphoreGive(flashWriteMutex);
+  }
+  if (otaFree > 0) stackMonitorRecord("ota_task", otaFree);
+#endif
+}
+
+void stackMonitorUpdate(const TaskMonitorData* tasks, uint8_t count) {
+  if (!stackMutex) return;
+  uint32_t nowSec = millis() / 1000;
+
+  if (xSemaphoreTake(stackMutex, pdMS_TO_TICKS(100)) != pdTRUE) return;
+  for (uint8_t i = 0; i < trackCount; i++) tracks[i].alive = false;
+  xSemaphoreGive(stackMutex);
+
+  for (uint8_t i = 0; i < count; i++) {
+    if (tasks[i].state == eDeleted || !tasks[i].handle) continue;
+
+    bool worse = false;
+    StackTrack alert;
+    /* Lock per entry so a reader streaming the table never waits for the whole pass */
+    if (xSemaphoreTake(stackMutex, pdMS_TO_TICKS(100)) != pdTRUE) return;
+    StackTrack* t = findTrack(tasks[i].name, true);
+    if (t) {
+      t->alive = true;
+      worse = recordPeak(*t, tasks[i].stackHighWater, nowSec);
+      if (worse) alert = *t;
+    }
+    xSemaphoreGive(stackMutex);
+
+    if (worse) logStackAlert(alert);
+  }
+}
+
+void stackMonitorRecord(const char* name, uint32_t freeBytes) {
+  if (!stackMutex) return;
+  bool worse = false;
+  StackTrack alert;
+  if (xSemaphoreTake(stackMutex, pdMS_TO_TICKS(100)) != pdTRUE) return;
+  StackTrack* t = findTrack(name, true);
+  if (t) {
+    worse = recordPeak(*t, freeBytes, millis() / 1000);
+    if (worse) alert = *t;
+  }
+  xSemaphoreGive(stackMutex);
+
+  if (worse) logStackAlert(alert);
+}
+
+#if ENABLE_OTA
+void stackMonitorSaveOtaPeak() {
+  uint32_t freeBytes = uxTaskGetStackHighWaterMark(NULL);
+  Serial.printf("OTA task stack: %u of %u bytes never used\n", freeBytes, (uint32_t)OTA_TASK_STACK);
+  /* Acquire flashWriteMutex mutex (wait up to 100ms) to safely access shared resource */
+  if (xSemaphoreTake(flashWriteMutex, pdMS_TO_TICKS(100)) == pdTRUE) {
+    uint32_t saved = prefs.getUInt(NVS_KEY_OTA_STACK, 0);
+    if (saved == 0 || freeBytes < saved) prefs.putUInt(NVS_KEY_OTA_STACK, freeBytes);
+    xSemaphoreGive(flashWriteMutex);
+  }
+}
+#endif
+
+void registerStackRoutes() {
+  server.on("/api/stacks", HTTP_GET, handleApiStacks);
+}
+
+void handleApiStacks() {
+  if (isOtaActive()) {
+    sendBusyJson("OTA in progress");
+    return;
+  }
+  if (!stackMutex) {
+    sendBusyJson("Stack monitor not running");
+    return;
+  }
+
+  server.setContentLength(CONTENT_LENGTH_UNKNOWN);
+  server.send(200, "application/json", "");
+
+  ChunkWriter out;
+  out.printf("{\"interval_ms\":%u,\"uptime_s\":%u,\"tasks\":[", (uint32_t)STACK_CHECK_INTERVAL, millis() / 1000);
+
+  uint32_t reclaimableTotal = 0;
+  bool any = false;
+  for (uint8_t i = 0; i < STACK_TRACK_MAX; i++) {
+    StackTrack t;
+    if (xSemaphoreTake(stackMutex, pdMS_TO_TICKS(100)) != pdTRUE) break;
+    bool valid = i < trackCount;
+    if (valid) t = tracks[i];
+    xSemaphoreGive(stackMutex);
+    if (!valid) break;
+
+    out.printf("%s{\"name\":\"%s\",\"alive\":%s,\"free_min\":%u,\"health\":\"%s\"", any ? "," : "",
+               t.name, t.alive ? "true" : "false", t.minFree, stackHealthName(t.health));
+    uint32_t recommended = recommendedStack(t);
+    if (recommended) {
+      uint32_t reclaimable = (t.sizeBytes > recommended) ? t.sizeBytes - recommended : 0;
+      reclaimableTotal += reclaimable;
+      out.printf(",\"size\":%u,\"used_pct\":%u,\"recommended\":%u,\"reclaimable\":%u", t.sizeBytes,
+                 (uint32_t)(((uint64_t)(t.sizeBytes - t.minFree) * 100) / t.sizeBytes), recommended, reclaimable);
+    }
+    out.printf(",\"peaks\":[");
+    for (uint8_t p = 0; p < t.trendCount; p++) {
+      out.printf("%s[%u,%u]", p ? "," : "", t.trend[p].uptimeSec, t.trend[p].freeBytes);
+    }
+    out.printf("]}");
+    any = true;
+  }
+
+  out.printf("],\"reclaimable_total\":%u}", reclaimableTotal);
+  out.end();
+}
+
+#endif
@@ -0,0 +1,56 @@
+/* ==============================================================================
+   STACK_MONITOR.H - Per-Task Stack Watermark Monitor Interface
+
+   Tracks the stack high-water mark of every task (DEBUG_MODE):
+   - Allocated size per task name, from config.h for our tasks and from
+     sdkconfig for the IDF ones (IDLE, ipc, esp_timer, tiT, nimble_host...)
+   - Health relative to that size (STACK_*_FREE_PCT), absolute bytes when
+     the size is unknown
+   - The last STACK_TREND_POINTS times a task's peak usage grew
+   - A recommended size: observed peak plus STACK_HEADROOM_PCT, so
+     over-provisioned stacks can be shrunk
+
+   Entries are keyed by task name, so a peak survives the task being
+   recreated (web and biz after a failed OTA). An alert goes to the error
+   log only when a task drops to low or critical, never on every check.
+
+   GET /api/stacks returns the table with recommendations.
+   ============================================================================== */
+
+/* Header guard to prevent multiple inclusion of stack_monitor.h */
+#ifndef STACK_MONITOR_H
+#define STACK_MONITOR_H
+
+#include "config.h"
+
+#if DEBUG_MODE
+
+#include <Arduino.h>
+#include "types.h"
+
+/* Creates the table lock and restores the OTA task peak saved before the last update reboot */
+void stackMonitorInit();
+
+/* Allocated stack of a task in bytes, 0 if not known */
+uint32_t taskStackSize(const char* name);
+
+StackHealth stackHealthFor(uint32_t freeBytes, uint32_t sizeBytes);
+
+/* Folds one task sample into the table; statsTask every STACK_CHECK_INTERVAL */
+void stackMonitorUpdate(const TaskMonitorData* tasks, uint8_t count);
+
+/* Records a peak directly, for short-lived tasks the sampler may never see */
+void stackMonitorRecord(const char* name, uint32_t freeBytes);
+
+#if ENABLE_OTA
+/* Saves the calling OTA task's peak to NVS; the update reboots before it could be sampled */
+void stackMonitorSaveOtaPeak();
+#endif
+
+void registerStackRoutes();
+
+void handleApiStacks();
+
+#endif
+
+#endif
@@ -15,12 +15,20 @@
 
 #include "tasks.h"
 #include "globals.h"
+#include "msg_pool.h"
+#include "cmd_registry.h"
+#include "exec_queue.h"
+#include "exec_result.h"
+#include "exec_stats.h"
 #include "wifi_handler.h"
 #include "ble_handler.h"
 #include "time_handler.h"
 #include "cpu_monitor.h"
 #include "debug_handler.h"
 #include "web_handler.h"
+#include "metrics_history.h"
+#include "trace.h"
+#include "heap_tracker.h"
 #include <esp_task_wdt.h>
 
 #if ENABLE_OTA
@@ -29,18 +37,10 @@
 
 void initMessagePool() {
 
-  poolMutex = xSemaphoreCreateMutex();
-  if (!poolMutex) {
-    Serial.println(F("FATAL: poolMutex creation failed!"));
-    LOG_ERROR(F("poolMutex creation failed"), 0);
-    while (1) { delay(1000); }
-  }
-  Serial.println(F("poolMutex created"));
-
   wifiMutex = xSemaphoreCreateMutex();
   if (!wifiMutex) {
     Serial.println(F("FATAL: wifiMutex creation failed!"));
-    LOG_ERROR(F("wifiMutex creation failed"), 0);
+    LOG_ERROR(EVT_WIFI_MUTEX_FAILED);
     while (1) { delay(1000); }
   }
   Serial.println(F("wifiMutex created"));
@@ -48,21 +48,19 @@ void initMessagePool() {
   timeMutex = xSemaphoreCreateMutex();
   if (!timeMutex) {
     Serial.println(F("FATAL: timeMutex creation failed!"));
-    LOG_ERROR(F("timeMutex creation failed"), 0);
+    LOG_ERROR(EVT_TIME_MUTEX_FAILED);
     while (1) { delay(1000); }
   }
   Serial.println(F("timeMutex created"));
 
-  for (int i = 0; i < MSG_POOL_SIZE; i++) {
-    msgPool[i].inUse = false;
-    msgPool[i].length = 0;
-  }
+  msgPoolInit();
+  Serial.println(F("Message pool ready (lock-free)"));
 
 #if ENABLE_OTA
   otaMutex = xSemaphoreCreateMutex();
   if (!otaMutex) {
     Serial.println(F("FATAL: otaMutex creation failed!"));
-    LOG_ERROR(F("otaMutex creation failed"), 0);
+    LOG_ERROR(EVT_OTA_MUTEX_FAILED);
     while (1) { delay(1000); }
   }
   Serial.println(F("otaMutex created"));
@@ -70,7 +68,7 @@ void initMessagePool() {
   taskDeletionMutex = xSemaphoreCreateMutex();
   if (!taskDeletionMutex) {
     Serial.println(F("FATAL: taskDeletionMutex creation failed!"));
-    LOG_ERROR(F("taskDeletionMutex creation failed"), 0);
+    LOG_ERROR(EVT_DELETION_MUTEX_FAILED);
     while (1) { delay(1000); }
   }
   Serial.println(F("taskDeletionMutex created"));
@@ -86,7 +84,7 @@ void initMessagePool() {
     otaStatus.available = (ota_partition != NULL);
     #if DEBUG_MODE
     if (!otaStatus.available) {
-      addErrorLog(F("No OTA partition found"), 0);
+      LOG_ERROR(EVT_NO_OTA_PARTITION_BOOT);
     }
     #endif
     xSemaphoreGive(otaMutex);
@@ -94,29 +92,6 @@ void initMessagePool() {
 #endif
 }
 
-ExecMessage* allocMessage() {
-  if (poolMutex && xSemaphoreTake(poolMutex, pdMS_TO_TICKS(100)) == pdTRUE) {
-    for (int i = 0; i < MSG_POOL_SIZE; i++) {
-      if (!msgPool[i].inUse) {
-        msgPool[i].inUse = true;
-        xSemaphoreGive(poolMutex);
-        return &msgPool[i];
-      }
-    }
-    xSemaphoreGive(poolMutex);
-  }
-  LOG_ERROR(F("Message pool exhausted or mutex NULL"), millis() / 1000);
-  return nullptr;
-}
-
-void freeMessage(ExecMessage* msg) {
-  if (msg && poolMutex && xSemaphoreTake(poolMutex, pdMS_TO_TICKS(100)) == pdTRUE) {
-    msg->inUse = false;
-    msg->length = 0;
-    xSemaphoreGive(poolMutex);
-  }
-}
-
 void systemTask(void* param) {
   (void)param;
   esp_task_wdt_add(NULL);  /* Register this task with watchdog timer */
@@ -150,7 +125,9 @@ void systemTask(void* param) {
     
     if (now - lastWiFiCheck >= wifiCheckInterval) {
       lastWiFiCheck = now;
+      TRACE_BEGIN(TRACE_WIFI_CHECK);
       checkWiFiConnection();
+      TRACE_END(TRACE_WIFI_CHECK);
     }
 
     if (isConnected) {
@@ -164,12 +141,6 @@ void systemTask(void* param) {
 
     handleBLEReconnect();
 
-    updateCpuLoad();
-
-#if DEBUG_MODE
-    checkTaskStacks();
-#endif
-
     if (bleDeviceConnected) {
       uint32_t now = millis();
       if (now - ledTs > BLE_LED_BLINK_MS) {
@@ -207,13 +178,12 @@ void webTask(void* param) {
     
 
     if (serverStarted) {
+      TRACE_SCOPE_MIN(TRACE_HTTP, 200);  /* Most polls find no client; keep only real requests */
       server.handleClient();
     }
 
 #if DEBUG_MODE
-    if (!isOtaActive()) {
-      updateTaskMonitoring();
-    } else {
+    if (isOtaActive()) {
       vTaskDelay(pdMS_TO_TICKS(50));
     }
 #endif
@@ -222,22 +192,78 @@ void webTask(void* param) {
   }
 }
 
-void bizTask(void* param) {
+/* statsTask: The only periodic caller of uxTaskGetSystemState(); publishes CPU and task stats every period */
+void statsTask(void* param) {
   (void)param;
   esp_task_wdt_add(NULL);  /* Register this task with watchdog timer */
-  ExecMessage* msg = nullptr;
+  TickType_t lastWake = xTaskGetTickCount();
+
+  for (;;) {
+    esp_task_wdt_reset();
+    if (!isOtaActive()) {
+      TRACE_SCOPE(TRACE_STATS_SAMPLE);
+      updateCpuLoad();
+#if DEBUG_MODE
+      checkTaskStacks();
+#endif
+#if ENABLE_METRICS_HISTORY
+      metricsHistorySample();
+#endif
+#if ENABLE_HEAP_TRACK
+      heapTrackSample();
+#endif
+    }
+    vTaskDelayUntil(&lastWake, pdMS_TO_TICKS(STATS_SAMPLE_INTERVAL_MS));
+  }
+}
+
+#if BIZ_LOG_COMMANDS
+static void bizReply(const char* text) {
+  Serial.printf("[bizTask] reply: %s", text);
+}
+#else
+#define bizReply nullptr
+#endif
+
+__attribute__((weak)) CmdResult bizHandleAppCommand(const char* cmd) {
+  (void)cmd;
+  return CMD_ERR_UNKNOWN;
+}
+
+/* processBizMessage: Executes one queued command and returns its slot to the pool */
+static void processBizMessage(uint8_t worker, ExecMessage* msg) {
+  TRACE_SCOPE(TRACE_BIZ_CMD);
+#if BIZ_LOG_COMMANDS
+  Serial.printf("[biz%u] cmd '%s' (%u bytes)\n", worker, msg->payload, msg->length);
+#endif
+
+  execResultStart(msg->id);
+  CmdResult result = cmdDispatch(msg->payload, CMD_VIA_HTTP, bizReply);
+  if (result == CMD_ERR_UNKNOWN) result = bizHandleAppCommand(msg->payload);
+  execResultFinish(msg->id, EXEC_STATE_DONE, result);
+  execStatsComplete(msg, micros());
+
+  /* Workers on both cores bump the shared total; the per-worker slot has a single writer */
+  __atomic_fetch_add(&bizProcessed, 1, __ATOMIC_RELAXED);
+  bizWorkerProcessed[worker] = bizWorkerProcessed[worker] + 1;
+  freeMessage(msg);
+}
+
+/* bizTask: One worker of the pool; param is the worker index */
+void bizTask(void* param) {
+  uint8_t worker = (uint8_t)(uintptr_t)param;
+  esp_task_wdt_add(NULL);  /* Register this task with watchdog timer */
+  uint32_t rateWindowStart = millis();
+  uint32_t rateWindowBase = bizProcessed;
 
   for (;;) {
 #if ENABLE_OTA
     if (bizTaskShouldExit) {
-      Serial.println(F("bizTask: Received exit signal, cleaning up..."));
-      if (msg) {
-        freeMessage(msg);
-        msg = nullptr;
-      }
+      Serial.printf("biz%u: Received exit signal, cleaning up...\n", worker);
+      execWorkerIdle(worker, false);
       esp_task_wdt_delete(NULL);
-      bizTaskHandle = NULL;
-      Serial.println(F("bizTask: Exiting"));
+      bizTaskHandles[worker] = NULL;
+      Serial.printf("biz%u: Exiting\n", worker);
       vTaskDelete(NULL);
       return;
     }
@@ -245,45 +271,64 @@ void bizTask(void* param) {
 
     esp_task_wdt_reset();
 
-    if (gBizState == BIZ_RUNNING && !isOtaActive()) {
-      if (execQ && xQueueReceive(execQ, &msg, pdMS_TO_TICKS(100)) == pdTRUE) {
-
-        Serial.println("\n[bizTask] Received a message from queue.");
-
-        if (msg) {
-          Serial.printf("[bizTask] Message payload: '%s' (Length: %d)\n", msg->payload, msg->length);
-
-          String cmd = String(msg->payload);
-          cmd.toLowerCase();
-
-          if (cmd.equals("reset") || cmd.equals("reboot")) {
-            Serial.println("[bizTask] Command MATCHED 'reset' or 'reboot'.");
-            Serial.println(F("bizTask: Reboot command received. Restarting in 500ms..."));
-
-            freeMessage(msg);
-            msg = nullptr;
-            vTaskDelay(pdMS_TO_TICKS(500));
-            #if DEBUG_MODE
-            prefs.putBool(NVS_FLAG_USER_REBOOT, true);
-            prefs.end();
-            delay(50);
-            prefs.begin("esp32_base", false);
-            #endif
-            ESP.restart();
-          } else {
-            Serial.printf("[bizTask] Command '%s' did NOT match reboot logic. Processing as other command.\n", cmd.c_str());
-            vTaskDelay(pdMS_TO_TICKS(50));
-            bizProcessed++;
-            freeMessage(msg);
-            msg = nullptr;
-          }
-        } else {
-          Serial.println("[bizTask] Received a NULL message from queue. This should not happen.");
-          LOG_ERROR(F("bizTask: NULL message received"), millis() / 1000);
-        }
+    if (!isOtaActive()) {
+      /* While stopped only the control lane is serviced, so "start" still gets through */
+      bool running = gBizState == BIZ_RUNNING;
+      execWorkerIdle(worker, true);
+      if (!execPending(worker, running)) {
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(100));
+        running = gBizState == BIZ_RUNNING;
+      }
+      execWorkerIdle(worker, false);
+
+      /* Re-check the control lane before every message so it never waits behind bulk work */
+      uint8_t count = 0;
+      ExecMessage* msg;
+      while (count < BIZ_BATCH_MAX && (msg = execDequeue(worker, running)) != nullptr) {
+        processBizMessage(worker, msg);
+        count++;
+        running = gBizState == BIZ_RUNNING;
       }
     } else {
       vTaskDelay(pdMS_TO_TICKS(100));
     }
+
+    /* Worker 0 publishes the pool-wide rate */
+    uint32_t now = millis();
+    uint32_t elapsed = now - rateWindowStart;
+    if (worker == 0 && elapsed >= 1000) {
+      uint32_t processed = bizProcessed;
+      bizCmdRate = ((processed - rateWindowBase) * 1000UL) / elapsed;
+      rateWindowBase = processed;
+      rateWindowStart = now;
+    }
+  }
+}
+
+/* startBizWorkers: Creates every biz worker that is not running; returns how many are running */
+uint8_t startBizWorkers() {
+  uint8_t running = 0;
+  for (uint8_t i = 0; i < BIZ_WORKERS; i++) {
+    if (bizTaskHandles[i] != NULL) {
+      running++;
+      continue;
+    }
+
+    char name[8];
+    snprintf(name, sizeof(name), "biz%u", i);
+#if NUM_CORES > 1
+    BaseType_t result = xTaskCreatePinnedToCore(bizTask, name, BIZ_TASK_STACK, (void*)(uintptr_t)i, 1,
+                                                &bizTaskHandles[i], (i + 1) % NUM_CORES);
+#else
+    BaseType_t result = xTaskCreate(bizTask, name, BIZ_TASK_STACK, (void*)(uintptr_t)i, 1, &bizTaskHandles[i]);
+#endif
+    if (result == pdPASS) {
+      running++;
+    } else {
+      bizTaskHandles[i] = NULL;
+      Serial.printf("ERROR: Failed to create %s!\n", name);
+      LOG_ERROR(EVT_TASK_CREATE_FAILED, name);
+    }
   }
+  return running;
 }
\ No newline at end of file
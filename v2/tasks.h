@@ -3,7 +3,8 @@
    
    Declares all FreeRTOS task functions that run concurrently:
    - webTask: HTTP server handling
-   - bizTask: Main business logic
+   - bizTask: Main business logic, one instance per biz worker (BIZ_WORKERS)
+   - statsTask: Periodic CPU/task statistics sampler
    - flashWriteTask: Background NVS writes (DEBUG_MODE only)
    
    Each task runs independently with its own stack and priority.
@@ -15,6 +16,7 @@
 
 #include <Arduino.h>
 #include "types.h"
+#include "cmd_registry.h"
 
 void systemTask(void* param);
 
@@ -22,10 +24,14 @@ void webTask(void* param);
 
 void bizTask(void* param);
 
-void initMessagePool();
+void statsTask(void* param);
+
+uint8_t startBizWorkers();
 
-ExecMessage* allocMessage();
+void initMessagePool();
 
-void freeMessage(ExecMessage* msg);
+/* Runs a queued command the registry does not know, on a biz worker. Weak: the application
+   defines its own to add commands; the default leaves every such command CMD_ERR_UNKNOWN */
+CmdResult bizHandleAppCommand(const char* cmd);
 
 #endif
\ No newline at end of file
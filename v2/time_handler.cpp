@@ -49,9 +49,9 @@ void syncNTP() {
 
     if (timeMutex && xSemaphoreTake(timeMutex, pdMS_TO_TICKS(100)) == pdTRUE) {
       lastNtpSync = now;
-      timeInitialized = true;
       xSemaphoreGive(timeMutex);
     }
+    timeInitialized.store(true, std::memory_order_release);
 
     struct tm timeinfo;
     if (getLocalTime(&timeinfo)) {
@@ -61,17 +61,13 @@ void syncNTP() {
     }
   } else {
     Serial.println(F("Failed to sync time with NTP"));
-    LOG_ERROR(F("NTP sync timeout"), millis() / 1000);
+    LOG_ERROR(EVT_NTP_TIMEOUT);
   }
 }
 
+/* getTimeInitialized: Lock-free, so the logger can stamp events from any task without timeMutex */
 bool getTimeInitialized() {
-  bool initialized = false;
-  if (timeMutex && xSemaphoreTake(timeMutex, pdMS_TO_TICKS(10)) == pdTRUE) {
-    initialized = timeInitialized;
-    xSemaphoreGive(timeMutex);
-  }
-  return initialized;
+  return timeInitialized.load(std::memory_order_acquire);
 }
 
 String getCurrentTimeString() {
@@ -19,6 +19,7 @@ void initNTP();
 
 void syncNTP();
 
+/* True once the first NTP sync succeeded; lock-free, safe from any task */
 bool getTimeInitialized();
 
 String getCurrentTimeString();
@@ -0,0 +1,143 @@
+#!/usr/bin/env python3
+"""Decode binary debug log events on the host.
+
+The firmware records debug logs as event IDs plus raw arguments; the format
+strings live only in log_events.h, which this script parses. Two inputs:
+
+  GET /api/debug/logs?raw=1 output (a file, or the URL itself):
+    log_decode.py logs.json
+    log_decode.py http://192.168.1.50/api/debug/logs?raw=1
+
+  A dump of the log store partition (ENABLE_LOG_STORE), e.g.
+    esptool.py read_flash <offset> <size> logs.bin
+    log_decode.py --flash logs.bin
+
+Only the Python standard library is used.
+"""
+
+import argparse
+import json
+import os
+import re
+import struct
+import sys
+import time
+import urllib.request
+import zlib
+
+DEFAULT_TABLE = os.path.join(os.path.dirname(os.path.abspath(__file__)), "..", "log_events.h")
+
+CATEGORIES = ["reboots", "wifi", "errors"]  # LogCategory order
+
+# log_store.cpp: segment header and record layout
+SEGMENT_SIZE = 4096
+SEGMENT_MAGIC = 0x33474F4C  # "LOG3"; older segments are converted by the firmware at boot
+HEADER = struct.Struct("<IIII")  # magic, segSeq, reserved, crc
+RECORD = struct.Struct("<IB3xIIHBBII20sI")  # seq, cat, LogEntry (uptime, epoch, id, argc, flags, args[2], str), crc
+STR_CUT = 0x01  # LOG_ENTRY_STR_CUT
+CUT_MARK = "\u2026"  # LOG_STR_CUT_MARK
+RECORDS_PER_SEGMENT = (SEGMENT_SIZE - HEADER.size) // RECORD.size
+
+SPEC = re.compile(r"%(%|[-0+ #]*[1-9]?[0-9]*([a-zA-Z]))")
+
+
+def load_table(path):
+    """Returns {id: (name, format)} from the LOG_EVENT_TABLE X-macro."""
+    with open(path, encoding="utf-8") as f:
+        text = f.read()
+    table = {}
+    for name, num, fmt in re.findall(r'X\(\s*(\w+)\s*,\s*(\d+)\s*,\s*"((?:[^"\\]|\\.)*)"\s*\)', text):
+        table[int(num)] = (name, bytes(fmt, "utf-8").decode("unicode_escape"))
+    if not table:
+        sys.exit("no events found in %s" % path)
+    return table
+
+
+def format_event(table, event_id, args, s, cut=False):
+    """Mirrors formatLogEvent() in log_events.cpp."""
+    if event_id not in table:
+        return "Unknown event %u" % event_id
+    fmt = table[event_id][1]
+    ints = iter(args)
+
+    def conv(m):
+        if m.group(1) == "%":
+            return "%"
+        spec, kind = m.group(0), m.group(2)
+        if kind == "s":
+            return spec % s + (CUT_MARK if cut else "")
+        v = next(ints, 0) & 0xFFFFFFFF
+        if kind in "di":
+            v = v - (1 << 32) if v & 0x80000000 else v
+            return (spec[:-1] + "d") % v
+        return (spec[:-1] + ("x" if kind == "x" else "d")) % v
+
+    return SPEC.sub(conv, fmt)
+
+
+def when(uptime, epoch):
+    if epoch:
+        return time.strftime("%Y-%m-%d %H:%M:%S", time.gmtime(epoch))
+    return "+%us" % uptime
+
+
+def decode_json(table, data):
+    for cat in CATEGORIES:
+        for e in data.get(cat, []):
+            if "id" not in e:
+                msg = e.get("msg", "")
+            else:
+                msg = format_event(table, e["id"], e.get("args", []), e.get("s", ""), e.get("cut", False))
+            print("%-8s %-19s %s" % (cat, when(e.get("t", 0), e.get("epoch", 0)), msg))
+
+
+def decode_flash(table, blob):
+    """Valid records from every segment, one per (category, sequence number), oldest first per category."""
+    records = {}
+    bad = 0
+    for seg in range(len(blob) // SEGMENT_SIZE):
+        base = seg * SEGMENT_SIZE
+        magic, _, _, crc = HEADER.unpack_from(blob, base)
+        if magic != SEGMENT_MAGIC or crc != zlib.crc32(blob[base:base + HEADER.size - 4]):
+            continue
+        for slot in range(RECORDS_PER_SEGMENT):
+            off = base + HEADER.size + slot * RECORD.size
+            raw = blob[off:off + RECORD.size]
+            if raw == b"\xff" * RECORD.size:
+                continue
+            seq, cat, uptime, epoch, event_id, argc, flags, a0, a1, s, crc = RECORD.unpack(raw)
+            if crc != zlib.crc32(raw[:-4]) or cat >= len(CATEGORIES):
+                bad += 1
+                continue
+            s = s.split(b"\0", 1)[0].decode("utf-8", "replace")
+            msg = format_event(table, event_id, [a0, a1][:argc], s, bool(flags & STR_CUT))
+            records[(cat, seq)] = (uptime, epoch, msg)
+
+    for cat, seq in sorted(records):
+        uptime, epoch, msg = records[(cat, seq)]
+        print("%8u %-8s %-19s %s" % (seq, CATEGORIES[cat], when(uptime, epoch), msg))
+    if bad:
+        print("(%u torn or corrupt records skipped)" % bad, file=sys.stderr)
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    ap.add_argument("input", help="raw /api/debug/logs JSON (file or URL), or a partition dump with --flash")
+    ap.add_argument("--flash", action="store_true", help="input is a dump of the log store partition")
+    ap.add_argument("--table", default=DEFAULT_TABLE, help="path to log_events.h")
+    opts = ap.parse_args()
+
+    table = load_table(opts.table)
+    if opts.flash:
+        with open(opts.input, "rb") as f:
+            decode_flash(table, f.read())
+    elif opts.input.startswith(("http://", "https://")):
+        with urllib.request.urlopen(opts.input, timeout=10) as r:
+            decode_json(table, json.load(r))
+    else:
+        with open(opts.input, encoding="utf-8") as f:
+            decode_json(table, json.load(f))
+
+
+if __name__ == "__main__":
+    main()
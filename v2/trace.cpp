@@ -0,0 +1,199 @@
+/* ==============================================================================
+   TRACE.CPP - Timeline Trace Implementation
+
+   A writer masks interrupts on its own core for the few instructions it
+   takes to claim a slot and fill it. That keeps it from being preempted or
+   migrated, so each ring has a single writer at any instant and needs no
+   lock or atomic. The export clears traceEnabled and waits a tick before
+   reading, so it never sees a half-written event.
+
+   A ring entry is normally an event. A sync entry (phase 'S') is followed by
+   a time entry (phase 'T') holding the esp_timer time of that cycle count;
+   the distinct phase lets a reader that starts on a 'T' whose 'S' was
+   overwritten skip it instead of reading the next event as a time. A writer
+   emits one whenever TRACE_SYNC_US of esp_timer time have passed or half
+   the ring has been written since the last. The gap is measured in esp_timer
+   time because the 32-bit cycle counter wraps every ~18s, and a core that
+   traces nothing for that long would otherwise look freshly synced. Every
+   event is therefore close enough to a sync for a signed 32-bit cycle
+   difference, and a burst that fills the ring still leaves a sync in it.
+   Events older than the oldest surviving sync are skipped.
+
+   The export puts every event in one process with one thread per task, so
+   a span whose task migrated between begin and end still pairs up; the
+   core that recorded each event is an argument.
+   ============================================================================== */
+
+#include "trace.h"
+
+#if ENABLE_TRACE
+
+#include "globals.h"
+#include "web_handler.h"
+#include <esp_timer.h>
+
+static_assert((TRACE_EVENTS_PER_CORE & (TRACE_EVENTS_PER_CORE - 1)) == 0,
+              "TRACE_EVENTS_PER_CORE must be a power of two");
+
+/* 1s is 240M cycles at 240MHz, well inside the +-2^31 a signed difference can span */
+#define TRACE_SYNC_US 1000000
+/* A TRACE_SCOPE_MIN span longer than this (~1.1s at 240MHz) is taken to have migrated */
+#define TRACE_SPAN_MAX_CYCLES (1u << 28)
+#define TRACE_PH_SYNC 'S'
+#define TRACE_PH_SYNC_TIME 'T'
+#define TRACE_MAX_TASKS 48
+
+struct TraceEvent {
+  uint32_t cycles;  /* Low 32 bits of the esp_timer time in a sync's second entry */
+  uint16_t task;    /* (TCB address >> 4) truncated; high bits of the time in a sync's second entry */
+  uint8_t id;
+  char phase;
+};
+
+struct TraceRing {
+  TraceEvent events[TRACE_EVENTS_PER_CORE];
+  uint32_t head;  /* Entries ever written; the slot is head % TRACE_EVENTS_PER_CORE */
+  uint32_t syncHead;
+  int64_t syncUs;
+};
+
+static const char* const traceNames[TRACE_ID_COUNT] = {
+  "http", "biz_cmd", "wifi_check", "flash_write", "ota_write", "stats_sample"
+};
+
+static TraceRing rings[NUM_CORES];
+static volatile bool traceEnabled = true;
+static uint32_t cyclesPerUs = 0;  /* CPU MHz; the clock is fixed unless power management is enabled */
+
+static inline uint16_t taskKey(TaskHandle_t handle) {
+  return (uint16_t)((uintptr_t)handle >> 4);
+}
+
+static inline TraceEvent& claimSlot(TraceRing& ring) {
+  return ring.events[ring.head++ & (TRACE_EVENTS_PER_CORE - 1)];
+}
+
+/* writeEvent: Interrupts must be masked on this core */
+static inline void writeEvent(TraceId id, char phase, uint32_t cycles, uint32_t now) {
+  TraceRing& ring = rings[xPortGetCoreID()];
+  int64_t us = esp_timer_get_time();
+  if (ring.head == 0 || us - ring.syncUs > TRACE_SYNC_US ||
+      ring.head - ring.syncHead >= TRACE_EVENTS_PER_CORE / 2) {
+    TraceEvent& sync = claimSlot(ring);
+    sync.cycles = now;
+    sync.task = 0;
+    sync.id = 0;
+    sync.phase = TRACE_PH_SYNC;
+    TraceEvent& time = claimSlot(ring);
+    time.cycles = (uint32_t)us;
+    time.task = (uint16_t)((uint64_t)us >> 32);
+    time.id = 0;
+    time.phase = TRACE_PH_SYNC_TIME;
+    ring.syncHead = ring.head;
+    ring.syncUs = us;
+  }
+
+  TraceEvent& e = claimSlot(ring);
+  e.cycles = cycles;
+  e.task = taskKey(xTaskGetCurrentTaskHandle());
+  e.id = id;
+  e.phase = phase;
+}
+
+void traceRecord(TraceId id, char phase) {
+  if (!traceEnabled) return;
+  UBaseType_t mask = portSET_INTERRUPT_MASK_FROM_ISR();
+  uint32_t now = ESP.getCycleCount();
+  writeEvent(id, phase, now, now);
+  portCLEAR_INTERRUPT_MASK_FROM_ISR(mask);
+}
+
+void traceRecordSpan(TraceId id, uint32_t startCycles, uint32_t minUs) {
+  if (!traceEnabled) return;
+  if (cyclesPerUs == 0) cyclesPerUs = ESP.getCpuFreqMHz();
+  uint32_t minCycles = minUs * cyclesPerUs;
+  UBaseType_t mask = portSET_INTERRUPT_MASK_FROM_ISR();
+  uint32_t now = ESP.getCycleCount();
+  /* A task that migrated mid-span has cycles from two unrelated counters; drop it */
+  uint32_t elapsed = now - startCycles;
+  if (elapsed >= minCycles && elapsed < TRACE_SPAN_MAX_CYCLES) {
+    writeEvent(id, TRACE_PH_BEGIN, startCycles, now);
+    writeEvent(id, TRACE_PH_END, now, now);
+  }
+  portCLEAR_INTERRUPT_MASK_FROM_ISR(mask);
+}
+
+void registerTraceRoutes() {
+  server.on("/api/trace", HTTP_GET, handleApiTrace);
+}
+
+/* writeThreadNames: Names every live task; a task is one thread whichever core it ran on */
+static void writeThreadNames(ChunkWriter& out) {
+  /* Static: too large for the web task stack; handleApiTrace is the only caller */
+  static TaskStatus_t tasks[TRACE_MAX_TASKS];
+  UBaseType_t count = uxTaskGetSystemState(tasks, TRACE_MAX_TASKS, NULL);
+  out.printf(",{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":0,\"args\":{\"name\":\"esp32\"}}");
+  for (UBaseType_t i = 0; i < count; i++) {
+    out.printf(",{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":%u,\"args\":{\"name\":\"%s\"}}",
+               taskKey(tasks[i].xHandle), tasks[i].pcTaskName);
+  }
+}
+
+static void writeRing(ChunkWriter& out, uint8_t core, double mhz) {
+  const TraceRing& ring = rings[core];
+  uint32_t head = ring.head;
+  uint32_t first = (head > TRACE_EVENTS_PER_CORE) ? head - TRACE_EVENTS_PER_CORE : 0;
+
+  bool synced = false;
+  uint32_t syncCycles = 0;
+  uint64_t syncUs = 0;
+  for (uint32_t n = first; n < head; n++) {
+    const TraceEvent& e = ring.events[n & (TRACE_EVENTS_PER_CORE - 1)];
+    if (e.phase == TRACE_PH_SYNC_TIME) continue;  /* The ring wrapped between the halves of a sync */
+    if (e.phase == TRACE_PH_SYNC) {
+      if (n + 1 >= head) break;
+      const TraceEvent& time = ring.events[(n + 1) & (TRACE_EVENTS_PER_CORE - 1)];
+      if (time.phase != TRACE_PH_SYNC_TIME) continue;
+      n++;
+      syncCycles = e.cycles;
+      syncUs = ((uint64_t)time.task << 32) | time.cycles;
+      synced = true;
+      continue;
+    }
+    if (!synced || e.id >= TRACE_ID_COUNT) continue;
+
+    double ts = (double)syncUs + (int32_t)(e.cycles - syncCycles) / mhz;
+    out.printf(",{\"name\":\"%s\",\"ph\":\"%c\",\"ts\":%.3f,\"pid\":0,\"tid\":%u,\"args\":{\"core\":%u}%s}",
+               traceNames[e.id], e.phase, ts, e.task, core, e.phase == TRACE_PH_INSTANT ? ",\"s\":\"t\"" : "");
+  }
+}
+
+void handleApiTrace() {
+  if (isOtaActive()) {
+    sendBusyJson("OTA in progress");
+    return;
+  }
+
+  /* Writers hold interrupts off only for a few instructions; one tick lets any in flight finish */
+  traceEnabled = false;
+  vTaskDelay(1);
+
+  server.setContentLength(CONTENT_LENGTH_UNKNOWN);
+  server.send(200, "application/json", "");
+
+  ChunkWriter out;
+  out.printf("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+  out.printf("{\"name\":\"process_sort_index\",\"ph\":\"M\",\"pid\":0,\"args\":{\"sort_index\":0}}");
+  writeThreadNames(out);
+  double mhz = ESP.getCpuFreqMHz();
+  for (uint8_t core = 0; core < NUM_CORES; core++) writeRing(out, core, mhz);
+  out.printf("]}");
+  out.end();
+
+  if (server.hasArg("reset")) {
+    for (uint8_t core = 0; core < NUM_CORES; core++) rings[core].head = 0;
+  }
+  traceEnabled = true;
+}
+
+#endif
@@ -0,0 +1,96 @@
+/* ==============================================================================
+   TRACE.H - Timeline Trace Interface
+
+   Records begin/end/instant events into one ring per core:
+   - TRACE_BEGIN(id) / TRACE_END(id)  span on the calling task
+   - TRACE_SCOPE(id)                  span until the end of the C++ scope
+   - TRACE_SCOPE_MIN(id, us)          span kept only if it lasted >= us
+                                      (polling loops that are usually idle)
+   - TRACE_INSTANT(id)                single point in time
+   Each event is 8 bytes: CPU cycle count, task, id, phase. The cycle
+   counter is cheap but per-core, so each ring also carries periodic
+   (cycles, esp_timer) pairs that the export uses to put both cores on
+   one timeline.
+
+   GET /api/trace[?reset=1] pauses recording and streams the rings as
+   Chrome trace JSON (chrome://tracing, ui.perfetto.dev): one thread per
+   task, with the core that recorded each event in its args, so a span
+   stays whole when its task migrates between cores.
+
+   With ENABLE_TRACE 0 every macro expands to nothing.
+   ============================================================================== */
+
+/* Header guard to prevent multiple inclusion of trace.h */
+#ifndef TRACE_H
+#define TRACE_H
+
+#include "config.h"
+
+#if ENABLE_TRACE
+
+#include <Arduino.h>
+
+/* Add an id here and its name to traceNames[] in trace.cpp */
+enum TraceId : uint8_t {
+  TRACE_HTTP = 0,
+  TRACE_BIZ_CMD,
+  TRACE_WIFI_CHECK,
+  TRACE_FLASH_WRITE,
+  TRACE_OTA_WRITE,
+  TRACE_STATS_SAMPLE,
+  TRACE_ID_COUNT
+};
+
+#define TRACE_PH_BEGIN 'B'
+#define TRACE_PH_END 'E'
+#define TRACE_PH_INSTANT 'i'
+
+void traceRecord(TraceId id, char phase);
+
+/* Records a span that started at startCycles, if it lasted at least minUs */
+void traceRecordSpan(TraceId id, uint32_t startCycles, uint32_t minUs);
+
+class TraceScope {
+public:
+  explicit TraceScope(TraceId id) : id_(id) { traceRecord(id_, TRACE_PH_BEGIN); }
+  ~TraceScope() { traceRecord(id_, TRACE_PH_END); }
+
+private:
+  TraceId id_;
+};
+
+class TraceScopeMin {
+public:
+  TraceScopeMin(TraceId id, uint32_t minUs) : id_(id), start_(ESP.getCycleCount()), minUs_(minUs) {}
+  ~TraceScopeMin() { traceRecordSpan(id_, start_, minUs_); }
+
+private:
+  TraceId id_;
+  uint32_t start_;
+  uint32_t minUs_;
+};
+
+#define TRACE_CONCAT_(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_(a, b)
+
+#define TRACE_BEGIN(id) traceRecord(id, TRACE_PH_BEGIN)
+#define TRACE_END(id) traceRecord(id, TRACE_PH_END)
+#define TRACE_INSTANT(id) traceRecord(id, TRACE_PH_INSTANT)
+#define TRACE_SCOPE(id) TraceScope TRACE_CONCAT(traceScope_, __LINE__)(id)
+#define TRACE_SCOPE_MIN(id, us) TraceScopeMin TRACE_CONCAT(traceScope_, __LINE__)(id, us)
+
+void registerTraceRoutes();
+
+void handleApiTrace();
+
+#else
+
+#define TRACE_BEGIN(id) ((void)0)
+#define TRACE_END(id) ((void)0)
+#define TRACE_INSTANT(id) ((void)0)
+#define TRACE_SCOPE(id) ((void)0)
+#define TRACE_SCOPE_MIN(id, us) ((void)0)
+
+#endif
+
+#endif
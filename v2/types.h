@@ -21,10 +21,52 @@
   #include "driver/temperature_sensor.h"
 #endif
 
+enum ExecLane : uint8_t {
+  EXEC_LANE_CONTROL = 0,
+  EXEC_LANE_BULK = 1,
+  EXEC_LANE_COUNT
+};
+
+/* Header only; payload points into a slab block sized for the command */
 struct ExecMessage {
-  char payload[MAX_MSG_SIZE];
+  char* payload;
   uint16_t length;
+  uint8_t slabClass;
   bool inUse;
+  ExecLane lane;
+  uint8_t home;  /* Worker that must run it (keyed), or EXEC_NO_WORKER */
+  uint32_t id;
+  uint32_t receivedUs;
+  uint32_t enqueuedUs;
+  uint32_t dequeuedUs;
+};
+
+struct MsgPoolStats {
+  uint16_t capacity;
+  uint16_t controlReserved;
+  uint16_t inUse;
+  uint16_t highWater;
+  uint32_t allocs;
+  uint32_t exhausted;
+};
+
+struct MsgSlabStats {
+  uint16_t blockSize;
+  uint16_t blocks;
+  uint16_t inUse;
+  uint16_t highWater;
+  uint32_t allocs;
+  uint32_t spills;
+};
+
+struct ExecLaneStats {
+  uint16_t depth;
+  uint16_t highWater;
+  uint32_t enqueued;
+  uint32_t dequeued;
+  uint32_t dropped;
+  uint32_t waitAvgUs;
+  uint32_t waitMaxUs;
 };
 
 enum WiFiState : uint8_t {
@@ -62,12 +104,50 @@ struct WiFiCredentials {
 
 #if DEBUG_MODE
 
+#define LOG_EVENT_ARGS 2  /* Integer arguments per event */
+#define LOG_EVENT_STR 20  /* String argument, terminator included */
+
+#define LOG_ENTRY_STR_CUT 0x01  /* LogEntry.flags: str holds only the start of a longer string */
+
+/* One event, formatted only when read (log_events.h); stored as-is in NVS and the log store */
 struct LogEntry {
+  uint32_t uptime;
+  uint32_t epoch;
+  uint16_t id;  /* LogEventId */
+  uint8_t argc;
+  uint8_t flags;  /* LOG_ENTRY_* */
+  uint32_t args[LOG_EVENT_ARGS];
+  char str[LOG_EVENT_STR];
+};
+
+static_assert(LOG_EVENT_STR >= configMAX_TASK_NAME_LEN, "A task name must fit the string argument whole");
+
+/* Event entry with a 12-byte string, written before str was widened; read only to migrate old logs */
+struct LogEntryV2 {
+  uint32_t uptime;
+  uint32_t epoch;
+  uint16_t id;
+  uint8_t argc;
+  uint8_t reserved;
+  uint32_t args[LOG_EVENT_ARGS];
+  char str[12];
+};
+
+/* Text entry written by firmware before event IDs; read only to migrate old logs (EVT_LEGACY_TEXT) */
+struct LegacyLogEntry {
   uint32_t uptime;
   uint32_t epoch;
   char msg[60];
 };
 
+/* Same order as FlashWriteType */
+enum LogCategory : uint8_t {
+  LOG_CAT_REBOOT = 0,
+  LOG_CAT_WIFI,
+  LOG_CAT_ERROR,
+  LOG_CAT_COUNT
+};
+
 enum FlashWriteType : uint8_t {
   FLASH_WRITE_REBOOT_LOGS = 0,
   FLASH_WRITE_WIFI_LOGS = 1,
@@ -79,26 +159,42 @@ struct FlashWriteRequest {
   uint32_t timestamp;
 };
 
+enum StackHealth : uint8_t {
+  STACK_GOOD = 0,
+  STACK_OK,
+  STACK_LOW,
+  STACK_CRITICAL
+};
+
+/* Plain data so sampling never touches the heap; fields read every sample come first */
 struct TaskMonitorData {
-  String name;
-  UBaseType_t priority;
-  eTaskState state;
-  uint32_t runtime;
-  uint32_t prevRuntime;
   uint64_t runtimeAccumUs;
+  TaskHandle_t handle;
+  uint32_t prevRuntime;  /* Raw 32-bit counter at the last sample; deltas are taken modulo 2^32 */
   uint32_t stackHighWater;
-  uint8_t cpuPercent;
-  String stackHealth;
+  uint32_t stackSize;  /* Allocated bytes, 0 if unknown; see taskStackSize() */
+  UBaseType_t priority;
   BaseType_t coreAffinity;
-  TaskHandle_t handle;
+  eTaskState state;
+  uint8_t cpuPercent;
+  StackHealth stackHealth;
+  char name[configMAX_TASK_NAME_LEN];
 };
 
 struct CoreRuntimeData {
-  uint64_t totalRuntime100ms;
-  uint64_t prevTotalRuntime100ms;
+  uint64_t runtimeUs;  /* Run time of the core's pinned tasks during the last sample period */
   uint8_t taskCount;
   uint8_t cpuPercentTotal;
 };
+
+/* One complete sample as published by the stats sampler; see getTaskStatsSnapshot() */
+struct TaskStatsSnapshot {
+  uint32_t sampleMs;
+  uint8_t taskCount;
+  uint8_t coreLoadPct[2];
+  CoreRuntimeData cores[2];
+  TaskMonitorData tasks[MAX_TASKS_MONITORED];
+};
 #endif
 
 #if ENABLE_OTA
@@ -19,6 +19,14 @@
 #include "wifi_handler.h"
 #include "debug_handler.h"
 #include "tasks.h"  
+#include "msg_pool.h"
+#include "cmd_registry.h"
+#include "exec_queue.h"
+#include "exec_result.h"
+#include "exec_stats.h"
+#include "cpu_monitor.h"
+#include "stack_monitor.h"
+#include "heap_tracker.h"
 #include <ArduinoJson.h>
 #include <pgmspace.h>
 
@@ -26,6 +34,22 @@
 #include "ota_handler.h"
 #endif
 
+#if ENABLE_BENCH
+#include "bench.h"
+#endif
+
+#if ENABLE_METRICS_HISTORY
+#include "metrics_history.h"
+#endif
+
+#if ENABLE_OPENMETRICS
+#include "openmetrics.h"
+#endif
+
+#if ENABLE_TRACE
+#include "trace.h"
+#endif
+
 #include "web_html.h"
 
 static String cleanString(const String& input);
@@ -54,6 +78,46 @@ void sendBusyJson(const char* msg) {
 }
 #endif
 
+void ChunkWriter::printf(const char* fmt, ...) {
+  char line[128];
+  va_list args;
+  va_start(args, fmt);
+  int n = vsnprintf(line, sizeof(line), fmt, args);
+  va_end(args);
+  if (n <= 0) return;
+  if ((size_t)n >= sizeof(line)) n = sizeof(line) - 1;
+  write(line, n);
+}
+
+void ChunkWriter::write(const char* data, size_t n) {
+  if (len + n > sizeof(buf)) flush();
+  if (n > sizeof(buf)) {
+    server.sendContent(data, n);
+    return;
+  }
+  memcpy(buf + len, data, n);
+  len += n;
+}
+
+void ChunkWriter::flush() {
+  if (len == 0) return;
+  server.sendContent(buf, len);
+  len = 0;
+}
+
+void ChunkWriter::end() {
+  flush();
+  server.sendContent("");
+}
+
+#if DEBUG_MODE
+TaskStatsSnapshot& webTaskSnapshot() {
+  /* Static: ~3.5KB is too much for the web task stack; the server runs one handler at a time */
+  static TaskStatsSnapshot snap;
+  return snap;
+}
+#endif
+
 void sendIndex() {
   server.setContentLength(CONTENT_LENGTH_UNKNOWN);
   server.send(200, "text/html", "");
@@ -122,7 +186,7 @@ void sendIndex() {
 
 void handleApiStatus() {
   if (isOtaActive()) {
-    DynamicJsonDocument doc(256);
+    WebJsonDocument doc(256);
     doc["connected"] = (WiFi.status() == WL_CONNECTED);
     doc["ble"] = false;
     doc["uptime_ms"] = millis();
@@ -133,7 +197,7 @@ void handleApiStatus() {
     return;
   }
 
-  DynamicJsonDocument doc(1536);
+  WebJsonDocument doc(3072);
   doc["ble"] = bleDeviceConnected;
 
   bool connected = (WiFi.status() == WL_CONNECTED);
@@ -200,21 +264,70 @@ void handleApiStatus() {
 
   JsonObject biz = doc.createNestedObject("biz");
   biz["running"] = (gBizState == BIZ_RUNNING);
-  if (execQ) biz["queue"] = uxQueueMessagesWaiting(execQ);
   biz["processed"] = bizProcessed;
+  biz["cmd_per_sec"] = bizCmdRate;
+
+  uint32_t queued = 0;
+  JsonObject lanes = biz.createNestedObject("lanes");
+  for (int l = 0; l < EXEC_LANE_COUNT; l++) {
+    ExecLaneStats laneStats;
+    getExecLaneStats((ExecLane)l, laneStats);
+    queued += laneStats.depth;
+    JsonObject lane = lanes.createNestedObject(execLaneName((ExecLane)l));
+    lane["depth"] = laneStats.depth;
+    lane["high_water"] = laneStats.highWater;
+    lane["enqueued"] = laneStats.enqueued;
+    lane["dropped"] = laneStats.dropped;
+    lane["wait_avg_us"] = laneStats.waitAvgUs;
+    lane["wait_max_us"] = laneStats.waitMaxUs;
+  }
+  biz["queue"] = queued;
+
+  JsonArray workers = biz.createNestedArray("workers");
+  for (uint8_t w = 0; w < BIZ_WORKERS; w++) {
+    JsonObject worker = workers.createNestedObject();
+    worker["alive"] = bizTaskHandles[w] != nullptr;
+    worker["processed"] = bizWorkerProcessed[w];
+  }
+
+  MsgPoolStats poolStats;
+  getMsgPoolStats(poolStats);
+  JsonObject pool = biz.createNestedObject("pool");
+  pool["size"] = poolStats.capacity;
+  pool["control_reserved"] = poolStats.controlReserved;
+  pool["in_use"] = poolStats.inUse;
+  pool["high_water"] = poolStats.highWater;
+  pool["allocs"] = poolStats.allocs;
+  pool["exhausted"] = poolStats.exhausted;
+
+  JsonArray slabs = pool.createNestedArray("slabs");
+  for (uint8_t c = 0; c < MSG_SLAB_CLASS_COUNT; c++) {
+    MsgSlabStats slabStats;
+    getMsgSlabStats(c, slabStats);
+    JsonObject slab = slabs.createNestedObject();
+    slab["block"] = slabStats.blockSize;
+    slab["blocks"] = slabStats.blocks;
+    slab["in_use"] = slabStats.inUse;
+    slab["high_water"] = slabStats.highWater;
+    slab["allocs"] = slabStats.allocs;
+    slab["spills"] = slabStats.spills;
+  }
 
 #if DEBUG_MODE
+  CoreRuntimeData coreStats[2] = {};
+  uint8_t coreLoad[2] = {};
+  getCoreStatsSnapshot(coreStats, coreLoad);
   JsonObject cores = doc.createNestedObject("cores");
   for (int c = 0; c < NUM_CORES; c++) {
     JsonObject core = cores.createNestedObject(String(c));
-    core["tasks"] = coreRuntime[c].taskCount;
-    core["load_pct"] = coreLoadPct[c];
-    core["cpu_total"] = coreRuntime[c].cpuPercentTotal;
+    core["tasks"] = coreStats[c].taskCount;
+    core["load_pct"] = coreLoad[c];
+    core["cpu_total"] = coreStats[c].cpuPercentTotal;
   }
 #endif
 
   String output;
-  output.reserve(1024);
+  output.reserve(2048);
   serializeJson(doc, output);
   server.send(200, "application/json", output);
 }
@@ -238,6 +351,7 @@ void handleApiBizStop() {
 }
 
 void handleApiExec() {
+  uint32_t receivedUs = micros();
   if (isOtaActive()) {
     sendBusyJson("OTA in progress");
     return;
@@ -248,7 +362,7 @@ void handleApiExec() {
     return;
   }
 
-  DynamicJsonDocument doc(256);
+  WebJsonDocument doc(384);
   DeserializationError err = deserializeJson(doc, server.arg("plain"));
   if (err) {
     server.send(400, "application/json", "{\"err\":\"invalid JSON\"}");
@@ -256,6 +370,7 @@ void handleApiExec() {
   }
 
   String cmd = doc["cmd"] | "";
+  const char* key = doc["key"] | (const char*)nullptr;  /* Commands sharing a key run in order */
   if (cmd.length() == 0) {
     server.send(400, "application/json", "{\"err\":\"cmd required\"}");
     return;
@@ -266,24 +381,188 @@ void handleApiExec() {
     return;
   }
 
-  ExecMessage* msg = allocMessage();
-  if (!msg) {
-    server.send(503, "application/json", "{\"err\":\"queue full\"}");
+  CmdResult check = cmdValidate(cmd.c_str(), CMD_VIA_HTTP);
+  if (check == CMD_ERR_TRANSPORT || check == CMD_ERR_FORMAT) {
+    server.send(400, "application/json", String("{\"err\":\"") + cmdResultName(check) + "\"}");
     return;
   }
 
-  strncpy(msg->payload, cmd.c_str(), MAX_MSG_SIZE - 1);
-  msg->payload[MAX_MSG_SIZE - 1] = '\0';
-  msg->length = strlen(msg->payload);
-
-  if (execQ && xQueueSend(execQ, &msg, pdMS_TO_TICKS(100)) == pdTRUE) {
-    server.send(200, "application/json", "{\"msg\":\"queued\"}");
+  uint32_t id = 0;
+  ExecSubmitResult submitted = execSubmit(cmd.c_str(), cmd.length(), receivedUs, &id, key);
+  if (submitted == EXEC_SUBMIT_OK) {
+    server.send(200, "application/json", String("{\"msg\":\"queued\",\"id\":") + id + "}");
+  } else if (submitted == EXEC_SUBMIT_POOL_EXHAUSTED) {
+    server.send(503, "application/json", "{\"err\":\"queue full\"}");
   } else {
-    freeMessage(msg);
     server.send(503, "application/json", "{\"err\":\"queue send failed\"}");
   }
 }
 
+void handleApiExecBatch() {
+  uint32_t receivedUs = micros();
+  if (isOtaActive()) {
+    sendBusyJson("OTA in progress");
+    return;
+  }
+
+  if (!server.hasArg("plain")) {
+    server.send(400, "application/json", "{\"err\":\"no body\"}");
+    return;
+  }
+
+  /* Strings are copied into the document, so size it from the body */
+  const String& body = server.arg("plain");
+  if (body.length() > EXEC_BATCH_MAX * (MAX_MSG_SIZE + 8)) {
+    server.send(413, "application/json", "{\"err\":\"batch too large\"}");
+    return;
+  }
+
+  WebJsonDocument doc(JSON_OBJECT_SIZE(2) + JSON_ARRAY_SIZE(EXEC_BATCH_MAX) + body.length() + 64);
+  DeserializationError err = deserializeJson(doc, body);
+  if (err) {
+    server.send(400, "application/json", "{\"err\":\"invalid JSON\"}");
+    return;
+  }
+
+  /* Accept either a bare array or {"cmds":[...], "key":"..."} */
+  JsonArrayConst cmds = doc.is<JsonArray>() ? doc.as<JsonArrayConst>() : doc["cmds"].as<JsonArrayConst>();
+  const char* key = doc.is<JsonArray>() ? nullptr : doc["key"].as<const char*>();
+  if (cmds.isNull() || cmds.size() == 0) {
+    server.send(400, "application/json", "{\"err\":\"cmds array required\"}");
+    return;
+  }
+  if (cmds.size() > EXEC_BATCH_MAX) {
+    server.send(400, "application/json", "{\"err\":\"too many cmds\"}");
+    return;
+  }
+
+  const char* status[EXEC_BATCH_MAX];
+  const char* accepted[EXEC_BATCH_MAX];
+  uint16_t lens[EXEC_BATCH_MAX];
+  uint32_t ids[EXEC_BATCH_MAX];
+  uint8_t position[EXEC_BATCH_MAX];
+  uint8_t total = 0;
+  uint8_t count = 0;
+
+  for (JsonVariantConst item : cmds) {
+    const char* cmd = item.as<const char*>();
+    size_t len = cmd ? strlen(cmd) : 0;
+    if (len == 0) {
+      status[total] = "cmd required";
+    } else if (len >= MAX_MSG_SIZE) {
+      status[total] = "cmd too long";
+    } else {
+      CmdResult check = cmdValidate(cmd, CMD_VIA_HTTP);
+      if (check == CMD_ERR_TRANSPORT || check == CMD_ERR_FORMAT) {
+        status[total] = cmdResultName(check);
+      } else {
+        status[total] = "queued";
+        accepted[count] = cmd;
+        lens[count] = (uint16_t)len;
+        position[count] = total;
+        count++;
+      }
+    }
+    total++;
+  }
+
+  int code = 200;
+  if (count > 0) {
+    ExecSubmitResult submitted = execSubmitBatch(accepted, lens, count, receivedUs, ids, key);
+    if (submitted != EXEC_SUBMIT_OK) {
+      const char* reason = (submitted == EXEC_SUBMIT_POOL_EXHAUSTED) ? "queue full" : "queue send failed";
+      for (uint8_t i = 0; i < total; i++) {
+        if (strcmp(status[i], "queued") == 0) status[i] = reason;
+      }
+      count = 0;
+      code = 503;
+    }
+  }
+
+  /* ids[] is parallel to results[]; 0 marks a command that was not queued */
+  uint32_t idAt[EXEC_BATCH_MAX] = {};
+  for (uint8_t i = 0; i < count; i++) idAt[position[i]] = ids[i];
+
+  WebJsonDocument resp(JSON_OBJECT_SIZE(3) + 2 * JSON_ARRAY_SIZE(EXEC_BATCH_MAX));
+  resp["accepted"] = count;
+  JsonArray results = resp.createNestedArray("results");
+  JsonArray idList = resp.createNestedArray("ids");
+  for (uint8_t i = 0; i < total; i++) {
+    results.add(status[i]);
+    idList.add(idAt[i]);
+  }
+
+  String output;
+  serializeJson(resp, output);
+  server.send(code, "application/json", output);
+}
+
+void handleApiExecResult() {
+  uint32_t id = server.hasArg("id") ? strtoul(server.arg("id").c_str(), nullptr, 10) : 0;
+  if (id == 0) {
+    server.send(400, "application/json", "{\"err\":\"id required\"}");
+    return;
+  }
+
+  /* Long-polling blocks the web server, so the wait is capped */
+  uint32_t waitMs = server.hasArg("wait") ? strtoul(server.arg("wait").c_str(), nullptr, 10) : 0;
+  if (waitMs > EXEC_RESULT_WAIT_MAX_MS) waitMs = EXEC_RESULT_WAIT_MAX_MS;
+  if (isOtaActive()) waitMs = 0;
+
+  ExecResultInfo info;
+  if (!execResultWait(id, waitMs, info)) {
+    server.send(404, "application/json", "{\"err\":\"unknown id\"}");
+    return;
+  }
+
+  WebJsonDocument doc(JSON_OBJECT_SIZE(6));
+  doc["id"] = info.id;
+  doc["state"] = execStateName(info.state);
+  if (info.state == EXEC_STATE_DONE) {
+    doc["result"] = cmdResultName((CmdResult)info.result);
+    doc["code"] = info.result;
+  }
+  if (info.state == EXEC_STATE_RUNNING || info.state == EXEC_STATE_DONE) doc["queue_us"] = info.queueUs;
+  if (info.state == EXEC_STATE_DONE) doc["run_us"] = info.runUs;
+
+  String output;
+  serializeJson(doc, output);
+  server.send(info.state == EXEC_STATE_EXPIRED ? 410 : 200, "application/json", output);
+}
+
+void handleApiDiagExec() {
+  WebJsonDocument doc(1024);
+
+  JsonObject stages = doc.createNestedObject("latency_us");
+  for (uint8_t st = 0; st < EXEC_STAGE_COUNT; st++) {
+    ExecLatencySummary summary;
+    getExecLatency((ExecStage)st, summary);
+    JsonObject stage = stages.createNestedObject(execStageName((ExecStage)st));
+    stage["count"] = summary.count;
+    stage["p50"] = summary.p50Us;
+    stage["p95"] = summary.p95Us;
+    stage["p99"] = summary.p99Us;
+    stage["max"] = summary.maxUs;
+  }
+
+  ExecPipelineCounters counters;
+  getExecPipelineCounters(counters);
+  doc["depth_high_water"] = counters.depthHighWater;
+  JsonObject rejected = doc.createNestedObject("rejected");
+  rejected["pool_exhausted"] = counters.rejectedPoolExhausted;
+  rejected["queue_full"] = counters.rejectedQueueFull;
+
+  /* ?reset=1 clears the histograms after this snapshot */
+  if (server.hasArg("reset") && server.arg("reset") == "1") {
+    execStatsReset();
+    doc["reset"] = true;
+  }
+
+  String output;
+  serializeJson(doc, output);
+  server.send(200, "application/json", output);
+}
+
 void handleApiNetwork() {
   if (isOtaActive()) {
     sendBusyJson("OTA in progress");
@@ -295,7 +574,7 @@ void handleApiNetwork() {
     return;
   }
 
-  DynamicJsonDocument doc(512);
+  WebJsonDocument doc(512);
   DeserializationError err = deserializeJson(doc, server.arg("plain"));
   if (err) {
     server.send(400, "application/json", "{\"err\":\"invalid JSON\"}");
@@ -341,7 +620,7 @@ void handleApiNetwork() {
     server.send(200, "application/json", "{\"msg\":\"network config saved\"}");
   }
 
-  LOG_WIFI(F("Network config updated"), millis() / 1000);
+  LOG_WIFI(EVT_NET_CONFIG_UPDATED);
 }
 
 #if DEBUG_MODE
@@ -351,47 +630,47 @@ void handleApiTasks() {
     return;
   }
 
-  DynamicJsonDocument doc(5120);
+  TaskStatsSnapshot& snap = webTaskSnapshot();
+  if (!getTaskStatsSnapshot(snap)) {
+    sendBusyJson("No sample yet");
+    return;
+  }
+
+  WebJsonDocument doc(5120);
   JsonArray arr = doc.createNestedArray("tasks");
 
   uint8_t activeTaskCount = 0;
-  for (uint8_t i = 0; i < taskCount; i++) {
-    if (taskData[i].state == eDeleted) continue;
+  for (uint8_t i = 0; i < snap.taskCount; i++) {
+    const TaskMonitorData& task = snap.tasks[i];
+    if (task.state == eDeleted) continue;
     activeTaskCount++;
 
     JsonObject t = arr.createNestedObject();
-    t["name"] = taskData[i].name;
-    t["priority"] = taskData[i].priority;
+    t["name"] = (const char*)task.name;
+    t["priority"] = task.priority;
     
-    String stateName;
-    switch (taskData[i].state) {
-      case eRunning: stateName = "RUNNING"; break;
-      case eReady: stateName = "READY"; break;
-      case eBlocked: stateName = "BLOCKED"; break;
-      case eSuspended: stateName = "SUSPENDED"; break;
-      case eDeleted: stateName = "DELETED"; break;
-      default: stateName = "UNKNOWN"; break;
-    }
-    t["state"] = stateName;
+    t["state"] = taskStateName(task.state);
     
-    t["runtime"] = (uint64_t)taskData[i].runtimeAccumUs / 1000000ULL;
-    t["stack_hwm"] = taskData[i].stackHighWater;
-    t["stack_health"] = taskData[i].stackHealth;
-    t["cpu_percent"] = taskData[i].cpuPercent;
+    t["runtime"] = (uint64_t)task.runtimeAccumUs / 1000000ULL;
+    t["stack_hwm"] = task.stackHighWater;
+    if (task.stackSize) t["stack_size"] = task.stackSize;
+    t["stack_health"] = stackHealthName(task.stackHealth);
+    t["cpu_percent"] = task.cpuPercent;
     
-    String coreStr = (taskData[i].coreAffinity == tskNO_AFFINITY) ? "ANY" : String(taskData[i].coreAffinity);
+    String coreStr = (task.coreAffinity == tskNO_AFFINITY) ? "ANY" : String(task.coreAffinity);
     t["core"] = coreStr;
   }
 
   doc["task_count"] = activeTaskCount;
   doc["uptime_ms"] = millis();
+  doc["sample_age_ms"] = millis() - snap.sampleMs;
 
   JsonObject coreSummary = doc.createNestedObject("core_summary");
   for (int c = 0; c < NUM_CORES; c++) {
     JsonObject core = coreSummary.createNestedObject(String(c));
-    core["tasks"] = coreRuntime[c].taskCount;
-    core["cpu_total"] = coreRuntime[c].cpuPercentTotal;
-    core["load"] = coreLoadPct[c];
+    core["tasks"] = snap.cores[c].taskCount;
+    core["cpu_total"] = snap.cores[c].cpuPercentTotal;
+    core["load"] = snap.coreLoadPct[c];
   }
 
   String out;
@@ -400,41 +679,118 @@ void handleApiTasks() {
   server.send(200, "application/json", out);
 }
 
+/* writeJsonString: Quoted and escaped; event strings can carry client input such as BLE commands */
+static void writeJsonString(ChunkWriter& out, const char* s) {
+  out.write("\"", 1);
+  for (; *s; s++) {
+    if (*s == '"' || *s == '\\') {
+      char esc[2] = { '\\', *s };
+      out.write(esc, 2);
+    } else if ((uint8_t)*s < 0x20) {
+      out.printf("\\u%04x", (uint8_t)*s);
+    } else {
+      out.write(s, 1);
+    }
+  }
+  out.write("\"", 1);
+}
+
+/* handleApiDebugLogs: Streamed entry by entry from the rings; a poll with the last cursor moves only new entries */
 void handleApiDebugLogs() {
   if (isOtaActive()) {
     sendBusyJson("OTA in progress");
     return;
   }
 
-  DynamicJsonDocument doc(5120);
+  static const char* const sections[LOG_CAT_COUNT] = { "reboots", "wifi", "errors" };
+
+  /* ?raw=1 returns event IDs and arguments for tools/log_decode.py instead of text */
+  bool raw = server.hasArg("raw");
 
-  JsonArray r = doc.createNestedArray("reboots");
-  for (uint8_t i = 0; i < rebootLogCount; i++) {
-    JsonObject o = r.createNestedObject();
-    o["t"] = rebootLogs[i].uptime;
-    o["epoch"] = rebootLogs[i].epoch;
-    o["msg"] = rebootLogs[i].msg;
+  int only = -1;
+  if (server.hasArg("cat")) {
+    for (uint8_t cat = 0; cat < LOG_CAT_COUNT; cat++) {
+      if (server.arg("cat") == sections[cat]) only = cat;
+    }
+    if (only < 0) {
+      server.send(400, "application/json", "{\"err\":\"cat must be reboots, wifi or errors\"}");
+      return;
+    }
   }
 
-  JsonArray w = doc.createNestedArray("wifi");
-  for (uint8_t i = 0; i < wifiLogCount; i++) {
-    JsonObject o = w.createNestedObject();
-    o["t"] = wifiLogs[i].uptime;
-    o["epoch"] = wifiLogs[i].epoch;
-    o["msg"] = wifiLogs[i].msg;
+  uint32_t limit = server.hasArg("limit") ? strtoul(server.arg("limit").c_str(), nullptr, 10) : MAX_DEBUG_LOGS;
+  if (limit == 0 || limit > MAX_DEBUG_LOGS) limit = MAX_DEBUG_LOGS;
+
+  /* ?since= is a ticket applied to every category, or the "cursor" of an earlier response:
+     the log generation, then the last ticket returned per category */
+  uint32_t gen = getLogGeneration();
+  uint32_t since[LOG_CAT_COUNT] = {};
+  bool reset = false;
+  if (server.hasArg("since")) {
+    String arg = server.arg("since");
+    uint32_t v[LOG_CAT_COUNT + 1];
+    uint8_t n = 0;
+    const char* p = arg.c_str();
+    char* end;
+    do {
+      v[n++] = strtoul(p, &end, 10);
+      p = end + 1;
+    } while (*end == '.' && n < LOG_CAT_COUNT + 1);
+
+    if (*end != '\0' || (n != 1 && n != LOG_CAT_COUNT + 1)) {
+      server.send(400, "application/json", "{\"err\":\"since must be a sequence number or a cursor\"}");
+      return;
+    }
+    if (n == 1) {
+      for (uint8_t cat = 0; cat < LOG_CAT_COUNT; cat++) since[cat] = v[0];
+    } else if (v[0] == gen) {
+      memcpy(since, &v[1], sizeof(since));
+    } else {
+      reset = true;  /* Rebooted or cleared since that cursor: start over from the oldest entry */
+    }
   }
 
-  JsonArray e = doc.createNestedArray("errors");
-  for (uint8_t i = 0; i < errorLogCount; i++) {
-    JsonObject o = e.createNestedObject();
-    o["t"] = errorLogs[i].uptime;
-    o["epoch"] = errorLogs[i].epoch;
-    o["msg"] = errorLogs[i].msg;
+  server.setContentLength(CONTENT_LENGTH_UNKNOWN);
+  server.send(200, "application/json", "");
+
+  ChunkWriter out;
+  out.printf("{\"reset\":%s", reset ? "true" : "false");
+
+  char msg[96];
+  for (uint8_t cat = 0; cat < LOG_CAT_COUNT; cat++) {
+    if (only >= 0 && cat != only) continue;  /* Its cursor position is passed through unchanged */
+
+    out.printf(",\"%s\":[", sections[cat]);
+    LogEntry e;
+    uint32_t seq;
+    for (uint32_t n = 0; n < limit && nextLogEntry((LogCategory)cat, since[cat], e, seq); n++) {
+      out.printf("%s{\"seq\":%u,\"t\":%u,\"epoch\":%u,\"id\":%u,", n ? "," : "", seq, e.uptime, e.epoch, e.id);
+      if (raw) {
+        out.printf("\"args\":[");
+        for (uint8_t a = 0; a < e.argc && a < LOG_EVENT_ARGS; a++) out.printf("%s%u", a ? "," : "", e.args[a]);
+        out.printf("]");
+        if (e.str[0]) {
+          memcpy(msg, e.str, sizeof(e.str));
+          msg[sizeof(e.str) - 1] = '\0';  /* Entries come from flash; do not trust the terminator */
+          out.printf(",\"s\":");
+          writeJsonString(out, msg);
+          if (e.flags & LOG_ENTRY_STR_CUT) out.printf(",\"cut\":true");
+        }
+      } else {
+        formatLogEvent(e, msg, sizeof(msg));
+        out.printf("\"msg\":");
+        writeJsonString(out, msg);
+      }
+      out.printf("}");
+      since[cat] = seq;
+    }
+    out.printf("]");
   }
 
-  String out;
-  serializeJson(doc, out);
-  server.send(200, "application/json", out);
+  out.printf(",\"cursor\":\"%u", gen);
+  for (uint8_t cat = 0; cat < LOG_CAT_COUNT; cat++) out.printf(".%u", since[cat]);
+  out.printf("\"}");
+  out.end();
 }
 
 void handleApiDebugClear() {
@@ -447,6 +803,38 @@ void handleApiDebugClear() {
 }
 #endif
 
+#if ENABLE_TASK_TOP
+void handleApiTasksTop() {
+  TaskTopEntry top[TASK_TOP_N];
+  uint32_t sampleMs = 0;
+  uint8_t count = getTaskTop(top, TASK_TOP_N, &sampleMs);
+  if (count == 0 && sampleMs == 0) {
+    sendBusyJson("No sample yet");
+    return;
+  }
+
+  StaticJsonDocument<512> doc;
+  JsonArray arr = doc.createNestedArray("tasks");
+  for (uint8_t i = 0; i < count; i++) {
+    JsonObject t = arr.createNestedObject();
+    t["name"] = (const char*)top[i].name;
+    t["cpu_percent"] = top[i].cpuPercent;
+    if (top[i].core == tskNO_AFFINITY) {
+      t["core"] = "ANY";
+    } else {
+      t["core"] = top[i].core;
+    }
+  }
+  doc["sample_age_ms"] = millis() - sampleMs;
+  doc["core0_load"] = coreLoadPct[0];
+  doc["core1_load"] = coreLoadPct[1];
+
+  String out;
+  serializeJson(doc, out);
+  server.send(200, "application/json", out);
+}
+#endif
+
 void registerRoutes() {
   server.on("/", HTTP_GET, []() {
 #if ENABLE_OTA
@@ -465,18 +853,46 @@ void registerRoutes() {
   server.on("/api/biz/start", HTTP_POST, handleApiBizStart);
   server.on("/api/biz/stop", HTTP_POST, handleApiBizStop);
   server.on("/api/exec", HTTP_POST, handleApiExec);
+  server.on("/api/exec/batch", HTTP_POST, handleApiExecBatch);
+  server.on("/api/exec/result", HTTP_GET, handleApiExecResult);
+  server.on("/api/diag/exec", HTTP_GET, handleApiDiagExec);
   server.on("/api/network", HTTP_POST, handleApiNetwork);
 
 #if DEBUG_MODE
   server.on("/api/tasks", HTTP_GET, handleApiTasks);
   server.on("/api/debug/logs", HTTP_GET, handleApiDebugLogs);
   server.on("/api/debug/clear", HTTP_POST, handleApiDebugClear);
+  registerStackRoutes();
+#endif
+
+#if ENABLE_TASK_TOP
+  server.on("/api/tasks/top", HTTP_GET, handleApiTasksTop);
 #endif
 
 #if ENABLE_OTA
   registerOtaRoutes();
 #endif
 
+#if ENABLE_BENCH
+  registerBenchRoutes();
+#endif
+
+#if ENABLE_METRICS_HISTORY
+  registerMetricsRoutes();
+#endif
+
+#if ENABLE_OPENMETRICS
+  registerOpenMetricsRoutes();
+#endif
+
+#if ENABLE_TRACE
+  registerTraceRoutes();
+#endif
+
+#if ENABLE_HEAP_TRACK
+  registerHeapRoutes();
+#endif
+
   server.onNotFound([]() {
     server.send(404, "application/json", "{\"err\":\"not found\"}");
   });
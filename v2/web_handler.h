@@ -19,6 +19,20 @@
 
 void registerRoutes();
 
+/* Buffers a chunked response so the socket sees a few hundred bytes per write.
+   Call after setContentLength(CONTENT_LENGTH_UNKNOWN) and send(); end() terminates it. */
+class ChunkWriter {
+public:
+  void printf(const char* fmt, ...) __attribute__((format(printf, 2, 3)));
+  void write(const char* data, size_t n);
+  void flush();
+  void end();
+
+private:
+  char buf[512];
+  size_t len = 0;
+};
+
 void sendIndex();
 
 void handleApiStatus();
@@ -29,9 +43,20 @@ void handleApiBizStop();
 
 void handleApiExec();
 
+void handleApiExecBatch();
+
+void handleApiExecResult();
+
+void handleApiDiagExec();
+
 void handleApiNetwork();
 
 #if DEBUG_MODE
+struct TaskStatsSnapshot;
+
+/* Scratch copy for handlers that read getTaskStatsSnapshot(). One buffer serves every
+   handler because the web server runs them one at a time; don't hold it past the handler. */
+TaskStatsSnapshot& webTaskSnapshot();
 
 void handleApiTasks();
 
@@ -40,6 +65,11 @@ void handleApiDebugLogs();
 void handleApiDebugClear();
 #endif
 
+#if ENABLE_TASK_TOP
+
+void handleApiTasksTop();
+#endif
+
 #if ENABLE_OTA
 
 bool isOtaActive();
@@ -593,10 +593,24 @@ async function refreshTasks(){
  taskMonitorEl.innerHTML=h;
 }
 
+// Entries seen so far per section; each poll passes the last cursor, so only new entries come back
+let debugCursor = '';
+let debugLogs = {reboots:[], wifi:[], errors:[]};
+
 async function refreshDebugLogs(){
- const j = await api('/api/debug/logs');
+ const j = await api('/api/debug/logs' + (debugCursor ? '?since=' + debugCursor : ''));
  if(j.error) return;
 
+ let changed = !debugCursor || j.reset;
+ if(j.reset) debugLogs = {reboots:[], wifi:[], errors:[]};
+ for(const k of ['reboots','wifi','errors']){
+   if(!j[k] || j[k].length===0) continue;
+   debugLogs[k] = debugLogs[k].concat(j[k]).slice(-32);  // MAX_DEBUG_LOGS
+   changed = true;
+ }
+ debugCursor = j.cursor;
+ if(!changed) return;
+
  const fmt = (sec)=>fmU((sec||0)*1000);
  const fmtEpoch = (epoch) => {
    if(!epoch || epoch===0) return '';
@@ -620,9 +634,9 @@ async function refreshDebugLogs(){
    h += '</ul>';
    el.innerHTML = h;
  };
- renderList('rebootLog', j.reboots, 'No unexpected reboots');
- renderList('wifiLog', j.wifi, 'No reconnects recorded');
- renderList('errorLog', j.errors, 'No errors recorded');
+ renderList('rebootLog', debugLogs.reboots, 'No unexpected reboots');
+ renderList('wifiLog', debugLogs.wifi, 'No reconnects recorded');
+ renderList('errorLog', debugLogs.errors, 'No errors recorded');
 }
 
 async function clearDebugLogs(){
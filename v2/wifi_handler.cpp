@@ -41,7 +41,7 @@ void setupWiFi() {
             wifiState = WIFI_STATE_DISCONNECTED;
             xSemaphoreGive(wifiMutex);
           }
-          LOG_WIFI(F("WiFi disconnected"), millis() / 1000);
+          LOG_WIFI(EVT_WIFI_DISCONNECTED);
         }
         break;
       default:
@@ -114,7 +114,7 @@ void checkWiFiConnection() {
         if (wifiReconnectAttempts >= MAX_WIFI_RECONNECT_ATTEMPTS) {
           Serial.println(F("WiFi: Max reconnect attempts reached. Will not retry."));
           wifiManualDisconnect = true;
-          LOG_ERROR(F("WiFi: Max reconnect attempts"), millis() / 1000);
+          LOG_ERROR(EVT_WIFI_MAX_RETRIES);
           xSemaphoreGive(wifiMutex);
           return;
         }
@@ -160,7 +160,7 @@ void checkWiFiConnection() {
       } else if (now - wifiLastConnectAttempt > WIFI_CONNECT_TIMEOUT) {
         wifiState = WIFI_STATE_DISCONNECTED;
         wifiLastConnectAttempt = now;
-        LOG_ERROR(F("WiFi: Connection timeout"), millis() / 1000);
+        LOG_ERROR(EVT_WIFI_CONNECT_TIMEOUT);
       }
       break;
 
@@ -191,9 +191,8 @@ void checkWiFiConnection() {
   bool nowConnected = (WiFi.status() == WL_CONNECTED);
   if (nowConnected && !wifiWasConnected) {
     #if DEBUG_MODE
-    uint32_t t = millis() / 1000;
     if (wifiFirstConnectDone) {
-      addWifiLog(F("WiFi reconnected"), t);
+      LOG_WIFI(EVT_WIFI_RECONNECTED);
     }
     #endif
     wifiFirstConnectDone = true;
@@ -226,11 +225,11 @@ void loadWiFiCredentials() {
 
 void saveWiFi(const String& s, const String& p) {
   if (!prefs.putString("wifi_ssid", s)) {
-    LOG_ERROR(F("Failed to save WiFi SSID"), millis() / 1000);
+    LOG_ERROR(EVT_WIFI_SAVE_FAILED, "SSID");
   }
 
   if (!prefs.putString("wifi_pass", p) && p.length() > 0) {
-    LOG_ERROR(F("Failed to save WiFi password"), millis() / 1000);
+    LOG_ERROR(EVT_WIFI_SAVE_FAILED, "password");
   }
 
   if (s.length() > 0 && s.length() < 64) {
@@ -260,18 +259,18 @@ void loadNetworkConfig() {
 
 void saveNetworkConfig() {
   if (!prefs.putBool("use_dhcp", netConfig.useDHCP)) {
-    LOG_ERROR(F("Failed to save DHCP setting"), millis() / 1000);
+    LOG_ERROR(EVT_WIFI_SAVE_FAILED, "DHCP");
   }
   if (!prefs.putUInt("static_ip", (uint32_t)netConfig.staticIP)) {
-    LOG_ERROR(F("Failed to save static IP"), millis() / 1000);
+    LOG_ERROR(EVT_WIFI_SAVE_FAILED, "static IP");
   }
   if (!prefs.putUInt("gateway", (uint32_t)netConfig.gateway)) {
-    LOG_ERROR(F("Failed to save gateway"), millis() / 1000);
+    LOG_ERROR(EVT_WIFI_SAVE_FAILED, "gateway");
   }
   if (!prefs.putUInt("subnet", (uint32_t)netConfig.subnet)) {
-    LOG_ERROR(F("Failed to save subnet"), millis() / 1000);
+    LOG_ERROR(EVT_WIFI_SAVE_FAILED, "subnet");
   }
   if (!prefs.putUInt("dns", (uint32_t)netConfig.dns)) {
-    LOG_ERROR(F("Failed to save DNS"), millis() / 1000);
+    LOG_ERROR(EVT_WIFI_SAVE_FAILED, "DNS");
   }
 }
\ No newline at end of file